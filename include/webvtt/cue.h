@@ -75,6 +75,7 @@ webvtt_cue_t {
     */
   struct webvtt_refcount_t refs;
   webvtt_uint flags;
+  webvtt_flat_tree *flat_tree;
 
   /**
     * PUBLIC:
@@ -87,7 +88,7 @@ webvtt_cue_t {
   webvtt_string body;
 
   /**
-    * Parsed cue-text (NULL if has not been parsed)
+    * Parsed cue-text (NULL if has not been parsed, see webvtt_cue_get_nodes())
     */
   webvtt_node *node_head;
 } webvtt_cue;
@@ -104,6 +105,33 @@ webvtt_release_cue( webvtt_cue **pcue );
 WEBVTT_EXPORT int
 webvtt_validate_cue( webvtt_cue *cue );
 
+/**
+ * webvtt_cue_get_nodes
+ *
+ * Get the parsed cue-text of 'cue' (its 'node_head'), parsing 'body' first if
+ * that hasn't been done yet, as is the case for cues read by a parser with
+ * the WEBVTT_PARSE_LAZY_CUETEXT option. The node belongs to the cue; call
+ * webvtt_ref_node() to keep it for longer.
+ *
+ * The first call for a lazily parsed cue modifies it, so it must not be made
+ * by two threads at once.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_cue_get_nodes( webvtt_cue *cue, webvtt_node **pnode );
+
+/**
+ * webvtt_cue_get_flat_tree
+ *
+ * Get the cue-text of 'cue' as a flat tree (see webvtt_create_flat_tree()),
+ * building it from 'body' on first use. The tree belongs to the cue. It is
+ * built independently of 'node_head', so applications which only use flat
+ * trees should read cues with the WEBVTT_PARSE_LAZY_CUETEXT parser option.
+ *
+ * As with webvtt_cue_get_nodes(), the first call must not race with another.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_cue_get_flat_tree( webvtt_cue *cue, const webvtt_flat_tree **ptree );
+
 WEBVTT_EXPORT webvtt_status
 webvtt_cue_set_align( webvtt_cue *cue, const char *value );
 
@@ -104,6 +104,9 @@ extern "C" {
   };
   typedef enum webvtt_error_t webvtt_error;
 
+  /* Number of webvtt_error codes */
+# define WEBVTT_ERROR_COUNT ( WEBVTT_CUE_INCOMPLETE + 1 )
+
   WEBVTT_EXPORT const char *webvtt_strerror( webvtt_error );
   WEBVTT_EXPORT webvtt_bool
   webvtt_error_for_status( webvtt_status status, webvtt_error *out );
@@ -128,6 +128,104 @@ webvtt_ref_node( webvtt_node *node );
 WEBVTT_EXPORT void
 webvtt_release_node( webvtt_node **node );
 
+/**
+ * Flat cue-text trees
+ *
+ * A compact alternative to trees of webvtt_node: every node of a cue is kept
+ * in one array, in document order, and nodes refer to each other by index.
+ * Their text is given as ranges of a buffer which is stored in the same block
+ * as the nodes, so a tree is a single allocation no matter how many tags the
+ * cue has.
+ */
+#define WEBVTT_NO_NODE ( ( webvtt_uint )-1 )
+
+typedef struct
+webvtt_text_range_t {
+  webvtt_uint offset;
+  webvtt_uint length;
+} webvtt_text_range;
+
+typedef struct
+webvtt_flat_node_t {
+  webvtt_node_kind kind;
+  /**
+    * Indices of related nodes in the same tree, or WEBVTT_NO_NODE
+    */
+  webvtt_uint parent;
+  webvtt_uint first_child;
+  webvtt_uint last_child;
+  webvtt_uint next_sibling;
+  union {
+    /**
+      * WEBVTT_TEXT: the text, with character references replaced. The range
+      * is followed by a NUL byte.
+      */
+    webvtt_text_range text;
+    /**
+      * WEBVTT_TIME_STAMP
+      */
+    webvtt_timestamp timestamp;
+    /**
+      * Internal nodes: class names, separated by '.', and how many there are
+      * (as a class name may be empty), annotation (of voice nodes) and
+      * language
+      */
+    struct {
+      webvtt_text_range classes;
+      webvtt_uint class_count;
+      webvtt_text_range annotation;
+      webvtt_text_range lang;
+    } tag;
+  } data;
+} webvtt_flat_node;
+
+typedef struct
+webvtt_flat_tree_t {
+  webvtt_uint length; /* number of nodes, nodes[0] is the head */
+  webvtt_flat_node *nodes;
+  char *text;
+} webvtt_flat_tree;
+
+typedef struct
+webvtt_flat_iterator_t {
+  const webvtt_flat_tree *tree;
+  webvtt_uint next;
+} webvtt_flat_iterator;
+
+/**
+ * webvtt_create_flat_tree
+ *
+ * Parse 'text' (cue-text of 'length' bytes) into a flat tree, which is freed
+ * by webvtt_delete_flat_tree(). Produces the same nodes, in the same order, as
+ * the webvtt_node tree built for a cue with the same text.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_create_flat_tree( const char *text, webvtt_uint length,
+                         webvtt_flat_tree **ptree );
+
+WEBVTT_EXPORT void
+webvtt_delete_flat_tree( webvtt_flat_tree *tree );
+
+/**
+ * Text of 'range', a range of 'tree'.
+ */
+WEBVTT_EXPORT const char *
+webvtt_flat_text( const webvtt_flat_tree *tree,
+                  const webvtt_text_range *range );
+
+/**
+ * Prepare 'it' to iterate over the children of node 'parent' of 'tree'.
+ */
+WEBVTT_EXPORT void
+webvtt_flat_children( const webvtt_flat_tree *tree, webvtt_uint parent,
+                      webvtt_flat_iterator *it );
+
+/**
+ * Returns the next node of iterator 'it', or NULL once there are no more.
+ */
+WEBVTT_EXPORT const webvtt_flat_node *
+webvtt_flat_next( webvtt_flat_iterator *it );
+
 #if defined(__cplusplus) || defined(c_plusplus)
 }
 #endif
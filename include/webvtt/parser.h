@@ -48,20 +48,247 @@ typedef int ( WEBVTT_CALLBACK *webvtt_error_fn )( void *userdata,
 typedef void ( WEBVTT_CALLBACK *webvtt_cue_fn )( void *userdata,
                                                  webvtt_cue *cue );
 
+/**
+ * Receives cues 'count' at a time, if the parser was asked to deliver them in
+ * blocks with webvtt_set_parser_cues_fn(). As with webvtt_cue_fn, the
+ * application takes over the reference to each cue, but the array itself
+ * belongs to the parser and is reused for the next block.
+ */
+typedef void ( WEBVTT_CALLBACK *webvtt_cues_fn )( void *userdata,
+                                                  webvtt_cue **cues,
+                                                  webvtt_uint count );
+
+/**
+ * Options which can be combined and passed to webvtt_set_parser_options()
+ */
+typedef enum
+webvtt_parser_option_t {
+  /**
+   * Don't parse the cue-text of cues as they are read. Their 'node_head' is
+   * left NULL until it is asked for with webvtt_cue_get_nodes(), so that
+   * applications which only need the timings, settings and body of cues never
+   * pay for building node trees.
+   */
+  WEBVTT_PARSE_LAZY_CUETEXT = ( 1 << 0 )
+} webvtt_parser_option;
 
+/**
+ * webvtt_create_parser
+ *
+ * Create a parser which hands each cue it reads to 'on_read' and each error to
+ * 'on_error'. If 'on_read' is NULL, cues are instead taken from the parser
+ * with webvtt_parser_next_cue().
+ */
 WEBVTT_EXPORT webvtt_status
 webvtt_create_parser( webvtt_cue_fn on_read, webvtt_error_fn on_error,
                       void * userdata, webvtt_parser *ppout );
 
+/**
+ * webvtt_create_parser_with_arena
+ *
+ * Create a parser which allocates everything it creates while parsing (cues,
+ * nodes, strings and string lists) from slabs of 'slab_size' bytes (or a
+ * default size, if 0) owned by the parser, rather than from the global
+ * allocator. It is all released in one go by webvtt_delete_parser(), so
+ * releasing those objects individually is cheap but optional, and none of them
+ * may be used once the parser has been deleted.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_create_parser_with_arena( webvtt_cue_fn on_read,
+                                 webvtt_error_fn on_error, void *userdata,
+                                 webvtt_uint slab_size, webvtt_parser *ppout );
+
 WEBVTT_EXPORT void
 webvtt_delete_parser( webvtt_parser parser );
 
+/**
+ * webvtt_reset_parser
+ *
+ * Make 'self' ready to read another document, as if it had just been created
+ * with the same callbacks, userdata and options, but without giving back the
+ * memory it has already allocated for reading. Whatever is left of the
+ * document being read is dropped, including cues which were never taken with
+ * webvtt_parser_next_cue(), and its statistics start again from zero.
+ *
+ * Returns WEBVTT_NOT_SUPPORTED for a parser created with
+ * webvtt_create_parser_with_arena(), whose memory is only released when it is
+ * deleted.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_reset_parser( webvtt_parser self );
+
+/**
+ * webvtt_set_parser_options
+ *
+ * Replace the options of 'self' with 'options', a combination of
+ * webvtt_parser_option values. Options affect cues read after they are set.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_set_parser_options( webvtt_parser self, webvtt_uint options );
+
+WEBVTT_EXPORT webvtt_uint
+webvtt_get_parser_options( webvtt_parser self );
+
+/**
+ * webvtt_set_parser_cues_fn
+ *
+ * Deliver cues to 'on_cues' in blocks of up to 'block_size', rather than to
+ * the parser's webvtt_cue_fn one at a time. A block is delivered when it is
+ * full, and whatever has been collected is delivered before
+ * webvtt_parse_chunk() or webvtt_finish_parsing() return, so cues are never
+ * held back past the call which read them. Errors are still reported as they
+ * are found, so an error may be reported before a cue which came ahead of it.
+ *
+ * A NULL 'on_cues' goes back to delivering cues one at a time.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_set_parser_cues_fn( webvtt_parser self, webvtt_cues_fn on_cues,
+                           webvtt_uint block_size );
+
 WEBVTT_EXPORT webvtt_status
 webvtt_parse_chunk( webvtt_parser self, const void *buffer, webvtt_uint len );
 
 WEBVTT_EXPORT webvtt_status
 webvtt_finish_parsing( webvtt_parser self );
 
+/**
+ * webvtt_parser_next_cue
+ *
+ * Take the next cue from a parser created without a webvtt_cue_fn, which
+ * becomes the caller's to release.
+ *
+ * Such a parser stops reading a chunk at each cue it finishes, until that cue
+ * has been taken, and reads more of it here as cues are asked for. So the
+ * buffer passed to webvtt_parse_chunk() has to stay alive, and no other chunk
+ * may be passed, until this returns WEBVTT_UNFINISHED to ask for more input.
+ * Once the parser has been finished and every cue taken, this returns
+ * WEBVTT_SUCCESS with '*pcue' set to NULL. webvtt_finish_parsing() reads the
+ * rest of the last chunk straight away, so its cues wait to be taken.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_parser_next_cue( webvtt_parser self, webvtt_cue **pcue );
+
+/**
+ * What a parser has been through so far. These are kept for every parser, so
+ * that files which are unusually expensive to parse can be noticed in
+ * production.
+ *
+ * Allocations are counted while a parser function is running, callbacks
+ * included, so cues which the application releases later on are allocated
+ * but not freed as far as the parser is concerned.
+ */
+typedef struct
+webvtt_parser_stats_t {
+  webvtt_uint64 bytes; /* input read */
+  webvtt_uint lines; /* line breaks read (CR, LF or CR LF) */
+  webvtt_uint cues; /* cues handed to the application */
+  webvtt_uint dropped_cues; /* cues thrown away as invalid */
+  webvtt_uint errors[ WEBVTT_ERROR_COUNT ]; /* errors reported, by code */
+  webvtt_uint allocs;
+  webvtt_uint frees;
+  webvtt_uint live_bytes; /* allocated and not yet freed */
+  webvtt_uint peak_bytes; /* the most 'live_bytes' has been */
+  webvtt_uint string_grows; /* times a string had to grow its buffer */
+  webvtt_uint stack_depth; /* deepest the parse state stack has been */
+} webvtt_parser_stats;
+
+/**
+ * Copy the statistics of 'parser' into 'out'.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_parser_get_stats( webvtt_parser parser, webvtt_parser_stats *out );
+
+/**
+ * webvtt_parse_mapped_file
+ *
+ * Parse the whole document at 'path' and finish parsing.
+ *
+ * The document is memory-mapped (or, where that isn't possible, read into a
+ * single buffer), and the ids and payload text of the cues read from it share
+ * that memory rather than being copied, so the document stays mapped until the
+ * last such cue is released.
+ *
+ * Returns WEBVTT_UNSUCCESSFUL if the document can't be opened or read.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_parse_mapped_file( webvtt_parser self, const char *path );
+
+/**
+ * Parses one document in several shards, which can be parsed at the same time
+ * on different threads.
+ *
+ * The document is split at blank lines after the header, where the parser is
+ * nearly always in the same state, so each shard can be parsed on its own with
+ * a parser of its own. Cues and errors are held on to until
+ * webvtt_finish_sharded_parser(), which hands them to the callbacks in the
+ * order, and with the line numbers, that parsing the whole document with one
+ * parser would have given them. The few shards which follow a block the
+ * parser hadn't finished with are parsed again, in order, at that point.
+ */
+typedef struct webvtt_sharded_parser_t *webvtt_sharded_parser;
+
+/**
+ * webvtt_create_sharded_parser
+ *
+ * Split the 'length' bytes at 'buffer' into at most 'count' shards of roughly
+ * equal size. 'buffer' must stay alive until the parser is finished.
+ * 'options' are webvtt_parser_option flags for the parser of every shard.
+ *
+ * As errors are only reported once every shard is parsed, the parsers always
+ * carry on past them. If 'on_error' returns a negative value, the shard it was
+ * in is parsed again to stop at that error, the way a single parser would.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_create_sharded_parser( const char *buffer, webvtt_uint length,
+                              webvtt_uint count, webvtt_uint options,
+                              webvtt_cue_fn on_read, webvtt_error_fn on_error,
+                              void *userdata, webvtt_sharded_parser *ppout );
+
+WEBVTT_EXPORT void
+webvtt_delete_sharded_parser( webvtt_sharded_parser parser );
+
+/**
+ * webvtt_sharded_parser_count
+ *
+ * Number of shards the document was split into, which may be fewer than
+ * asked for.
+ */
+WEBVTT_EXPORT webvtt_uint
+webvtt_sharded_parser_count( webvtt_sharded_parser parser );
+
+/**
+ * webvtt_parse_shard
+ *
+ * Parse shard number 'index'. Different shards may be parsed on different
+ * threads at the same time, but each only once.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_parse_shard( webvtt_sharded_parser parser, webvtt_uint index );
+
+/**
+ * webvtt_finish_sharded_parser
+ *
+ * Once every shard has been parsed, report their cues and errors in order.
+ * Reporting stops at the first shard whose parse failed, as a single parser
+ * would have stopped there too, and its status is returned.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_finish_sharded_parser( webvtt_sharded_parser parser );
+
+/**
+ * webvtt_parse_timestamps
+ *
+ * Read the WebVTT timestamps ("HH:MM:SS.mmm" or "MM:SS.mmm") at the start of
+ * each of the 'n' NUL-terminated 'texts' into 'out', in milliseconds. Texts
+ * which don't start with a timestamp get 0xFFFFFFFFFFFFFFFF, and malformed but
+ * still readable ones (such as "1:2:3.4") get the time they describe.
+ *
+ * Returns the number of texts which started with a well-formed timestamp.
+ */
+WEBVTT_EXPORT webvtt_uint
+webvtt_parse_timestamps( const char **texts, webvtt_uint n,
+                         webvtt_timestamp *out );
+
 #if defined(__cplusplus) || defined(c_plusplus)
 }
 #endif
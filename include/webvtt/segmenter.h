@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __WEBVTT_SEGMENTER_H__
+# define __WEBVTT_SEGMENTER_H__
+# include "writer.h"
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+/**
+ * Splits a stream of cues into WebVTT documents covering consecutive windows
+ * of time, as used for HLS and DASH subtitle segments.
+ *
+ * Segment 'n' covers [n * duration, (n + 1) * duration). A cue is written to
+ * every segment it overlaps, with its own timings, so a cue which spans a
+ * boundary turns up in each of the segments on either side. Every segment is
+ * emitted, including empty ones, so that there are no gaps in the track. They
+ * are numbered from 0, or from webvtt_set_segmenter_first() on.
+ *
+ * Cues are expected in order of start time, as they are read by the parser,
+ * and only the cues which overlap the segment being built are held on to, so
+ * memory use is bounded by the size of one segment. Cues from a parser with an
+ * arena must be done with before the parser is deleted, like anything else it
+ * created.
+ */
+typedef struct webvtt_segmenter_t *webvtt_segmenter;
+
+/**
+ * Receives each finished segment. 'text' is only valid for the duration of
+ * the call. Anything other than WEBVTT_SUCCESS stops the segmenter, and is
+ * returned by whatever it was doing.
+ */
+typedef webvtt_status ( WEBVTT_CALLBACK *webvtt_segment_fn )(
+  void *userdata, webvtt_uint64 index, webvtt_timestamp start,
+  webvtt_timestamp end, const char *text, webvtt_uint length );
+
+/**
+ * webvtt_create_segmenter
+ *
+ * 'duration' is the target length of a segment, in milliseconds. 'options'
+ * are passed along to webvtt_write_cue().
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_create_segmenter( webvtt_timestamp duration, webvtt_uint options,
+                         webvtt_segment_fn on_segment, void *userdata,
+                         webvtt_segmenter *ppout );
+
+/**
+ * webvtt_delete_segmenter
+ *
+ * Release the segmenter and the cues it holds. Anything which has not been
+ * emitted yet is discarded, so call webvtt_finish_segmenter() first.
+ */
+WEBVTT_EXPORT void
+webvtt_delete_segmenter( webvtt_segmenter segmenter );
+
+/**
+ * webvtt_set_segmenter_timestamp_map
+ *
+ * Start every segment with an "X-TIMESTAMP-MAP=MPEGTS:<mpegts>,LOCAL:<local>"
+ * header, mapping cue times onto the 90kHz clock of the media stream.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_set_segmenter_timestamp_map( webvtt_segmenter segmenter,
+                                    webvtt_uint64 mpegts,
+                                    webvtt_timestamp local );
+
+/**
+ * webvtt_set_segmenter_first
+ *
+ * Emit segments from segment 'index' on rather than from segment 0, for a
+ * stream which is joined part way through. Cues which end before it are
+ * dropped like any other late cue. This has to be done before any cue is
+ * added or anything is emitted, or it fails with WEBVTT_INVALID_PARAM.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_set_segmenter_first( webvtt_segmenter segmenter, webvtt_uint64 index );
+
+/**
+ * webvtt_segment_cue
+ *
+ * Add 'cue' to the segments it overlaps, emitting the segments which end at
+ * or before its start time first. The segmenter takes its own reference to
+ * 'cue', so it is safe to call this from a webvtt_cue_fn and then release
+ * the cue.
+ *
+ * A cue which starts before the segment being built is still written to it if
+ * it overlaps it, but one which ended before it can't be, and is dropped with
+ * WEBVTT_UNSUCCESSFUL.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_segment_cue( webvtt_segmenter segmenter, webvtt_cue *cue );
+
+/**
+ * webvtt_finish_segmenter
+ *
+ * Emit the segment being built, and then as many more as it takes to cover
+ * the cues which run past its end. Cues added after this carry on from the
+ * following segment.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_finish_segmenter( webvtt_segmenter segmenter );
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,199 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __WEBVTT_TRACK_H__
+# define __WEBVTT_TRACK_H__
+# include "util.h"
+# include <webvtt/cue.h>
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+/**
+ * A collection of cues indexed by time, to find the cues which are active at
+ * a given time (or during a given range) without looking at all of them.
+ *
+ * Cues are kept in one array sorted in text track cue order (by start time,
+ * then latest end time first, then the order they were added in) which also
+ * serves as an implicit binary search tree, with each node holding the latest
+ * end time in its subtree. A lookup takes O(log n + k) time for k results,
+ * and never allocates.
+ *
+ * The index is brought up to date by the first lookup after cues are added,
+ * so a track can only be shared between threads once that has happened. The
+ * timings of a cue must not be changed while it is in a track.
+ */
+typedef struct webvtt_cue_track_t *webvtt_cue_track;
+
+WEBVTT_EXPORT webvtt_status
+webvtt_create_cue_track( webvtt_cue_track *ppout );
+
+/**
+ * webvtt_delete_cue_track
+ *
+ * Release the track and its references to the cues in it.
+ */
+WEBVTT_EXPORT void
+webvtt_delete_cue_track( webvtt_cue_track track );
+
+/**
+ * webvtt_cue_track_add
+ *
+ * Add 'cue' to the track, which takes a reference to it. Adding cues in
+ * order of start time, as the parser reads them, saves sorting them again.
+ * Cues which end before they start are refused with WEBVTT_INVALID_PARAM.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_cue_track_add( webvtt_cue_track track, webvtt_cue *cue );
+
+WEBVTT_EXPORT webvtt_uint
+webvtt_cue_track_count( webvtt_cue_track track );
+
+/**
+ * webvtt_cue_track_get
+ *
+ * Return the cue at 'index' in text track cue order, or NULL if there is no
+ * such cue.
+ */
+WEBVTT_EXPORT webvtt_cue *
+webvtt_cue_track_get( webvtt_cue_track track, webvtt_uint index );
+
+/**
+ * webvtt_cue_track_active
+ *
+ * Find the cues which are active at 'time', that is, whose start time is no
+ * later and whose end time is later than 'time'. Up to 'max' of them are
+ * stored at 'out' in text track cue order, and the number found is returned,
+ * which may be more than 'max'.
+ */
+WEBVTT_EXPORT webvtt_uint
+webvtt_cue_track_active( webvtt_cue_track track, webvtt_timestamp time,
+                         webvtt_cue **out, webvtt_uint max );
+
+/**
+ * webvtt_cue_track_overlapping
+ *
+ * Same as webvtt_cue_track_active(), but finds the cues which are active at
+ * any time in [from, until).
+ */
+WEBVTT_EXPORT webvtt_uint
+webvtt_cue_track_overlapping( webvtt_cue_track track, webvtt_timestamp from,
+                              webvtt_timestamp until, webvtt_cue **out,
+                              webvtt_uint max );
+
+/**
+ * Follows a track as playback moves forward, reporting the cues which enter
+ * and leave the active set (and, optionally, the timestamps inside cue-text
+ * which are reached) since the last time it was moved. Moving forward costs
+ * O(1) per event; seeking costs O(log n).
+ *
+ * A cursor must be deleted before its track. Cues added to the track after
+ * the cursor last moved are taken into account the next time it moves. Those
+ * which are active where the cursor was are reported as entering before
+ * anything else, so every cue which exits has been entered first, unless it
+ * was already active where the cursor was seeked to. Catching up rebuilds
+ * the orderings of the whole track, which costs O(n log n) however few cues
+ * were added, so cues are best added in batches between moves.
+ */
+typedef struct webvtt_cue_cursor_t *webvtt_cue_cursor;
+
+typedef enum
+webvtt_cue_event_type_t {
+  /**
+   * 'time' is the start time of the cue
+   */
+  WEBVTT_CUE_ENTER,
+  /**
+   * 'time' is the end time of the cue
+   */
+  WEBVTT_CUE_EXIT,
+  /**
+   * 'time' is that of a WEBVTT_TIME_STAMP node in the cue-text of the cue,
+   * which is active
+   */
+  WEBVTT_CUE_TIMESTAMP
+} webvtt_cue_event_type;
+
+/**
+ * Options which can be combined and passed to webvtt_create_cue_cursor()
+ */
+typedef enum
+webvtt_cue_cursor_option_t {
+  /**
+   * Report WEBVTT_CUE_TIMESTAMP events, for karaoke-style cue-text. This
+   * builds the flat tree of every cue in the track.
+   */
+  WEBVTT_CURSOR_TIMESTAMPS = ( 1 << 0 )
+} webvtt_cue_cursor_option;
+
+/**
+ * Receives events in order of time. Anything other than WEBVTT_SUCCESS stops
+ * webvtt_advance_cue_cursor() right after the event, and is returned by it.
+ */
+typedef webvtt_status ( WEBVTT_CALLBACK *webvtt_cue_event_fn )(
+  void *userdata, webvtt_cue_event_type type, webvtt_timestamp time,
+  webvtt_cue *cue );
+
+/**
+ * webvtt_create_cue_cursor
+ *
+ * Create a cursor on 'track' from before the first cue, so that advancing it
+ * to any time reports every cue which starts by then.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_create_cue_cursor( webvtt_cue_track track, webvtt_uint options,
+                          webvtt_cue_cursor *ppout );
+
+WEBVTT_EXPORT void
+webvtt_delete_cue_cursor( webvtt_cue_cursor cursor );
+
+/**
+ * webvtt_advance_cue_cursor
+ *
+ * Move the cursor forward to 'time', passing every cue which started and
+ * every cue which ended by then to 'on_event', including cues which started
+ * and ended in between. Moving backwards fails with WEBVTT_INVALID_PARAM;
+ * seek instead.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_advance_cue_cursor( webvtt_cue_cursor cursor, webvtt_timestamp time,
+                           webvtt_cue_event_fn on_event, void *userdata );
+
+/**
+ * webvtt_seek_cue_cursor
+ *
+ * Move the cursor to 'time' in either direction without reporting anything.
+ * webvtt_cue_track_active() gives the cues which are active there.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_seek_cue_cursor( webvtt_cue_cursor cursor, webvtt_timestamp time );
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif
@@ -155,15 +155,15 @@ extern "C" {
                                                       void *pmem );
 
   /**
-   * Allocation functions. webvtt_set_allocator() should really be the first
-   * function called. However, it will do nothing (and not report error) if
-   * objects have already been allocated and not freed. Therefore, it is NOT
-   * safe to assume that it worked and use the supplied
-   * function pointers directly.
+   * Allocation functions. Every block remembers the allocator it came from and
+   * is always given back to it, so webvtt_set_allocator() can be called at any
+   * time; it affects only allocations made after it returns.
    *
-   * Currently, set_allocator (and the other allocation functions) do not use
-   * any locking mechanism, so the library cannot be considered to be
-   * thread-safe at this time if changing the allocator is used.
+   * webvtt_set_allocator() replaces the allocator used by all threads, and
+   * must not be called while other threads are allocating.
+   * webvtt_set_thread_allocator() replaces it for the calling thread only
+   * (passing NULL callbacks reverts to the process-wide allocator), which lets
+   * each worker thread use its own allocator without any locking.
    *
    * I don't believe there is much of a reason to worry about the overhead of
    * using function pointers for allocation, as it is negligible compared to the
@@ -244,6 +244,12 @@ extern "C" {
 
   typedef enum webvtt_status_t webvtt_status;
 
+  /**
+   * See webvtt_set_allocator(), above.
+   */
+  WEBVTT_EXPORT webvtt_status webvtt_set_thread_allocator(
+    webvtt_alloc_fn_ptr alloc, webvtt_free_fn_ptr free, void *userdata );
+
   /**
    * Macros to filter out webvtt status returns.
    */
@@ -268,14 +274,46 @@ extern "C" {
 # define WEBVTT_REF_INIT(Value) { (Value) }
 
   /**
-   * TODO: Replace these with atomic instructions for systems that provide it
+   * Reference counts are updated atomically, so that objects can be shared
+   * between threads (for instance, a cue handed from the parsing thread to a
+   * rendering thread with webvtt_ref_cue()). Taking a reference needs no
+   * ordering, but dropping one has to make prior writes to the object visible
+   * to whichever thread ends up freeing it. Reading a count, to find out
+   * whether an object is shared before writing to it, has to see the writes
+   * of the threads which dropped their references.
+   *
+   * Single-threaded applications can define WEBVTT_NO_ATOMIC_REFCOUNT (or
+   * configure with --disable-atomic-refcount) to use plain increments and
+   * decrements instead.
    */
+# if !defined(WEBVTT_ATOMIC_INC) && !defined(WEBVTT_NO_ATOMIC_REFCOUNT)
+#   if WEBVTT_CC_MSVC
+#     include <intrin.h>
+#     define WEBVTT_ATOMIC_INC(x) ( _InterlockedIncrement( &(x) ) )
+#     define WEBVTT_ATOMIC_DEC(x) ( _InterlockedDecrement( &(x) ) )
+#     define WEBVTT_ATOMIC_LOAD(x) ( _InterlockedOr( &(x), 0 ) )
+#   elif defined(__ATOMIC_RELAXED)
+#     define WEBVTT_ATOMIC_INC(x) \
+        ( __atomic_add_fetch( &(x), 1, __ATOMIC_RELAXED ) )
+#     define WEBVTT_ATOMIC_DEC(x) \
+        ( __atomic_sub_fetch( &(x), 1, __ATOMIC_ACQ_REL ) )
+#     define WEBVTT_ATOMIC_LOAD(x) \
+        ( __atomic_load_n( &(x), __ATOMIC_ACQUIRE ) )
+#   elif WEBVTT_CC_GCC
+#     define WEBVTT_ATOMIC_INC(x) ( __sync_add_and_fetch( &(x), 1 ) )
+#     define WEBVTT_ATOMIC_DEC(x) ( __sync_sub_and_fetch( &(x), 1 ) )
+#     define WEBVTT_ATOMIC_LOAD(x) ( __sync_fetch_and_add( &(x), 0 ) )
+#   endif
+# endif
 # ifndef WEBVTT_ATOMIC_INC
 #   define WEBVTT_ATOMIC_INC(x) ( ++(x) )
 # endif
 # ifndef WEBVTT_ATOMIC_DEC
 #   define WEBVTT_ATOMIC_DEC(x) ( --(x) )
 # endif
+# ifndef WEBVTT_ATOMIC_LOAD
+#   define WEBVTT_ATOMIC_LOAD(x) ( x )
+# endif
 
 # if defined(WEBVTT_INLINE)
   static WEBVTT_INLINE int webvtt_ref( struct webvtt_refcount_t *ref )
@@ -286,9 +324,14 @@ extern "C" {
   {
     return WEBVTT_ATOMIC_DEC(ref->value);
   }
+  static WEBVTT_INLINE int webvtt_ref_count( struct webvtt_refcount_t *ref )
+  {
+    return WEBVTT_ATOMIC_LOAD(ref->value);
+  }
 # else
 #   define webvtt_inc_ref(ref) ( WEBVTT_ATOMIC_INC((ref)->value) )
 #   define webvtt_dec_ref(ref) ( WEBVTT_ATOMIC_DEC((ref)->value) )
+#   define webvtt_ref_count(ref) ( WEBVTT_ATOMIC_LOAD((ref)->value) )
 # endif
 
 #if defined(__cplusplus) || defined(c_plusplus)
@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __WEBVTT_WRITER_H__
+# define __WEBVTT_WRITER_H__
+# include "util.h"
+# include <webvtt/cue.h>
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+/**
+ * Longest text webvtt_format_timestamp() can produce, including the NUL.
+ */
+#define WEBVTT_MAX_TIMESTAMP_LENGTH 24
+
+/**
+ * Receives written text, a piece at a time. Anything other than
+ * WEBVTT_SUCCESS stops the writer, and is returned by whatever it was doing.
+ */
+typedef webvtt_status ( WEBVTT_CALLBACK *webvtt_write_fn )( void *userdata,
+                                                            const char *text,
+                                                            webvtt_uint length );
+
+/**
+ * Options which can be combined and passed to webvtt_write_cue() and
+ * webvtt_write_document()
+ */
+typedef enum
+webvtt_write_option_t {
+  /**
+   * Write cue-text from the 'node_head' tree of cues that have one, rather
+   * than their 'body'.
+   */
+  WEBVTT_WRITE_NODES = ( 1 << 0 )
+} webvtt_write_option;
+
+/**
+ * Where written text goes. Set one up with webvtt_init_writer(); all fields
+ * are read-only after that.
+ */
+typedef struct
+webvtt_writer_t {
+  webvtt_write_fn sink;
+  void *userdata;
+  char *buffer;
+  webvtt_uint size;
+  /**
+   * Number of bytes of 'buffer' in use
+   */
+  webvtt_uint length;
+  /**
+   * Number of bytes written so far, including any which did not fit in the
+   * buffer of a writer without a sink
+   */
+  webvtt_uint total;
+  /**
+   * First failure, after which nothing more is written
+   */
+  webvtt_status status;
+} webvtt_writer;
+
+/**
+ * webvtt_init_writer
+ *
+ * Without a 'sink', text is written to the 'size' bytes at 'buffer', and
+ * writing fails with WEBVTT_OUT_OF_MEMORY once they run out, although 'total'
+ * goes on counting how many bytes would have been needed.
+ *
+ * With a 'sink', 'buffer' (which may be NULL) only collects text to be handed
+ * to the sink in larger pieces. webvtt_flush_writer() hands over what's left.
+ *
+ * Writers never allocate memory of their own.
+ */
+WEBVTT_EXPORT void
+webvtt_init_writer( webvtt_writer *writer, char *buffer, webvtt_uint size,
+                    webvtt_write_fn sink, void *userdata );
+
+WEBVTT_EXPORT webvtt_status
+webvtt_flush_writer( webvtt_writer *writer );
+
+/**
+ * webvtt_format_timestamp
+ *
+ * Write 'ts' as "HH:MM:SS.mmm" (with more digits of hours if need be) and a
+ * NUL to 'out', which must have room for WEBVTT_MAX_TIMESTAMP_LENGTH bytes.
+ * Returns the length of the text.
+ */
+WEBVTT_EXPORT webvtt_uint
+webvtt_format_timestamp( webvtt_timestamp ts, char *out );
+
+/**
+ * webvtt_write_text
+ *
+ * Write 'length' bytes of 'text' as they are, such as extra header lines.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_write_text( webvtt_writer *writer, const char *text,
+                   webvtt_uint length );
+
+/**
+ * webvtt_write_header
+ *
+ * Write the "WEBVTT" signature line and the blank line after it.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_write_header( webvtt_writer *writer );
+
+/**
+ * webvtt_write_cue
+ *
+ * Write 'cue' as a cue block: its id (if it has one), timings, the settings
+ * which differ from their defaults (or were given explicitly), its cue-text,
+ * and a blank line.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_write_cue( webvtt_writer *writer, const webvtt_cue *cue,
+                  webvtt_uint options );
+
+/**
+ * webvtt_write_document
+ *
+ * Write a whole document made of the 'count' cues at 'cues', and flush the
+ * writer.
+ */
+WEBVTT_EXPORT webvtt_status
+webvtt_write_document( webvtt_writer *writer, webvtt_cue *const *cues,
+                       webvtt_uint count, webvtt_uint options );
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif
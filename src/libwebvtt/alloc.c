@@ -25,23 +25,105 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <webvtt/util.h>
+#include "alloc_internal.h"
 #include <stdlib.h>
 #include <string.h>
 
-static void *default_alloc( void *unused, webvtt_uint nb );
-static void default_free( void *unused, void *ptr );
+/**
+ * Allocator state which is not shared between threads
+ */
+#if WEBVTT_CC_MSVC
+# define WEBVTT_THREAD_LOCAL __declspec(thread)
+#elif WEBVTT_CC_GCC
+# define WEBVTT_THREAD_LOCAL __thread
+#else
+  /* No thread-local storage: arenas and thread allocators are process-wide */
+# define WEBVTT_THREAD_LOCAL
+#endif
 
-struct {
-  /**
-   * Number of allocated objects. Forbid changing the allocator if this is not
-   * equal to 0 
-   */
-  webvtt_uint n_alloc;
+typedef struct webvtt_heap_t webvtt_heap;
+
+/**
+ * Every block is preceded by a header recording the heap it was allocated
+ * from, so that webvtt_free() can give it back to the right place no matter
+ * which allocator is in use by then, and its size, for webvtt_alloc_stats. The
+ * union keeps the blocks suitably aligned.
+ */
+typedef struct {
+  webvtt_heap *heap;
+  webvtt_uint size;
+} block_info;
+
+typedef union {
+  block_info info;
+  void *align_ptr;
+  double align_double;
+  webvtt_uint64 align_uint64;
+} block_header;
+
+/**
+ * Something blocks can be allocated from: either a set of user (or default)
+ * allocation callbacks, or an arena.
+ */
+struct webvtt_heap_t {
+  void ( *release )( webvtt_heap *heap, block_header *block );
+};
+
+typedef struct {
+  webvtt_heap heap;
   webvtt_alloc_fn_ptr alloc;
   webvtt_free_fn_ptr free;
   void *alloc_data;
-} allocator = { 0, default_alloc, default_free, 0 };
+  /**
+   * One reference for each live block, plus one while it is installed. Once
+   * the last goes away, the allocator frees itself. The default allocator is
+   * never freed, so it doesn't count its blocks, and threads using it never
+   * contend on the counter.
+   */
+  struct webvtt_refcount_t refs;
+} fn_allocator;
+
+typedef struct webvtt_slab_t {
+  struct webvtt_slab_t *next;
+  webvtt_uint size;
+  webvtt_uint used;
+  /* offset of the most recent allocation */
+  webvtt_uint last;
+  block_header data[1];
+} webvtt_slab;
+
+struct webvtt_arena_t {
+  webvtt_heap heap;
+  webvtt_uint slab_size;
+  webvtt_slab *slabs;
+};
+
+static void *default_alloc( void *unused, webvtt_uint nb );
+static void default_free( void *unused, void *ptr );
+static void fn_release( webvtt_heap *heap, block_header *block );
+static void arena_release( webvtt_heap *heap, block_header *block );
+
+static fn_allocator default_allocator = {
+  { &fn_release }, &default_alloc, &default_free, 0, WEBVTT_REF_INIT(1)
+};
+
+/**
+ * Allocator used by threads which haven't installed their own.
+ */
+static fn_allocator *global_allocator = &default_allocator;
+
+static WEBVTT_THREAD_LOCAL fn_allocator *thread_allocator = 0;
+
+/**
+ * Arena which webvtt_alloc() currently allocates from on this thread, if any.
+ */
+static WEBVTT_THREAD_LOCAL webvtt_arena *current_arena = 0;
+
+/**
+ * Counters which webvtt_alloc() and webvtt_free() currently report to on this
+ * thread, if any.
+ */
+static WEBVTT_THREAD_LOCAL webvtt_alloc_stats *current_stats = 0;
 
 static void *WEBVTT_CALLBACK
 default_alloc( void *unused, webvtt_uint nb )
@@ -57,47 +139,258 @@ default_free( void *unused, void *ptr )
   free( ptr );
 }
 
+static void
+unref_allocator( fn_allocator *a )
+{
+  if( a && a != &default_allocator && webvtt_deref( &a->refs ) == 0 ) {
+    a->free( a->alloc_data, a );
+  }
+}
+
+/**
+ * Create allocator state for a set of callbacks, or return the default one if
+ * none are given.
+ */
+static fn_allocator *
+create_allocator( webvtt_alloc_fn_ptr alloc, webvtt_free_fn_ptr free,
+                  void *userdata )
+{
+  fn_allocator *a;
+  if( !alloc ) {
+    return &default_allocator;
+  }
+  if( !( a = ( fn_allocator * )alloc( userdata, sizeof *a ) ) ) {
+    return 0;
+  }
+  a->heap.release = &fn_release;
+  a->alloc = alloc;
+  a->free = free;
+  a->alloc_data = userdata;
+  a->refs.value = 1;
+  return a;
+}
+
 WEBVTT_EXPORT void
 webvtt_set_allocator( webvtt_alloc_fn_ptr alloc, webvtt_free_fn_ptr free,
                       void *userdata )
 {
+  fn_allocator *a, *previous;
+  if( !alloc != !free ) {
+    return;
+  }
   /**
-   * TODO:
-   * This really needs a lock. But then, so does all the allocation/free
-   * functions...
-   * that could be a problem.
+   * Blocks which are already allocated know which allocator they came from, so
+   * it is always safe to switch.
    */
-  if( allocator.n_alloc == 0 ) {
-    if( alloc && free ) {
-      allocator.alloc = alloc;
-      allocator.free = free;
-      allocator.alloc_data = userdata;
-    } else if( !alloc && !free ) {
-      allocator.alloc = &default_alloc;
-      allocator.free = &default_free;
-      allocator.alloc_data = 0;
+  if( ( a = create_allocator( alloc, free, userdata ) ) ) {
+    previous = global_allocator;
+    global_allocator = a;
+    unref_allocator( previous );
+  }
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_set_thread_allocator( webvtt_alloc_fn_ptr alloc,
+                             webvtt_free_fn_ptr free, void *userdata )
+{
+  fn_allocator *a = 0;
+  if( !alloc != !free ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  if( alloc && !( a = create_allocator( alloc, free, userdata ) ) ) {
+    return WEBVTT_OUT_OF_MEMORY;
+  }
+  unref_allocator( thread_allocator );
+  thread_allocator = a;
+  return WEBVTT_SUCCESS;
+}
+
+static void *
+fn_alloc( fn_allocator *a, webvtt_uint nb )
+{
+  block_header *ret;
+  if( nb > ( webvtt_uint )-1 - sizeof( block_header ) ) {
+    return 0;
+  }
+  ret = ( block_header * )a->alloc( a->alloc_data,
+                                    nb + sizeof( block_header ) );
+  if( !ret ) {
+    return 0;
+  }
+  if( a != &default_allocator ) {
+    webvtt_ref( &a->refs );
+  }
+  ret->info.heap = &a->heap;
+  ret->info.size = nb;
+  return ret + 1;
+}
+
+static void
+fn_release( webvtt_heap *heap, block_header *block )
+{
+  fn_allocator *a = ( fn_allocator * )heap;
+  a->free( a->alloc_data, block );
+  unref_allocator( a );
+}
+
+static void *
+global_alloc( webvtt_uint nb )
+{
+  return fn_alloc( thread_allocator ? thread_allocator : global_allocator, nb );
+}
+
+static void *
+arena_alloc( webvtt_arena *arena, webvtt_uint nb )
+{
+  webvtt_slab *slab = arena->slabs;
+  block_header *ret;
+  webvtt_uint need;
+
+  if( nb > ( webvtt_uint )-1 - 2 * sizeof( block_header ) - sizeof *slab ) {
+    return 0;
+  }
+  /* Round up to keep the next block aligned */
+  need = sizeof( block_header ) + ( ( nb + sizeof( block_header ) - 1 ) /
+         sizeof( block_header ) ) * sizeof( block_header );
+
+  if( !slab || slab->size - slab->used < need ) {
+    webvtt_uint size = need > arena->slab_size ? need : arena->slab_size;
+    webvtt_slab *s = ( webvtt_slab * )global_alloc( sizeof *s -
+                                                    sizeof( s->data ) + size );
+    if( !s ) {
+      return 0;
+    }
+    s->size = size;
+    s->used = s->last = 0;
+    if( slab && need > arena->slab_size / 2 ) {
+      /**
+       * Big blocks get a slab of their own, behind the current one, so that
+       * what's left of the current slab doesn't go to waste.
+       */
+      s->next = slab->next;
+      slab->next = s;
+    } else {
+      s->next = slab;
+      arena->slabs = s;
     }
+    slab = s;
+  }
+
+  ret = ( block_header * )( ( char * )slab->data + slab->used );
+  slab->last = slab->used;
+  slab->used += need;
+  ret->info.heap = &arena->heap;
+  ret->info.size = nb;
+  return ret + 1;
+}
+
+static void
+arena_release( webvtt_heap *heap, block_header *block )
+{
+  webvtt_slab *slab = ( ( webvtt_arena * )heap )->slabs;
+  /* Only the most recent allocation can be given back */
+  if( slab && slab->used != slab->last &&
+      ( char * )block == ( char * )slab->data + slab->last ) {
+    slab->used = slab->last;
+  }
+}
+
+WEBVTT_INTERN webvtt_status
+webvtt_create_arena( webvtt_uint slab_size, webvtt_arena **ppout )
+{
+  webvtt_arena *arena;
+  if( !ppout ) {
+    return WEBVTT_INVALID_PARAM;
   }
+  if( !( arena = ( webvtt_arena * )global_alloc( sizeof *arena ) ) ) {
+    return WEBVTT_OUT_OF_MEMORY;
+  }
+  arena->heap.release = &arena_release;
+  arena->slab_size = slab_size ? slab_size : WEBVTT_ARENA_SLAB_SIZE;
+  arena->slabs = 0;
+  *ppout = arena;
+  return WEBVTT_SUCCESS;
+}
+
+WEBVTT_INTERN void
+webvtt_delete_arena( webvtt_arena *arena )
+{
+  webvtt_slab *slab, *next;
+  if( !arena ) {
+    return;
+  }
+  if( current_arena == arena ) {
+    current_arena = 0;
+  }
+  for( slab = arena->slabs; slab; slab = next ) {
+    next = slab->next;
+    webvtt_free( slab );
+  }
+  webvtt_free( arena );
+}
+
+WEBVTT_INTERN webvtt_arena *
+webvtt_use_arena( webvtt_arena *arena )
+{
+  webvtt_arena *previous = current_arena;
+  current_arena = arena;
+  return previous;
+}
+
+WEBVTT_INTERN webvtt_arena *
+webvtt_arena_of( const void *data )
+{
+  const block_header *block;
+  if( !data ) {
+    return 0;
+  }
+  block = ( const block_header * )data - 1;
+  if( block->info.heap->release != &arena_release ) {
+    return 0;
+  }
+  return ( webvtt_arena * )block->info.heap;
 }
 
 /**
  * public alloc/dealloc functions
  */
+WEBVTT_INTERN webvtt_alloc_stats *
+webvtt_use_alloc_stats( webvtt_alloc_stats *stats )
+{
+  webvtt_alloc_stats *previous = current_stats;
+  current_stats = stats;
+  return previous;
+}
+
+WEBVTT_INTERN void
+webvtt_count_string_grow( void )
+{
+  if( current_stats ) {
+    ++current_stats->string_grows;
+  }
+}
+
 WEBVTT_EXPORT void *
 webvtt_alloc( webvtt_uint nb )
 {
-  void *ret = allocator.alloc( allocator.alloc_data, nb );
-  if( ret )
-  { ++allocator.n_alloc; }
+  void *ret = current_arena ? arena_alloc( current_arena, nb )
+                            : global_alloc( nb );
+  webvtt_alloc_stats *stats = current_stats;
+  if( ret && stats ) {
+    ++stats->allocs;
+    stats->live_bytes += nb;
+    if( stats->live_bytes > stats->peak_bytes ) {
+      stats->peak_bytes = stats->live_bytes;
+    }
+  }
   return ret;
 }
 
 WEBVTT_EXPORT void *
 webvtt_alloc0( webvtt_uint nb )
 {
-  void *ret = allocator.alloc( allocator.alloc_data, nb );
+  void *ret = webvtt_alloc( nb );
   if( ret ) {
-    ++allocator.n_alloc;
     memset( ret, 0, nb );
   }
   return ret;
@@ -106,8 +399,20 @@ webvtt_alloc0( webvtt_uint nb )
 WEBVTT_EXPORT void
 webvtt_free( void *data )
 {
-  if( data && allocator.n_alloc ) {
-    allocator.free( allocator.alloc_data, data );
-    --allocator.n_alloc;
+  webvtt_alloc_stats *stats;
+  block_header *block;
+  if( !data ) {
+    return;
+  }
+  block = ( block_header * )data - 1;
+  if( ( stats = current_stats ) ) {
+    ++stats->frees;
+    /* Blocks allocated before counting began may take it below zero */
+    if( block->info.size < stats->live_bytes ) {
+      stats->live_bytes -= block->info.size;
+    } else {
+      stats->live_bytes = 0;
+    }
   }
+  block->info.heap->release( block->info.heap, block );
 }
@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INTERN_ALLOC_H__
+# define __INTERN_ALLOC_H__
+# include <webvtt/util.h>
+
+/**
+ * Default size of the slabs an arena carves allocations from.
+ */
+# ifndef WEBVTT_ARENA_SLAB_SIZE
+#   define WEBVTT_ARENA_SLAB_SIZE 0x10000
+# endif
+
+typedef struct webvtt_arena_t webvtt_arena;
+
+/**
+ * Arenas hand out memory by bumping a pointer through large slabs, and give it
+ * all back at once when the arena is deleted. Freeing a block allocated from an
+ * arena does nothing, unless it is the most recent allocation, in which case
+ * its space is reused.
+ *
+ * While an arena is in use (see webvtt_use_arena()), webvtt_alloc() and
+ * webvtt_alloc0() allocate from it. webvtt_free() always returns a block to
+ * wherever it was allocated from.
+ */
+WEBVTT_INTERN webvtt_status webvtt_create_arena( webvtt_uint slab_size,
+                                                 webvtt_arena **ppout );
+WEBVTT_INTERN void webvtt_delete_arena( webvtt_arena *arena );
+
+/**
+ * Make 'arena' (or the global allocator, if it is NULL) the source of all
+ * subsequent allocations. Returns the arena which was previously in use, so
+ * that it can be restored.
+ */
+WEBVTT_INTERN webvtt_arena *webvtt_use_arena( webvtt_arena *arena );
+
+/**
+ * The arena which 'data' (a block returned by webvtt_alloc()) was allocated
+ * from, or NULL if it came from an allocator.
+ */
+WEBVTT_INTERN webvtt_arena *webvtt_arena_of( const void *data );
+
+/**
+ * Allocation counters, which are bumped while they are in use (see
+ * webvtt_use_alloc_stats()). Sizes are what was asked for, not counting the
+ * allocator's own overhead.
+ */
+typedef struct
+webvtt_alloc_stats_t {
+  webvtt_uint allocs;
+  webvtt_uint frees;
+  webvtt_uint live_bytes;
+  webvtt_uint peak_bytes;
+  webvtt_uint string_grows;
+} webvtt_alloc_stats;
+
+/**
+ * Count every webvtt_alloc() and webvtt_free() on this thread in 'stats' (or
+ * stop counting, if it is NULL). Returns the counters which were previously in
+ * use, so that they can be restored.
+ */
+WEBVTT_INTERN webvtt_alloc_stats *
+webvtt_use_alloc_stats( webvtt_alloc_stats *stats );
+
+/**
+ * Count a webvtt_string having to grow its buffer
+ */
+WEBVTT_INTERN void webvtt_count_string_grow( void );
+
+#endif
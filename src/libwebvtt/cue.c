@@ -28,6 +28,8 @@
 #include <string.h>
 #include "parser_internal.h"
 #include "cue_internal.h"
+#include "cuetext_internal.h"
+#include "scan_internal.h"
 
 WEBVTT_EXPORT webvtt_status
 webvtt_create_cue( webvtt_cue **pcue )
@@ -87,6 +89,7 @@ webvtt_release_cue( webvtt_cue **pcue )
       webvtt_release_string( &cue->id );
       webvtt_release_string( &cue->body );
       webvtt_release_node( &cue->node_head );
+      webvtt_delete_flat_tree( cue->flat_tree );
       webvtt_free( cue );
     }
   }
@@ -119,16 +122,123 @@ error:
   return 0;
 }
 
+WEBVTT_EXPORT webvtt_status
+webvtt_cue_get_nodes( webvtt_cue *cue, webvtt_node **pnode )
+{
+  webvtt_status status = WEBVTT_SUCCESS;
+  webvtt_arena *previous;
+
+  if( !cue || !pnode ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  if( !cue->node_head ) {
+    /**
+     * The nodes live wherever the cue does, so that a cue from an arena
+     * parser never holds on to anything that would outlive the arena.
+     */
+    previous = webvtt_use_arena( webvtt_arena_of( cue ) );
+    status = webvtt_parse_cuetext( 0, cue, &cue->body, 1 );
+    webvtt_use_arena( previous );
+  }
+
+  *pnode = cue->node_head;
+  return status;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_cue_get_flat_tree( webvtt_cue *cue, const webvtt_flat_tree **ptree )
+{
+  webvtt_status status = WEBVTT_SUCCESS;
+  webvtt_arena *previous;
+
+  if( !cue || !ptree ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  if( !cue->flat_tree ) {
+    previous = webvtt_use_arena( webvtt_arena_of( cue ) );
+    status = webvtt_create_flat_tree( webvtt_string_text( &cue->body ),
+                                      webvtt_string_length( &cue->body ),
+                                      &cue->flat_tree );
+    webvtt_use_arena( previous );
+  }
+
+  *ptree = cue->flat_tree;
+  return status;
+}
+
 WEBVTT_INTERN webvtt_bool
 cue_is_incomplete( const webvtt_cue *cue ) {
   return !cue || ( cue->flags & CUE_HEADER_MASK ) == CUE_HAVE_ID;
 }
 
-WEBVTT_EXPORT webvtt_status
-webvtt_cue_set_align( webvtt_cue *cue, const char *value )
+/**
+ * The setters below all work on a value of 'length' bytes, which need not be
+ * NUL-terminated, so that settings can be read straight out of the cue line.
+ */
+typedef webvtt_status ( *setting_fn )( webvtt_cue *cue, const char *value,
+                                       webvtt_uint length );
+
+/**
+ * Index of the word in 'words' which is the same as the 'length' bytes at
+ * 'value', or -1 if there isn't one.
+ */
+static int
+find_word( const char *const *words, int count, const char *value,
+           webvtt_uint length )
+{
+  int i;
+  for( i = 0; i < count; ++i ) {
+    if( strlen( words[ i ] ) == length
+        && !memcmp( words[ i ], value, length ) ) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Read a line, position or size value: digits (at least one), optionally
+ * followed by a U+0025 PERCENT SIGN character (%) and, if 'sign' is set,
+ * optionally preceded by a U+002D HYPHEN-MINUS character (-). Returns 0 if
+ * there is anything else in 'value'.
+ */
+static webvtt_bool
+read_setting_number( const char *value, webvtt_uint length, webvtt_bool sign,
+                     webvtt_int64 *number, webvtt_bool *percent )
+{
+  webvtt_uint i = 0;
+  webvtt_int64 result = 0;
+  webvtt_bool negative = 0;
+
+  *percent = length > 0 && value[ length - 1 ] == '%';
+  if( *percent ) {
+    --length;
+  }
+  if( sign && length > 0 && value[ 0 ] == '-' ) {
+    negative = 1;
+    i = 1;
+  }
+  if( i == length ) {
+    return 0;
+  }
+  for( ; i < length; ++i ) {
+    if( !webvtt_isdigit( value[ i ] ) ) {
+      return 0;
+    }
+    result = result * 10 + ( value[ i ] - '0' );
+  }
+
+  *number = negative ? -result : result;
+  return 1;
+}
+
+static webvtt_status
+set_align( webvtt_cue *cue, const char *value, webvtt_uint length )
 {
-  unsigned i;
-  static const char *values[] = {
+  int i;
+  static const char *const values[] = {
     "start",
     "middle",
     "end",
@@ -136,90 +246,54 @@ webvtt_cue_set_align( webvtt_cue *cue, const char *value )
     "right",
   };
 
-  if( !cue || !value ) {
-    return WEBVTT_INVALID_PARAM;
+  if( ( i = find_word( values, sizeof(values)/sizeof(*values), value,
+                       length ) ) < 0 ) {
+    return WEBVTT_BAD_ALIGN;
   }
 
-  for( i=0 ; i < sizeof(values)/sizeof(*values) ; ++i ) {
-    if( !strcmp( value, values[i] ) ) {
-      cue->settings.align = (webvtt_align_type)i;
-      if( cue->flags & CUE_HAVE_ALIGN ) {
-        return WEBVTT_ALREADY_ALIGN;
-      }
-      cue->flags |= CUE_HAVE_ALIGN;
-      return WEBVTT_SUCCESS;
-    }
+  cue->settings.align = (webvtt_align_type)i;
+  if( cue->flags & CUE_HAVE_ALIGN ) {
+    return WEBVTT_ALREADY_ALIGN;
   }
-  return WEBVTT_BAD_ALIGN;
+  cue->flags |= CUE_HAVE_ALIGN;
+  return WEBVTT_SUCCESS;
 }
 
-WEBVTT_EXPORT webvtt_status
-webvtt_cue_set_line( webvtt_cue *cue, const char *value )
+static webvtt_status
+set_line( webvtt_cue *cue, const char *value, webvtt_uint length )
 {
   webvtt_int64 number;
-  int digits = 0;
-  const char *c;
-
-  if( !cue || !value ) {
-    return WEBVTT_INVALID_PARAM;
-  }
+  webvtt_bool percent;
 
   /**
    * 1. If value contains any characters other than U+002D HYPHEN-MINUS
    * characters (-), U+0025 PERCENT SIGN characters (%), and ASCII digits,
    * then jump to the step labeled next setting
-   */
-  for( c = value; *c; ++c ) {
-    if( webvtt_isdigit( *c ) ) {
-      ++digits;
-    } else if( *c == '-' || *c == '%' ) {
-    } else {
-      return WEBVTT_BAD_LINE;
-    }
-  }
-
-  /**
+   *
    * 2. If value does not contain at least one ASCII digit, then jump to the
    * step labeled next setting.
+   *
+   * 3. If any character in value other than the first character is a U+002D
+   * HYPHEN-MINUS character (-), then jump to the step labeled next setting.
+   *
+   * 4. If any character in value other than the last character is a U+0025
+   * PERCENT SIGN character (%), then jump to the step labeled next setting.
    */
-  if( digits == 0 ) {
-    return WEBVTT_BAD_LINE;
-  }
-
-  if( strchr( value + 1, '-' ) ) {
-    /**
-     * 3. If any character in value other than the first character is a U+002D
-     * HYPHEN-MINUS character (-), then jump to the step labeled next setting.
-     */
+  if( !read_setting_number( value, length, 1, &number, &percent ) ) {
     return WEBVTT_BAD_LINE;
   }
 
-  if( ( c = strchr( value, '%' ) ) && ( ( c[1] != '\0' ) || *value == '-' ) ) {
+  if( percent ) {
     /**
-     * 4. If any character in value other than the last character is a U+0025
-     * PERCENT SIGN character (%), then jump to the step labeled next setting.
-     *
      * 5. If the first character in value is a U+002D HYPHEN-MINUS character (-)
      * and the last character in value is a U+0025 PERCENT SIGN character (%),
      * then jump to the step labeled next setting.
-     */
-    return WEBVTT_BAD_LINE;
-  }
-
-  /**
-   * Ignoring the trailing percent sign, if any, interpret value as a
-   * (potentially signed) integer and let number be that number.
-   */
-  c = value;
-  number = webvtt_parse_int( &c, &digits );
-
-  if( *c == '%' ) {
-    /**
+     *
      * 7. If the last character in value is a U+0025 PERCENT SIGN character (%),
      * but number is not in the range 0 < number < 100, then jump to the step
      * labeled next setting.
      */
-    if( number > 100 ) {
+    if( *value == '-' || number > 100 ) {
       return WEBVTT_BAD_LINE;
     }
 
@@ -242,72 +316,56 @@ webvtt_cue_set_line( webvtt_cue *cue, const char *value )
   return WEBVTT_SUCCESS;
 }
 
-WEBVTT_EXPORT webvtt_status
-webvtt_cue_set_position( webvtt_cue *cue, const char *value )
+/**
+ * Position and size values follow the same rules: a percentage, in the range
+ * 0 <= number <= 100.
+ */
+static webvtt_bool
+read_percentage( const char *value, webvtt_uint length, int *out )
 {
-  int digits = 0;
   webvtt_int64 number;
-  const char *c;
-
-  if( !cue || !value ) {
-    return WEBVTT_INVALID_PARAM;
-  }
+  webvtt_bool percent;
 
   /**
    * 1. If value contains any characters other than U+0025 PERCENT SIGN
    * characters (%) and ASCII digits, then jump to the step labeled next
    * setting.
-   */
-  for( c = value; *c; ++c ) {
-    if( webvtt_isdigit( *c ) ) {
-      ++digits;
-    } else if( *c == '%' ) {
-    } else {
-      return WEBVTT_BAD_POSITION;
-    }
-  }
-
-  /**
+   *
    * 2. If value does not contain at least one ASCII digit, then jump to the
    * step labeled next setting.
-   */
-  if( !digits ) {
-    return WEBVTT_BAD_POSITION;
-  }
-
-  /**
+   *
    * 3. If any character in value other than the last character is a U+0025
    * PERCENT SIGN character (%), then jump to the step labeled next setting.
-   */
-  if( ( c = strchr( value, '%' ) ) && ( c[1] != '\0' ) ) {
-    return WEBVTT_BAD_POSITION;
-  }
-
-  /**
+   *
    * 4. If the last character in value is not a U+0025 PERCENT SIGN character
    * (%), then jump to the step labeled next setting.
-   */
-  if( !c ) {
-    return WEBVTT_BAD_POSITION;
-  }
-
-  /**
+   *
    * 5. Ignoring the trailing percent sign, interpret value as an integer, and
    * let number be that number.
-   */
-  c = value;
-  number = webvtt_parse_int( &c, &digits );
-
-  /**
+   *
    * 6. If number is not in the range 0 <= number <= 100, then jump to the step
    * labeled next setting.
    */
-  if( number > 100 ) {
+  if( !read_setting_number( value, length, 0, &number, &percent ) ||
+      !percent || number > 100 ) {
+    return 0;
+  }
+
+  *out = (int)number;
+  return 1;
+}
+
+static webvtt_status
+set_position( webvtt_cue *cue, const char *value, webvtt_uint length )
+{
+  int number;
+
+  if( !read_percentage( value, length, &number ) ) {
     return WEBVTT_BAD_POSITION;
   }
 
   /* 7. Let cue's text track cue text position be number */
-  cue->settings.position = (int)number;
+  cue->settings.position = number;
   if( cue->flags & CUE_HAVE_POSITION ) {
     return WEBVTT_ALREADY_POSITION;
   }
@@ -315,115 +373,158 @@ webvtt_cue_set_position( webvtt_cue *cue, const char *value )
   return WEBVTT_SUCCESS;
 }
 
-WEBVTT_EXPORT webvtt_status
-webvtt_cue_set_size( webvtt_cue *cue, const char *value )
+static webvtt_status
+set_size( webvtt_cue *cue, const char *value, webvtt_uint length )
 {
-  int digits = 0;
-  webvtt_int64 number;
-  const char *c;
-  if( !cue || !value ) {
-    return WEBVTT_INVALID_PARAM;
+  int number;
+
+  if( !read_percentage( value, length, &number ) ) {
+    return WEBVTT_BAD_SIZE;
   }
 
-  /**
-   * 1. If value contains any characters other than U+0025 PERCENT SIGN
-   * characters (%) and ASCII digits, then jump to the step labeled next
-   * setting.
-   */
-  for( c = value; *c; ++c ) {
-    if( webvtt_isdigit( *c ) ) {
-      ++digits;
-    } else if( *c == '%' ) {
-    } else {
-      return WEBVTT_BAD_SIZE;
-    }
+  /* 7. Let cue's text track cue size be number */
+  cue->settings.size = number;
+  if( cue->flags & CUE_HAVE_SIZE ) {
+    return WEBVTT_ALREADY_SIZE;
   }
+  cue->flags |= CUE_HAVE_SIZE;
+  return WEBVTT_SUCCESS;
+}
 
-  /**
-   * 2. If value does not contain at least one ASCII digit, then jump to the
-   * step labeled next setting.
-   */
-  if( !digits ) {
-    return WEBVTT_BAD_SIZE;
+static webvtt_status
+set_vertical( webvtt_cue *cue, const char *value, webvtt_uint length )
+{
+  int i;
+  static const char *const values[] = {
+    "lr",
+    "rl",
+  };
+
+  if( ( i = find_word( values, sizeof(values)/sizeof(*values), value,
+                       length ) ) < 0 ) {
+    return WEBVTT_BAD_VERTICAL;
   }
 
-  /**
-   * 3. If any character in value other than the last character is a U+0025
-   * PERCENT SIGN character (%), then jump to the step labeled next setting.
-   */
-  if( ( c = strchr( value, '%' ) ) && ( c[1] != '\0' ) ) {
-    return WEBVTT_BAD_SIZE;
+  cue->settings.vertical = (webvtt_vertical_type)( i + 1 );
+  if( cue->flags & CUE_HAVE_VERTICAL ) {
+    return WEBVTT_ALREADY_VERTICAL;
   }
+  cue->flags |= CUE_HAVE_VERTICAL;
+  return WEBVTT_SUCCESS;
+}
 
-  /**
-   * 4. If the last character in value is not a U+0025 PERCENT SIGN character
-   * (%), then jump to the step labeled next setting.
-   */
-  if( !c ) {
-    return WEBVTT_BAD_SIZE;
+WEBVTT_EXPORT webvtt_status
+webvtt_cue_set_align( webvtt_cue *cue, const char *value )
+{
+  if( !cue || !value ) {
+    return WEBVTT_INVALID_PARAM;
   }
+  return set_align( cue, value, strlen( value ) );
+}
 
-  /**
-   * 5. Ignoring the trailing percent sign, interpret value as an integer, and
-   * let number be that number.
-   */
-  c = value;
-  number = webvtt_parse_int( &c, &digits );
+WEBVTT_EXPORT webvtt_status
+webvtt_cue_set_line( webvtt_cue *cue, const char *value )
+{
+  if( !cue || !value ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  return set_line( cue, value, strlen( value ) );
+}
 
-  /**
-   * 6. If number is not in the range 0 <= number <= 100, then jump to the step
-   * labeled next setting.
-   */
-  if( number > 100 ) {
-    return WEBVTT_BAD_SIZE;
+WEBVTT_EXPORT webvtt_status
+webvtt_cue_set_position( webvtt_cue *cue, const char *value )
+{
+  if( !cue || !value ) {
+    return WEBVTT_INVALID_PARAM;
   }
+  return set_position( cue, value, strlen( value ) );
+}
 
-  /* 7. Let cue's text track cue size be number */
-  cue->settings.size = (int)number;
-  if( cue->flags & CUE_HAVE_SIZE ) {
-    return WEBVTT_ALREADY_SIZE;
+WEBVTT_EXPORT webvtt_status
+webvtt_cue_set_size( webvtt_cue *cue, const char *value )
+{
+  if( !cue || !value ) {
+    return WEBVTT_INVALID_PARAM;
   }
-  cue->flags |= CUE_HAVE_SIZE;
-  return WEBVTT_SUCCESS;
+  return set_size( cue, value, strlen( value ) );
 }
 
 WEBVTT_EXPORT webvtt_status
 webvtt_cue_set_vertical( webvtt_cue *cue, const char *value )
 {
-  unsigned i;
-  static const char *values[] = {
-    "lr",
-    "rl",
-  };
-
   if( !cue || !value ) {
     return WEBVTT_INVALID_PARAM;
   }
+  return set_vertical( cue, value, strlen( value ) );
+}
 
-  for( i=0 ; i < sizeof(values)/sizeof(*values) ; ++i ) {
-    if( !strcmp( value, values[i] ) ) {
-      cue->settings.vertical = (webvtt_align_type)i+1;
-      if( cue->flags & CUE_HAVE_VERTICAL ) {
-        return WEBVTT_ALREADY_VERTICAL;
+/**
+ * The setter for the keyword made of the 'length' bytes at 'keyword', or NULL
+ * if it isn't one. No two keywords have the same length and first byte, so
+ * those pick out the only keyword worth comparing against.
+ */
+static setting_fn
+find_setting( const char *keyword, webvtt_uint length )
+{
+  const char *name;
+  setting_fn fn;
+
+  switch( length ) {
+    case 4:
+      if( keyword[ 0 ] == 'l' ) {
+        name = "line";
+        fn = &set_line;
+      } else if( keyword[ 0 ] == 's' ) {
+        name = "size";
+        fn = &set_size;
+      } else {
+        return 0;
       }
-      cue->flags |= CUE_HAVE_VERTICAL;
-      return WEBVTT_SUCCESS;
-    }
+      break;
+    case 5:
+      name = "align";
+      fn = &set_align;
+      break;
+    case 8:
+      if( keyword[ 0 ] == 'p' ) {
+        name = "position";
+        fn = &set_position;
+      } else if( keyword[ 0 ] == 'v' ) {
+        name = "vertical";
+        fn = &set_vertical;
+      } else {
+        return 0;
+      }
+      break;
+    default:
+      return 0;
   }
-  return WEBVTT_BAD_VERTICAL;
+
+  return memcmp( keyword, name, length ) ? 0 : fn;
 }
 
-static struct
+/**
+ * Separate the 'length' bytes at 'word' into key and value (delimited by ':'),
+ * and hand the value to the setter for the key.
+ */
+static webvtt_status
+set_setting_from_text( webvtt_cue *cue, const char *word, webvtt_uint length )
 {
-  const char *keyword;
-  webvtt_status (*setValue)( webvtt_cue *cue, const char *value );
-} cuesettings[] = {
-  { "align", &webvtt_cue_set_align },
-  { "line", &webvtt_cue_set_line },
-  { "position", &webvtt_cue_set_position },
-  { "size", &webvtt_cue_set_size },
-  { "vertical", &webvtt_cue_set_vertical },
-};
+  const char *value;
+  setting_fn fn;
+
+  value = (const char *)memchr( word, ':', length );
+  if( !value || value == word || value + 1 == word + length ) {
+    return WEBVTT_BAD_CUESETTING;
+  }
+
+  if( !( fn = find_setting( word, (webvtt_uint)( value - word ) ) ) ) {
+    return WEBVTT_BAD_CUESETTING;
+  }
+
+  ++value;
+  return fn( cue, value, (webvtt_uint)( word + length - value ) );
+}
 
 /**
  * Set a cuesetting from key-value pairs (as C strings)
@@ -432,16 +533,17 @@ WEBVTT_EXPORT webvtt_status
 webvtt_cue_set_setting( webvtt_cue *cue,
                         const char *key, const char *value )
 {
-  unsigned i;
+  setting_fn fn;
   if( !key || !value ) {
     return WEBVTT_INVALID_PARAM;
   }
-  for( i=0 ; i<sizeof(cuesettings)/sizeof(*cuesettings) ; ++i ) {
-    if( !strcmp( key, cuesettings[i].keyword ) ) {
-      return cuesettings[i].setValue( cue, value );
-    }
+  if( !( fn = find_setting( key, strlen( key ) ) ) ) {
+    return WEBVTT_BAD_CUESETTING;
   }
-  return WEBVTT_BAD_CUESETTING;
+  if( !cue ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  return fn( cue, value, strlen( value ) );
 }
 
 WEBVTT_EXPORT webvtt_status
@@ -458,47 +560,39 @@ webvtt_cue_set_settings( webvtt_cue *cue, const webvtt_string *settings )
 WEBVTT_INTERN webvtt_status
 webvtt_cue_set_setting_from_string( webvtt_cue *cue, const char *word )
 {
-  char keyword[32] = "";
-  char *value;
-  int idx;
   if( !cue || !word ) {
     return WEBVTT_INVALID_PARAM;
   }
-
-  value = strchr( word, ':' );
-  if( !value || value == word || *(++value) == '\0' ) {
-    return WEBVTT_BAD_CUESETTING;
-  }
-
-  idx = ( value - word ) - 1;
-  if( idx > 31 ) {
-    return WEBVTT_BAD_CUESETTING;
-  }
-
-  memcpy( keyword, word, idx );
-  keyword[idx] = '\0';
-
-  return webvtt_cue_set_setting( cue, (const char *)keyword, value );
+  return set_setting_from_text( cue, word, strlen( word ) );
 }
 
 WEBVTT_EXPORT webvtt_status
 webvtt_cue_validate_set_settings( webvtt_parser self, webvtt_cue *cue,
                                   const webvtt_string *settings )
+{
+  if( !cue || !settings ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  return webvtt_cue_set_settings_from_text( self, cue,
+                                            webvtt_string_text( settings ),
+                                            webvtt_string_length( settings ) );
+}
+
+WEBVTT_INTERN webvtt_status
+webvtt_cue_set_settings_from_text( webvtt_parser self, webvtt_cue *cue,
+                                   const char *text, webvtt_uint length )
 {
   int line = 1;
   int column = 0;
-  int length;
-  const char *eol;
-  int position = 0;
+  const char *p, *end, *word;
   webvtt_status s;
-  if( !cue || !settings ) {
+
+  if( !cue || !text ) {
     return WEBVTT_INVALID_PARAM;
   }
-  length = (int)webvtt_string_length( settings );
-  if( ( eol = strchr( webvtt_string_text( settings ), '\r' ) )
-      || ( eol = strchr( webvtt_string_text( settings ), '\n' ) ) ) {
-    length = (int)( eol - webvtt_string_text( settings ) );
-  }
+
+  /* Settings run to the end of the line */
+  end = webvtt_scan_eol( text, text + length );
 
   if( self ) {
     line = self->line;
@@ -509,28 +603,23 @@ webvtt_cue_validate_set_settings( webvtt_parser self, webvtt_cue *cue,
    * http://www.w3.org/html/wg/drafts/html/master/single-page.html#split-a-string-on-spaces
    * 4. Skip whitespace
    */
-  column += webvtt_string_skip_whitespace( settings, &position );
+  for( p = text; p < end && webvtt_isspace( *p ); ++p ) {
+    ++column;
+  }
 
-  while( position < length ) {
-    webvtt_string word;
-    const char *keyword;
-    const char *end;
-    int nwhite, ncol;
+  while( p < end ) {
+    webvtt_uint wlen;
+    int nwhite = 0, ncol;
     /* Collect word (sequence of non-space characters terminated by space) */
-    if( WEBVTT_FAILED( webvtt_string_collect_word( settings, &word,
-                       &position ) ) ) {
-      return WEBVTT_OUT_OF_MEMORY;
-    }
-    /* skip trailing whitespace */
-    nwhite = webvtt_string_skip_whitespace( settings, &position );
-    /* Get the word text */
-    keyword = webvtt_string_text( &word );
-    /* Get pointer to end of the word. (for chcount()) */
-    end = keyword + webvtt_string_length( &word );
+    for( word = p; p < end && !webvtt_isspace( *p ); ++p );
+    wlen = (webvtt_uint)( p - word );
     /* Get the column count that needs to be skipped. */
-    ncol = webvtt_utf8_chcount( keyword, end );
-    if( WEBVTT_FAILED( s = webvtt_cue_set_setting_from_string( cue,
-                       keyword ) ) ) {
+    ncol = webvtt_utf8_chcount( word, p );
+    /* skip trailing whitespace */
+    for( ; p < end && webvtt_isspace( *p ); ++p ) {
+      ++nwhite;
+    }
+    if( WEBVTT_FAILED( s = set_setting_from_text( cue, word, wlen ) ) ) {
       if( self ) {
         /* Figure out which error to emit */
         webvtt_error error;
@@ -544,7 +633,6 @@ webvtt_cue_validate_set_settings( webvtt_parser self, webvtt_cue *cue,
     }
     /* Move column pointer beyond word and trailing whitespace */
     column += ncol + nwhite;
-    webvtt_release_string( &word );
   }
 
   if( self ) {
@@ -53,4 +53,13 @@ cue_is_incomplete( const webvtt_cue *cue );
 WEBVTT_INTERN webvtt_status
 webvtt_cue_set_setting_from_string( webvtt_cue *cue, const char *word );
 
+/**
+ * Same as webvtt_cue_validate_set_settings(), for the 'length' bytes of
+ * settings at 'text', which are read where they are rather than copied.
+ */
+WEBVTT_INTERN webvtt_status
+webvtt_cue_set_settings_from_text( struct webvtt_parser_t *self,
+                                   webvtt_cue *cue, const char *text,
+                                   webvtt_uint length );
+
 #endif
@@ -66,162 +66,202 @@ do \
     goto dealloc; \
   } \
 
-WEBVTT_INTERN webvtt_status
-webvtt_create_token( webvtt_cuetext_token **token, webvtt_token_type token_type )
+WEBVTT_INTERN void
+webvtt_init_cuetext_context( webvtt_cuetext_context *context )
 {
-  webvtt_cuetext_token *temp_token =
-    (webvtt_cuetext_token *)webvtt_alloc0( sizeof(*temp_token) );
-
-  if( !temp_token ) {
-    return WEBVTT_OUT_OF_MEMORY;
-  }
-
-  temp_token->token_type = token_type;
-  *token = temp_token;
-
-  return WEBVTT_SUCCESS;
+  webvtt_init_string( &context->result );
+  webvtt_init_string( &context->annotation );
+  context->css_classes = 0;
+  context->lang_stack = 0;
+  webvtt_init_intern_table( &context->interned );
 }
 
-WEBVTT_INTERN webvtt_status
-webvtt_create_start_token( webvtt_cuetext_token **token, webvtt_string
-                           *tag_name, webvtt_stringlist *css_classes,
-                           webvtt_string *annotation )
+WEBVTT_INTERN void
+webvtt_release_cuetext_context( webvtt_cuetext_context *context )
 {
-  webvtt_status status;
-  webvtt_start_token_data sd;
-
-  if( WEBVTT_FAILED( status = webvtt_create_token( token, START_TOKEN ) ) ) {
-    return status;
-  }
-
-  webvtt_copy_string( &(*token)->tag_name, tag_name );
-  webvtt_copy_stringlist( &sd.css_classes, css_classes );
-  webvtt_copy_string( &sd.annotations, annotation );
-
-  (*token)->start_token_data = sd;
-
-  return WEBVTT_SUCCESS;
+  webvtt_release_string( &context->result );
+  webvtt_release_string( &context->annotation );
+  webvtt_release_stringlist( &context->css_classes );
+  webvtt_release_stringlist( &context->lang_stack );
+  webvtt_release_intern_table( &context->interned );
 }
 
-WEBVTT_INTERN webvtt_status
-webvtt_create_end_token( webvtt_cuetext_token **token, webvtt_string *tag_name )
+WEBVTT_INTERN void
+webvtt_init_start_token( webvtt_cuetext_token *token, webvtt_string *tag_name,
+                         webvtt_stringlist *css_classes,
+                         webvtt_string *annotation )
 {
-  webvtt_status status;
-
-  if( WEBVTT_FAILED( status = webvtt_create_token( token, END_TOKEN ) ) ) {
-    return status;
+  token->token_type = START_TOKEN;
+  webvtt_copy_string( &token->tag_name, tag_name );
+  /**
+   * Only hold on to lists with something in them, so that the tokenizer can
+   * go on reusing its list for the many tags without classes.
+   */
+  token->start_token_data.css_classes = 0;
+  if( css_classes && css_classes->length ) {
+    webvtt_copy_stringlist( &token->start_token_data.css_classes,
+                            css_classes );
   }
-
-  webvtt_copy_string( &(*token)->tag_name, tag_name );
-
-  return WEBVTT_SUCCESS;
+  webvtt_copy_string( &token->start_token_data.annotations, annotation );
 }
 
-WEBVTT_INTERN webvtt_status
-webvtt_create_text_token( webvtt_cuetext_token **token, webvtt_string *text )
+WEBVTT_INTERN void
+webvtt_init_end_token( webvtt_cuetext_token *token, webvtt_string *tag_name )
 {
-  webvtt_status status;
-
-  if( WEBVTT_FAILED( status = webvtt_create_token( token, TEXT_TOKEN ) ) ) {
-    return status;
-  }
-
-  webvtt_copy_string( &(*token)->text, text);
-
-  return WEBVTT_SUCCESS;
+  token->token_type = END_TOKEN;
+  webvtt_copy_string( &token->tag_name, tag_name );
 }
 
-WEBVTT_INTERN webvtt_status
-webvtt_create_timestamp_token( webvtt_cuetext_token **token,
-                               webvtt_timestamp time_stamp )
+WEBVTT_INTERN void
+webvtt_init_text_token( webvtt_cuetext_token *token, webvtt_string *text )
 {
-  webvtt_status status;
-
-  if( WEBVTT_FAILED( status = webvtt_create_token( token,
-                                                   TIME_STAMP_TOKEN ) ) ) {
-    return status;
-  }
-
-  (*token)->time_stamp = time_stamp;
-
-  return WEBVTT_SUCCESS;
+  token->token_type = TEXT_TOKEN;
+  webvtt_init_string( &token->tag_name );
+  webvtt_copy_string( &token->text, text );
 }
 
 WEBVTT_INTERN void
-webvtt_delete_token( webvtt_cuetext_token **token )
+webvtt_init_timestamp_token( webvtt_cuetext_token *token,
+                             webvtt_timestamp time_stamp )
 {
-  webvtt_start_token_data data;
-  webvtt_cuetext_token *t;
+  token->token_type = TIME_STAMP_TOKEN;
+  webvtt_init_string( &token->tag_name );
+  token->time_stamp = time_stamp;
+}
 
+WEBVTT_INTERN void
+webvtt_clear_token( webvtt_cuetext_token *token )
+{
   if( !token ) {
     return;
   }
-  if( !*token ) {
-    return;
-  }
-  t = *token;
 
   /**
    * Note that time stamp tokens do not need to free any internal data because
    * they do not allocate anything.
    */
-  if( t->token_type == START_TOKEN ) {
-    data = t->start_token_data;
-    webvtt_release_stringlist( &data.css_classes );
-    webvtt_release_string( &data.annotations );
-    webvtt_release_string( &t->tag_name );
-  } else if( t->token_type == END_TOKEN ) {
-    webvtt_release_string( &t->tag_name );
-  } else if( t->token_type == TEXT_TOKEN ) {
-    webvtt_release_string( &t->text );
+  if( token->token_type == START_TOKEN ) {
+    webvtt_release_stringlist( &token->start_token_data.css_classes );
+    webvtt_release_string( &token->start_token_data.annotations );
+  } else if( token->token_type == TEXT_TOKEN ) {
+    webvtt_release_string( &token->text );
+  }
+  webvtt_release_string( &token->tag_name );
+}
+
+/**
+ * Perfect hash of the tag names a cue text tag may have: every known name
+ * lands in a slot of its own, so looking one up takes a single comparison.
+ */
+#define TAG_HASH(name, length) \
+  ( ( ( unsigned char )( name )[ 0 ] + 2 * ( length ) + \
+      ( unsigned char )( name )[ ( length ) - 1 ] ) & 15 )
+
+typedef struct
+tag_info_t {
+  const char *name;
+  webvtt_uint length;
+  webvtt_node_kind kind;
+} tag_info;
+
+static const tag_info tag_table[ 16 ] = {
+  { 0 },
+  { 0 },
+  { 0 },
+  { "ruby", 4, WEBVTT_RUBY },
+  { "i", 1, WEBVTT_ITALIC },
+  { 0 },
+  { "b", 1, WEBVTT_BOLD },
+  { 0 },
+  { "c", 1, WEBVTT_CLASS },
+  { 0 },
+  { "rt", 2, WEBVTT_RUBY_TEXT },
+  { "lang", 4, WEBVTT_LANG },
+  { "u", 1, WEBVTT_UNDERLINE },
+  { 0 },
+  { "v", 1, WEBVTT_VOICE },
+  { 0 }
+};
+
+static const tag_info *
+find_tag( const char *tag_name, webvtt_uint length )
+{
+  const tag_info *info;
+  if( !length ) {
+    return 0;
+  }
+  info = tag_table + TAG_HASH( tag_name, length );
+  if( info->length != length || memcmp( info->name, tag_name, length ) ) {
+    return 0;
   }
-  webvtt_free( t );
-  *token = 0;
+  return info;
 }
 
 WEBVTT_INTERN int
 tag_accepts_annotation( webvtt_string *tag_name )
 {
-  return webvtt_string_is_equal( tag_name, "v", 1 ) ||
-         webvtt_string_is_equal( tag_name, "lang", 4 );
+  const tag_info *info = find_tag( webvtt_string_text( tag_name ),
+                                   webvtt_string_length( tag_name ) );
+  return info && ( info->kind == WEBVTT_VOICE || info->kind == WEBVTT_LANG );
 }
 
 WEBVTT_INTERN webvtt_status
 webvtt_node_kind_from_tag_name( webvtt_string *tag_name,
                                 webvtt_node_kind *kind )
 {
+  if( !tag_name ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  return webvtt_node_kind_from_tag_text( webvtt_string_text( tag_name ),
+                                         webvtt_string_length( tag_name ),
+                                         kind );
+}
+
+WEBVTT_INTERN webvtt_status
+webvtt_node_kind_from_tag_text( const char *tag_name, webvtt_uint length,
+                                webvtt_node_kind *kind )
+{
+  const tag_info *info;
+
   if( !tag_name || !kind ) {
     return WEBVTT_INVALID_PARAM;
   }
 
-  if( webvtt_string_length(tag_name) == 1 ) {
-    switch( webvtt_string_text(tag_name)[0] ) {
-      case 'b':
-        *kind = WEBVTT_BOLD;
-        break;
-      case 'i':
-        *kind = WEBVTT_ITALIC;
-        break;
-      case 'u':
-        *kind = WEBVTT_UNDERLINE;
-        break;
-      case 'c':
-        *kind = WEBVTT_CLASS;
-        break;
-      case 'v':
-        *kind = WEBVTT_VOICE;
-        break;
-    }
-  } else if( webvtt_string_is_equal( tag_name, "ruby", 4 ) ) {
-    *kind = WEBVTT_RUBY;
-  } else if( webvtt_string_is_equal( tag_name, "rt", 2 ) ) {
-    *kind = WEBVTT_RUBY_TEXT;
-  } else if ( webvtt_string_is_equal( tag_name, "lang", 4 ) ) {
-    *kind = WEBVTT_LANG;
-  } else {
+  if( !( info = find_tag( tag_name, length ) ) ) {
     return WEBVTT_INVALID_TAG_NAME;
   }
 
+  *kind = info->kind;
+  return WEBVTT_SUCCESS;
+}
+
+WEBVTT_INTERN int
+webvtt_end_tag_closes( webvtt_node_kind current, webvtt_string *tag_name,
+                       webvtt_node_kind *kind )
+{
+  if( WEBVTT_FAILED( webvtt_node_kind_from_tag_name( tag_name, kind ) ) ) {
+    return 0;
+  }
+  return current == *kind ||
+         ( current == WEBVTT_RUBY_TEXT && *kind == WEBVTT_RUBY );
+}
+
+WEBVTT_INTERN webvtt_status
+webvtt_start_tag_kind( webvtt_node_kind current, webvtt_string *tag_name,
+                       webvtt_node_kind *kind )
+{
+  webvtt_status status;
+  if( WEBVTT_FAILED( status = webvtt_node_kind_from_tag_name( tag_name,
+                                                              kind ) ) ) {
+    return status;
+  }
+  /**
+   * Ruby text is only allowed in ruby, anywhere else the tag is thrown away.
+   */
+  if( *kind == WEBVTT_RUBY_TEXT && current != WEBVTT_RUBY ) {
+    return WEBVTT_UNSUCCESSFUL;
+  }
   return WEBVTT_SUCCESS;
 }
 
@@ -271,11 +311,26 @@ webvtt_create_node_from_token( webvtt_cuetext_token *token, webvtt_node **node,
   }
 }
 
+/**
+ * Appends the run of characters at *position that contains none of the bytes
+ * in 'stops' (or NUL) to 'str' in one go, and moves *position past it.
+ */
+static webvtt_status
+append_run( const char **position, const char *stops, webvtt_string *str )
+{
+  size_t run = strcspn( *position, stops );
+  webvtt_status status = webvtt_string_append( str, *position, ( int )run );
+
+  *position += run;
+  return status;
+}
+
 WEBVTT_INTERN webvtt_status
 webvtt_data_state( const char **position, webvtt_token_state *token_state,
                    webvtt_string *result )
 {
   for ( ; *token_state == DATA; (*position)++ ) {
+    CHECK_MEMORY_OP( append_run( position, "&<", result ) );
     switch( **position ) {
       case '&':
         *token_state = ESCAPE;
@@ -287,12 +342,8 @@ webvtt_data_state( const char **position, webvtt_token_state *token_state,
           return WEBVTT_SUCCESS;
         }
         break;
-      case '\0':
-        return WEBVTT_SUCCESS;
-        break;
       default:
-        CHECK_MEMORY_OP( webvtt_string_putc( result, *position[0] ) );
-        break;
+        return WEBVTT_SUCCESS;
     }
   }
 
@@ -388,7 +439,13 @@ webvtt_escape_state( const char **position, webvtt_token_state *token_state,
      * sequence.
      */
     else if( webvtt_isalphanum( **position ) ) {
-      CHECK_MEMORY_OP_JUMP( status, webvtt_string_putc( &buffer, **position ) );
+      const char *run = *position;
+      while( webvtt_isalphanum( run[ 1 ] ) ) {
+        ++run;
+      }
+      CHECK_MEMORY_OP_JUMP( status, webvtt_string_append( &buffer, *position,
+                                                  ( int )( run - *position ) + 1 ) );
+      *position = run;
     }
     /**
      * If we have not found an alphanumeric character then we have encountered
@@ -452,6 +509,7 @@ webvtt_start_tag_state( const char **position, webvtt_token_state *token_state,
                         webvtt_string *result )
 {
   for( ; *token_state == START_TAG; (*position)++ ) {
+    CHECK_MEMORY_OP( append_run( position, "\t\f \n\r.>", result ) );
     if( **position == '\t' || **position == '\f' ||
         **position == ' ' || **position == '\n' ||
         **position == '\r' ) {
@@ -461,14 +519,8 @@ webvtt_start_tag_state( const char **position, webvtt_token_state *token_state,
         case '.':
           *token_state = START_TAG_CLASS;
           break;
-        case '\0':
-          return WEBVTT_SUCCESS;
-        case '>':
-          return WEBVTT_SUCCESS;
-          break;
         default:
-          CHECK_MEMORY_OP( webvtt_string_putc( result, **position ) );
-          break;
+          return WEBVTT_SUCCESS;
       }
     }
   }
@@ -476,87 +528,98 @@ webvtt_start_tag_state( const char **position, webvtt_token_state *token_state,
   return WEBVTT_UNFINISHED;
 }
 
-WEBVTT_INTERN webvtt_status
-webvtt_class_state( const char **position, webvtt_token_state *token_state,
-                    webvtt_stringlist *css_classes )
+/**
+ * Push the 'length' bytes at 'name' to 'css_classes', sharing the string with
+ * earlier occurrences of the same class when there is an 'interned' table.
+ */
+static webvtt_status
+push_class( webvtt_stringlist *css_classes, webvtt_intern_table *interned,
+            const char *name, webvtt_uint length )
 {
-  webvtt_string buffer;
-  webvtt_status status = WEBVTT_SUCCESS;
+  webvtt_string str;
+  webvtt_status status;
 
-  CHECK_MEMORY_OP( webvtt_create_string( 1, &buffer ) );
+  if( interned ) {
+    status = webvtt_intern_string( interned, name, length, &str );
+  } else {
+    status = webvtt_create_string_with_text( &str, name, ( int )length );
+  }
+  CHECK_MEMORY_OP( status );
+
+  status = webvtt_stringlist_push( css_classes, &str );
+  webvtt_release_string( &str );
+  return status;
+}
+
+/**
+ * The class state proper. Class names are pushed straight from the input
+ * instead of being gathered up in a buffer first.
+ */
+static webvtt_status
+read_classes( const char **position, webvtt_token_state *token_state,
+              webvtt_stringlist *css_classes, webvtt_intern_table *interned )
+{
+  const char *name;
+  webvtt_uint length;
 
   for( ; *token_state == START_TAG_CLASS; (*position)++ ) {
+    name = *position;
+    length = ( webvtt_uint )strcspn( name, "\t\f \n\r>." );
+    *position += length;
     if( **position == '\t' || **position == '\f' ||
         **position == ' ' || **position == '\n' ||
         **position == '\r') {
-      if( webvtt_string_length( &buffer ) > 0 ) {
-        CHECK_MEMORY_OP_JUMP( status, webvtt_stringlist_push( css_classes,
-                                                              &buffer ) );
+      if( length > 0 ) {
+        CHECK_MEMORY_OP( push_class( css_classes, interned, name, length ) );
       }
       *token_state = START_TAG_ANNOTATION;
-      webvtt_release_string( &buffer );
       return WEBVTT_SUCCESS;
-    } else if( **position == '>' || **position == '\0' ) {
-      CHECK_MEMORY_OP_JUMP( status, webvtt_stringlist_push( css_classes,
-                                                            &buffer ) );
-      webvtt_release_string( &buffer );
+    }
+
+    CHECK_MEMORY_OP( push_class( css_classes, interned, name, length ) );
+    if( **position == '>' || **position == '\0' ) {
       return WEBVTT_SUCCESS;
-    } else if( **position == '.' ) {
-      CHECK_MEMORY_OP_JUMP( status, webvtt_stringlist_push( css_classes,
-                                                            &buffer ) );
-      webvtt_release_string( &buffer );
-      CHECK_MEMORY_OP( webvtt_create_string( 1, &buffer ) );
-    } else {
-      CHECK_MEMORY_OP_JUMP( status, webvtt_string_putc( &buffer, **position ) );
     }
   }
 
-dealloc:
-  webvtt_release_string( &buffer );
+  return WEBVTT_SUCCESS;
+}
 
-  return status;
+WEBVTT_INTERN webvtt_status
+webvtt_class_state( const char **position, webvtt_token_state *token_state,
+                    webvtt_stringlist *css_classes )
+{
+  return read_classes( position, token_state, css_classes, 0 );
 }
 
 WEBVTT_INTERN webvtt_status
 webvtt_annotation_state( const char **position, webvtt_token_state *token_state,
                          webvtt_string *annotation )
 {
-  for( ; *token_state == START_TAG_ANNOTATION; (*position)++ ) {
-    if( **position == '\0' || **position == '>' ) {
-      return WEBVTT_SUCCESS;
-    }
-    CHECK_MEMORY_OP( webvtt_string_putc( annotation, **position ) );
-  }
+  ( void )token_state;
+  CHECK_MEMORY_OP( append_run( position, ">", annotation ) );
 
-  return WEBVTT_UNFINISHED;
+  return WEBVTT_SUCCESS;
 }
 
 WEBVTT_INTERN webvtt_status
 webvtt_end_tag_state( const char **position, webvtt_token_state *token_state,
                       webvtt_string *result )
 {
-  for( ; *token_state == END_TAG; (*position)++ ) {
-    if( **position == '>' || **position == '\0' ) {
-      return WEBVTT_SUCCESS;
-    }
-    CHECK_MEMORY_OP( webvtt_string_putc( result, **position ) );
-  }
+  ( void )token_state;
+  CHECK_MEMORY_OP( append_run( position, ">", result ) );
 
-  return WEBVTT_UNFINISHED;
+  return WEBVTT_SUCCESS;
 }
 
 WEBVTT_INTERN webvtt_status
 webvtt_timestamp_state( const char **position, webvtt_token_state *token_state,
                         webvtt_string *result )
 {
-  for( ; *token_state == TIME_STAMP_TAG; (*position)++ ) {
-    if( **position == '>' || **position == '\0' ) {
-      return WEBVTT_SUCCESS;
-    }
-    CHECK_MEMORY_OP( webvtt_string_putc( result, **position ) );
-  }
+  ( void )token_state;
+  CHECK_MEMORY_OP( append_run( position, ">", result ) );
 
-  return WEBVTT_UNFINISHED;
+  return WEBVTT_SUCCESS;
 }
 
 /**
@@ -564,21 +627,28 @@ webvtt_timestamp_state( const char **position, webvtt_token_state *token_state,
  * Get a status in order to return at end and release memeory.
  */
 WEBVTT_INTERN webvtt_status
-webvtt_cuetext_tokenizer( const char **position, webvtt_cuetext_token **token )
+webvtt_cuetext_tokenizer( const char **position,
+                          webvtt_cuetext_context *context,
+                          webvtt_cuetext_token *token )
 {
   webvtt_token_state token_state = DATA;
-  webvtt_string result, annotation;
-  webvtt_stringlist *css_classes;
+  webvtt_string *result, *annotation, value;
   webvtt_timestamp time_stamp = 0;
   webvtt_status status = WEBVTT_UNFINISHED;
 
-  if( !position ) {
+  if( !position || !context || !token ) {
     return WEBVTT_INVALID_PARAM;
   }
 
-  webvtt_create_string( 10, &result );
-  webvtt_create_string( 10, &annotation );
-  webvtt_create_stringlist( &css_classes );
+  /**
+   * Whatever the previous token left in the buffers is no longer needed, so
+   * they can be emptied and written over (unless a node kept them).
+   */
+  result = &context->result;
+  annotation = &context->annotation;
+  webvtt_string_clear( result );
+  webvtt_string_clear( annotation );
+  CHECK_MEMORY_OP( webvtt_stringlist_clear( &context->css_classes ) );
 
   /**
    * Loop while the tokenizer is not finished.
@@ -589,28 +659,29 @@ webvtt_cuetext_tokenizer( const char **position, webvtt_cuetext_token **token )
   while( status == WEBVTT_UNFINISHED ) {
     switch( token_state ) {
       case DATA :
-        status = webvtt_data_state( position, &token_state, &result );
+        status = webvtt_data_state( position, &token_state, result );
         break;
       case ESCAPE:
-        status = webvtt_escape_state( position, &token_state, &result );
+        status = webvtt_escape_state( position, &token_state, result );
         break;
       case TAG:
-        status = webvtt_tag_state( position, &token_state, &result );
+        status = webvtt_tag_state( position, &token_state, result );
         break;
       case START_TAG:
-        status = webvtt_start_tag_state( position, &token_state, &result );
+        status = webvtt_start_tag_state( position, &token_state, result );
         break;
       case START_TAG_CLASS:
-        status = webvtt_class_state( position, &token_state, css_classes );
+        status = read_classes( position, &token_state, context->css_classes,
+                               &context->interned );
         break;
       case START_TAG_ANNOTATION:
-        status = webvtt_annotation_state( position, &token_state, &annotation );
+        status = webvtt_annotation_state( position, &token_state, annotation );
         break;
       case END_TAG:
-        status = webvtt_end_tag_state( position, &token_state, &result );
+        status = webvtt_end_tag_state( position, &token_state, result );
         break;
       case TIME_STAMP_TAG:
-        status = webvtt_timestamp_state( position, &token_state, &result );
+        status = webvtt_timestamp_state( position, &token_state, result );
         break;
     }
   }
@@ -624,34 +695,36 @@ webvtt_cuetext_tokenizer( const char **position, webvtt_cuetext_token **token )
      * needs to be made.
      */
     if( token_state == DATA || token_state == ESCAPE ) {
-      status = webvtt_create_text_token( token, &result );
+      webvtt_init_text_token( token, result );
     } else if( token_state == TAG || token_state == START_TAG ||
                token_state == START_TAG_CLASS ||
               token_state == START_TAG_ANNOTATION) {
       /**
-      * If the tag does not accept an annotation then release the current
-      * annotation and intialize annotation to a safe empty state
+      * If the tag does not accept an annotation then give the token an empty
+      * one instead. Those that do (voices, mostly) tend to repeat the same few
+      * names, so they are interned like class names.
       */
-      if( !tag_accepts_annotation( &result ) ) {
-        webvtt_release_string( &annotation );
-        webvtt_init_string( &annotation );
+      if( tag_accepts_annotation( result ) ) {
+        CHECK_MEMORY_OP( webvtt_intern_string( &context->interned,
+                                         webvtt_string_text( annotation ),
+                                         webvtt_string_length( annotation ),
+                                         &value ) );
+      } else {
+        webvtt_init_string( &value );
       }
-      status = webvtt_create_start_token( token, &result, css_classes,
-                                          &annotation );
+      webvtt_init_start_token( token, result, context->css_classes, &value );
+      webvtt_release_string( &value );
     } else if( token_state == END_TAG ) {
-      status = webvtt_create_end_token( token, &result );
+      webvtt_init_end_token( token, result );
     } else if( token_state == TIME_STAMP_TAG ) {
-      webvtt_parse_timestamp( webvtt_string_text( &result ), 0, &time_stamp );
-      status = webvtt_create_timestamp_token( token, time_stamp );
+      webvtt_parse_timestamp( webvtt_string_text( result ),
+                              webvtt_string_length( result ), 0, &time_stamp );
+      webvtt_init_timestamp_token( token, time_stamp );
     } else {
       status = WEBVTT_INVALID_TOKEN_STATE;
     }
   }
 
-  webvtt_release_stringlist( &css_classes );
-  webvtt_release_string( &result );
-  webvtt_release_string( &annotation );
-
   return status;
 }
 
@@ -671,10 +744,11 @@ webvtt_parse_cuetext( webvtt_parser self, webvtt_cue *cue,
   webvtt_node *node_head;
   webvtt_node *current_node;
   webvtt_node *temp_node;
-  webvtt_cuetext_token *token;
+  webvtt_cuetext_token token;
   webvtt_node_kind kind;
   webvtt_stringlist *lang_stack;
   webvtt_string temp;
+  webvtt_cuetext_context local_context, *context;
 
   /**
    *  TODO: Use these parameters! 'finished' isn't really important
@@ -683,7 +757,6 @@ webvtt_parse_cuetext( webvtt_parser self, webvtt_cue *cue,
    * However, for the time being we can trick the compiler into not
    * warning us about unused variables by doing this.
    */
-  ( void )self;
   ( void )finished;
 
   if( !cue ) {
@@ -700,12 +773,31 @@ webvtt_parse_cuetext( webvtt_parser self, webvtt_cue *cue,
     return status;
   }
 
+  /**
+   * The tokenizer's buffers are kept by the parser, so that they can be
+   * reused for every token of every cue. Cues parsed on demand, without a
+   * parser, get buffers of their own.
+   */
+  if( self ) {
+    context = &self->cuetext;
+  } else {
+    context = &local_context;
+    webvtt_init_cuetext_context( context );
+  }
+  if( WEBVTT_FAILED( status =
+                     webvtt_stringlist_clear( &context->lang_stack ) ) ) {
+    if( !self ) {
+      webvtt_release_cuetext_context( context );
+    }
+    return status;
+  }
+
   position = cue_text;
   node_head = cue->node_head;
   current_node = node_head;
   temp_node = NULL;
-  token = NULL;
-  webvtt_create_stringlist( &lang_stack );
+  memset( &token, 0, sizeof( token ) );
+  lang_stack = context->lang_stack;
 
   /**
    * Routine taken from the W3C specification
@@ -713,15 +805,15 @@ webvtt_parse_cuetext( webvtt_parser self, webvtt_cue *cue,
    */
   while( *position != '\0' ) {
     webvtt_status status = WEBVTT_SUCCESS;
-    webvtt_delete_token( &token );
+    webvtt_clear_token( &token );
 
     /* Step 7. */
-    if( WEBVTT_FAILED( status = webvtt_cuetext_tokenizer( &position,
+    if( WEBVTT_FAILED( status = webvtt_cuetext_tokenizer( &position, context,
                                                           &token ) ) ) {
       /* Error here. */
     } else {
       /* Succeeded... Process token */
-      if( token->token_type == END_TOKEN ) {
+      if( token.token_type == END_TOKEN ) {
         /**
          * If we've found an end token which has a valid end token tag name and
          * a tag name that is equal to the current node then set current to the
@@ -736,18 +828,8 @@ webvtt_parse_cuetext( webvtt_parser self, webvtt_cue *cue,
           continue;
         }
 
-        if( webvtt_node_kind_from_tag_name( &token->tag_name, &kind ) ==
-            WEBVTT_INVALID_TAG_NAME ) {
-          /**
-           * We have encountered an end token but it is not in a format that is
-           * supported, throw away the token.
-           */
-          continue;
-        }
-
-        if( current_node->kind == kind ||
-            ( current_node->kind == WEBVTT_RUBY_TEXT
-              && kind == WEBVTT_RUBY ) ) {
+        if( webvtt_end_tag_closes( current_node->kind, &token.tag_name,
+                                   &kind ) ) {
           /**
            * We have encountered a valid end tag to our current tag. Move back
            * up the tree of nodes and continue parsing.
@@ -760,26 +842,27 @@ webvtt_parse_cuetext( webvtt_parser self, webvtt_cue *cue,
           }
         }
       } else {
+        /**
+         * Start tags which are not supported, or not allowed where they are,
+         * are thrown away.
+         */
+        if( token.token_type == START_TOKEN &&
+            WEBVTT_FAILED( webvtt_start_tag_kind( current_node->kind,
+                                                  &token.tag_name,
+                                                  &kind ) ) ) {
+          continue;
+        }
+
         /**
          * Attempt to create a valid node from the token.
          * If successful then attach the node to the current nodes list and
          * also set current to the newly created node if it is an internal
          * node type.
          */
-        if( webvtt_create_node_from_token( token, &temp_node, current_node ) !=
+        if( webvtt_create_node_from_token( &token, &temp_node, current_node ) !=
             WEBVTT_SUCCESS ) {
           /* Do something here? */
         } else {
-          /**
-           * If the parsed node is ruby text and we are not currently on a ruby
-           * node then do not attach the ruby text node.
-           */
-          if( temp_node->kind == WEBVTT_RUBY_TEXT &&
-              current_node->kind != WEBVTT_RUBY ) {
-            webvtt_release_node( &temp_node );
-            continue;
-          }
-
           webvtt_attach_node( current_node, temp_node );
 
           /**
@@ -807,8 +890,12 @@ webvtt_parse_cuetext( webvtt_parser self, webvtt_cue *cue,
     }
   }
 
-  webvtt_delete_token( &token );
-  webvtt_release_stringlist( &lang_stack );
+  webvtt_clear_token( &token );
+  if( self ) {
+    webvtt_stringlist_clear( &context->lang_stack );
+  } else {
+    webvtt_release_cuetext_context( context );
+  }
 
   return WEBVTT_SUCCESS;
 }
@@ -30,6 +30,7 @@
 # include <webvtt/util.h>
 # include <webvtt/string.h>
 # include <webvtt/cue.h>
+# include "string_internal.h"
 
 typedef struct webvtt_cuetext_token_t webvtt_cuetext_token;
 typedef struct webvtt_start_token_data_t webvtt_start_token_data;
@@ -91,29 +92,48 @@ webvtt_cuetext_token_t {
 };
 
 /**
- * Routines for creating cue text tokens.
- * Sets the passed token to the new token.
+ * Buffers which the tokenizer reads tokens into, and the stack of languages
+ * used while building a node tree. They are emptied and reused for every
+ * token, instead of being created and released each time, so only the text
+ * which ends up in nodes needs new allocations.
  */
-WEBVTT_INTERN webvtt_status
-webvtt_create_token( webvtt_cuetext_token **token,
-                     webvtt_token_type token_type );
+typedef struct
+webvtt_cuetext_context_t {
+  webvtt_string result;
+  webvtt_string annotation;
+  webvtt_stringlist *css_classes;
+  webvtt_stringlist *lang_stack;
+  /**
+   * Class names and annotations seen so far, so that each of them is only
+   * allocated once however many tags repeat it.
+   */
+  webvtt_intern_table interned;
+} webvtt_cuetext_context;
 
-WEBVTT_INTERN webvtt_status
-webvtt_create_start_token( webvtt_cuetext_token **token,
-                           webvtt_string *tag_name,
-                           webvtt_stringlist *css_classes,
-                           webvtt_string *annotation );
+WEBVTT_INTERN void
+webvtt_init_cuetext_context( webvtt_cuetext_context *context );
 
-WEBVTT_INTERN webvtt_status
-webvtt_create_end_token( webvtt_cuetext_token **token,
-                         webvtt_string *tag_name );
+WEBVTT_INTERN void
+webvtt_release_cuetext_context( webvtt_cuetext_context *context );
 
-WEBVTT_INTERN webvtt_status
-webvtt_create_text_token( webvtt_cuetext_token **token, webvtt_string *text );
+/**
+ * Routines for filling in cue text tokens, which are owned by the caller
+ * (usually on its stack). The token shares the strings it is given.
+ */
+WEBVTT_INTERN void
+webvtt_init_start_token( webvtt_cuetext_token *token, webvtt_string *tag_name,
+                         webvtt_stringlist *css_classes,
+                         webvtt_string *annotation );
 
-WEBVTT_INTERN webvtt_status
-webvtt_create_timestamp_token( webvtt_cuetext_token **token,
-                               webvtt_timestamp time_stamp );
+WEBVTT_INTERN void
+webvtt_init_end_token( webvtt_cuetext_token *token, webvtt_string *tag_name );
+
+WEBVTT_INTERN void
+webvtt_init_text_token( webvtt_cuetext_token *token, webvtt_string *text );
+
+WEBVTT_INTERN void
+webvtt_init_timestamp_token( webvtt_cuetext_token *token,
+                             webvtt_timestamp time_stamp );
 
 /**
  * Returns true if the passed tag matches a tag name that accepts an annotation.
@@ -122,10 +142,10 @@ WEBVTT_INTERN int
 tag_accepts_annotation( webvtt_string *tag_name );
 
 /**
- * Routines for deleting cue text tokens.
+ * Release what a cue text token holds, leaving it safe to clear again.
  */
 WEBVTT_INTERN void
-webvtt_delete_token( webvtt_cuetext_token **token );
+webvtt_clear_token( webvtt_cuetext_token *token );
 
 /**
  * Converts the textual representation of a node kind into a particular kind.
@@ -136,6 +156,31 @@ WEBVTT_INTERN webvtt_status
 webvtt_node_kind_from_tag_name( webvtt_string *tag_name,
                                 webvtt_node_kind *kind );
 
+/**
+ * As webvtt_node_kind_from_tag_name(), for a tag name of 'length' bytes which
+ * need not be NUL-terminated.
+ */
+WEBVTT_INTERN webvtt_status
+webvtt_node_kind_from_tag_text( const char *tag_name, webvtt_uint length,
+                                webvtt_node_kind *kind );
+
+/**
+ * Returns true if an end tag named 'tag_name' closes the current node, of kind
+ * 'current', by the cue text parsing rules. 'kind' is set to the kind of node
+ * that the tag names, if it names one.
+ */
+WEBVTT_INTERN int
+webvtt_end_tag_closes( webvtt_node_kind current, webvtt_string *tag_name,
+                       webvtt_node_kind *kind );
+
+/**
+ * Finds the kind of node which a start tag named 'tag_name' adds under the
+ * current node, of kind 'current'. Fails for tags which add no node there.
+ */
+WEBVTT_INTERN webvtt_status
+webvtt_start_tag_kind( webvtt_node_kind current, webvtt_string *tag_name,
+                       webvtt_node_kind *kind );
+
 /**
  * Creates a node from a valid token.
  * Returns WEBVTT_NOT_SUPPORTED if it does not find a valid tag name.
@@ -150,7 +195,9 @@ webvtt_create_node_from_token( webvtt_cuetext_token *token, webvtt_node **node,
  * Referenced from - http://dev.w3.org/html5/webvtt/#webvtt-cue-text-tokenizer
  */
 WEBVTT_INTERN webvtt_status
-webvtt_tokenizer( const char **position, webvtt_cuetext_token **token );
+webvtt_cuetext_tokenizer( const char **position,
+                          webvtt_cuetext_context *context,
+                          webvtt_cuetext_token *token );
 
 /**
  * Routines that take care of certain states in the webvtt cue text tokenizer.
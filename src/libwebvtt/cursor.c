@@ -0,0 +1,339 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <webvtt/node.h>
+#include "track_internal.h"
+
+/**
+ * A time, and the index of the entry of the track it belongs to
+ */
+typedef struct
+cursor_mark_t {
+  webvtt_timestamp time;
+  webvtt_uint entry;
+} cursor_mark;
+
+/**
+ * The cursor keeps three positions: in the entries of the track (sorted by
+ * start time), in the same entries sorted by end time, and in the timestamps
+ * of their cue-text sorted by time. Everything before a position has been
+ * passed, so the active cues are those which have been entered and not yet
+ * exited.
+ */
+struct
+webvtt_cue_cursor_t {
+  webvtt_cue_track track;
+  webvtt_uint options;
+  webvtt_timestamp time;
+  /**
+   * Whether the cursor has been moved since it was created
+   */
+  webvtt_bool moved;
+
+  /**
+   * Number of cues in the track when 'ends' and 'marks' were built
+   */
+  webvtt_uint count;
+  cursor_mark *ends;
+  cursor_mark *marks;
+  webvtt_uint mark_count;
+
+  webvtt_uint next_start;
+  webvtt_uint next_end;
+  webvtt_uint next_mark;
+};
+
+static int
+compare_marks( const void *a, const void *b )
+{
+  const cursor_mark *x = ( const cursor_mark * )a;
+  const cursor_mark *y = ( const cursor_mark * )b;
+  if( x->time != y->time ) {
+    return x->time < y->time ? -1 : 1;
+  }
+  return x->entry < y->entry ? -1 : x->entry > y->entry;
+}
+
+/**
+ * Count the WEBVTT_TIME_STAMP nodes inside the active interval of 'entry',
+ * storing them at 'marks' if it isn't NULL.
+ */
+static webvtt_uint
+find_timestamps( const track_entry *entry, webvtt_uint index,
+                 cursor_mark *marks )
+{
+  const webvtt_flat_tree *tree;
+  webvtt_uint i, found = 0;
+  if( webvtt_cue_get_flat_tree( entry->cue, &tree ) != WEBVTT_SUCCESS
+      || !tree ) {
+    return 0;
+  }
+  for( i = 0; i < tree->length; ++i ) {
+    const webvtt_flat_node *node = tree->nodes + i;
+    if( node->kind == WEBVTT_TIME_STAMP
+        && node->data.timestamp >= entry->from
+        && node->data.timestamp < entry->until ) {
+      if( marks ) {
+        marks[ found ].time = node->data.timestamp;
+        marks[ found ].entry = index;
+      }
+      ++found;
+    }
+  }
+  return found;
+}
+
+/**
+ * Rebuild the orderings of the cursor for the cues now in the track.
+ */
+static webvtt_status
+build_cursor( webvtt_cue_cursor self )
+{
+  webvtt_cue_track track = self->track;
+  cursor_mark *ends = 0, *marks = 0;
+  webvtt_uint i, mark_count = 0;
+
+  webvtt_index_cue_track( track );
+  if( track->count ) {
+    if( !( ends = ( cursor_mark * )webvtt_alloc( track->count *
+                                                 sizeof *ends ) ) ) {
+      return WEBVTT_OUT_OF_MEMORY;
+    }
+    for( i = 0; i < track->count; ++i ) {
+      ends[ i ].time = track->entries[ i ].until;
+      ends[ i ].entry = i;
+    }
+    qsort( ends, track->count, sizeof *ends, &compare_marks );
+  }
+
+  if( self->options & WEBVTT_CURSOR_TIMESTAMPS ) {
+    for( i = 0; i < track->count; ++i ) {
+      mark_count += find_timestamps( track->entries + i, i, 0 );
+    }
+    if( mark_count ) {
+      if( !( marks = ( cursor_mark * )webvtt_alloc( mark_count *
+                                                    sizeof *marks ) ) ) {
+        webvtt_free( ends );
+        return WEBVTT_OUT_OF_MEMORY;
+      }
+      mark_count = 0;
+      for( i = 0; i < track->count; ++i ) {
+        mark_count += find_timestamps( track->entries + i, i,
+                                       marks + mark_count );
+      }
+      qsort( marks, mark_count, sizeof *marks, &compare_marks );
+    }
+  }
+
+  webvtt_free( self->ends );
+  webvtt_free( self->marks );
+  self->ends = ends;
+  self->marks = marks;
+  self->mark_count = mark_count;
+  self->count = track->count;
+  return WEBVTT_SUCCESS;
+}
+
+/**
+ * Index of the first of 'count' items, spaced 'stride' bytes apart from
+ * 'base' and each starting with a timestamp, which is later than 'time'
+ */
+static webvtt_uint
+first_after( const char *base, webvtt_uint stride, webvtt_uint count,
+             webvtt_timestamp time )
+{
+  webvtt_uint low = 0, high = count, middle;
+  while( low < high ) {
+    middle = low + ( high - low ) / 2;
+    if( *( const webvtt_timestamp * )( base + middle * stride ) <= time ) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+static void
+seek_cursor( webvtt_cue_cursor self, webvtt_timestamp time )
+{
+  webvtt_cue_track track = self->track;
+  self->next_start = first_after( ( const char * )track->entries,
+                                  sizeof *track->entries, track->count,
+                                  time );
+  self->next_end = first_after( ( const char * )self->ends,
+                                sizeof *self->ends, self->count, time );
+  self->next_mark = first_after( ( const char * )self->marks,
+                                 sizeof *self->marks, self->mark_count,
+                                 time );
+  self->time = time;
+  self->moved = 1;
+}
+
+/**
+ * Catch up with cues added to the track since the cursor last moved
+ */
+static webvtt_status
+refresh_cursor( webvtt_cue_cursor self )
+{
+  webvtt_status status;
+  if( self->count == self->track->count ) {
+    return WEBVTT_SUCCESS;
+  }
+  if( ( status = build_cursor( self ) ) == WEBVTT_SUCCESS && self->moved ) {
+    seek_cursor( self, self->time );
+  }
+  return status;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_create_cue_cursor( webvtt_cue_track track, webvtt_uint options,
+                          webvtt_cue_cursor *ppout )
+{
+  webvtt_cue_cursor self;
+  webvtt_status status;
+  if( !track || !ppout ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  if( !( self = ( webvtt_cue_cursor )webvtt_alloc0( sizeof *self ) ) ) {
+    return WEBVTT_OUT_OF_MEMORY;
+  }
+  self->track = track;
+  self->options = options;
+  if( ( status = build_cursor( self ) ) != WEBVTT_SUCCESS ) {
+    webvtt_free( self );
+    return status;
+  }
+  *ppout = self;
+  return WEBVTT_SUCCESS;
+}
+
+WEBVTT_EXPORT void
+webvtt_delete_cue_cursor( webvtt_cue_cursor self )
+{
+  if( self ) {
+    webvtt_free( self->ends );
+    webvtt_free( self->marks );
+    webvtt_free( self );
+  }
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_seek_cue_cursor( webvtt_cue_cursor self, webvtt_timestamp time )
+{
+  webvtt_status status;
+  if( !self ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  if( self->count != self->track->count
+      && ( status = build_cursor( self ) ) != WEBVTT_SUCCESS ) {
+    return status;
+  }
+  seek_cursor( self, time );
+  return WEBVTT_SUCCESS;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_advance_cue_cursor( webvtt_cue_cursor self, webvtt_timestamp time,
+                           webvtt_cue_event_fn on_event, void *userdata )
+{
+  const track_entry *entries;
+  const cursor_mark *end, *mark;
+  const track_entry *start;
+  webvtt_status status;
+  webvtt_uint n, i, known;
+
+  if( !self || !on_event || time < self->time ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  known = self->count;
+  if( ( status = refresh_cursor( self ) ) != WEBVTT_SUCCESS ) {
+    return status;
+  }
+
+  entries = self->track->entries;
+  n = self->count;
+
+  /**
+   * Catching up with cues added to the track passed the start of those which
+   * are active where the cursor is, so they are entered first, to go with
+   * the exit which is still to come.
+   */
+  if( self->moved && known != n ) {
+    for( i = 0; i < self->next_start; ++i ) {
+      if( entries[ i ].order >= known && entries[ i ].until > self->time
+          && ( status = on_event( userdata, WEBVTT_CUE_ENTER,
+                                  entries[ i ].from, entries[ i ].cue ) )
+             != WEBVTT_SUCCESS ) {
+        return status;
+      }
+    }
+  }
+  self->time = time;
+  self->moved = 1;
+
+  /**
+   * Merge the three orderings by time. At the same time, cues which have
+   * been entered are exited first, then cues are entered, and then the
+   * timestamps are reached; a cue can't be exited before it is entered, and
+   * its timestamps are never earlier than its start, so this always keeps
+   * the events of a cue in order.
+   */
+  for( ;; ) {
+    start = self->next_start < n && entries[ self->next_start ].from <= time
+            ? entries + self->next_start : 0;
+    end = self->next_end < n && self->ends[ self->next_end ].time <= time
+          ? self->ends + self->next_end : 0;
+    mark = self->next_mark < self->mark_count
+           && self->marks[ self->next_mark ].time <= time
+           ? self->marks + self->next_mark : 0;
+
+    if( end && end->entry < self->next_start
+        && ( !start || end->time <= start->from )
+        && ( !mark || end->time <= mark->time ) ) {
+      ++self->next_end;
+      status = on_event( userdata, WEBVTT_CUE_EXIT, end->time,
+                         entries[ end->entry ].cue );
+    } else if( start && ( !mark || start->from <= mark->time ) ) {
+      ++self->next_start;
+      status = on_event( userdata, WEBVTT_CUE_ENTER, start->from,
+                         start->cue );
+    } else if( mark ) {
+      ++self->next_mark;
+      status = on_event( userdata, WEBVTT_CUE_TIMESTAMP, mark->time,
+                         entries[ mark->entry ].cue );
+    } else {
+      break;
+    }
+
+    if( status != WEBVTT_SUCCESS ) {
+      return status;
+    }
+  }
+  return WEBVTT_SUCCESS;
+}
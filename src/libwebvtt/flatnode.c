@@ -0,0 +1,290 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include "parser_internal.h"
+#include "cuetext_internal.h"
+
+/**
+ * Flat trees are built from the tokens of the cue text tokenizer, following
+ * the same tree construction rules as webvtt_parse_cuetext(), but keeping only
+ * the text of each token instead of creating strings and nodes for it.
+ *
+ * The text of every node is appended to the tree's buffer, and is never longer
+ * than the cue-text it came from. Each text node's text is followed by a NUL,
+ * and as every text node but the last is followed by a tag, the buffer can't
+ * need more than one byte per '<' for them. A copy of the cue-text is kept at
+ * the end of the block for the tokenizer to read from.
+ */
+
+#define HEADER_SIZE ( ( sizeof( webvtt_flat_tree ) + 7 ) & ~7 )
+
+typedef struct
+flat_builder_t {
+  webvtt_flat_tree *tree;
+  webvtt_uint current;
+  webvtt_uint text_length;
+} flat_builder;
+
+/**
+ * Append the 'length' bytes at 'text' to the buffer of the tree, as 'range'.
+ */
+static void
+append_text( flat_builder *builder, webvtt_text_range *range,
+             const char *text, webvtt_uint length )
+{
+  range->offset = builder->text_length;
+  range->length = length;
+  memcpy( builder->tree->text + builder->text_length, text, length );
+  builder->text_length += length;
+}
+
+static webvtt_flat_node *
+add_node( webvtt_flat_tree *tree, webvtt_uint parent, webvtt_node_kind kind )
+{
+  webvtt_uint index = tree->length++;
+  webvtt_flat_node *node = tree->nodes + index;
+  webvtt_flat_node *p = tree->nodes + parent;
+
+  memset( node, 0, sizeof( *node ) );
+  node->kind = kind;
+  node->parent = parent;
+  node->first_child = node->last_child = WEBVTT_NO_NODE;
+  node->next_sibling = WEBVTT_NO_NODE;
+
+  if( p->last_child == WEBVTT_NO_NODE ) {
+    p->first_child = index;
+  } else {
+    tree->nodes[ p->last_child ].next_sibling = index;
+  }
+  p->last_child = index;
+
+  return node;
+}
+
+/**
+ * Add the node for a start tag 'token' under the current node, and make it the
+ * current node.
+ */
+static void
+add_tag( flat_builder *builder, webvtt_cuetext_token *token,
+         webvtt_node_kind kind )
+{
+  webvtt_flat_tree *tree = builder->tree;
+  webvtt_flat_node *node = add_node( tree, builder->current, kind );
+  webvtt_stringlist *css_classes = token->start_token_data.css_classes;
+  webvtt_string *annotation = &token->start_token_data.annotations;
+  webvtt_uint i;
+
+  node->data.tag.classes.offset = builder->text_length;
+  for( i = 0; css_classes && i < css_classes->length; ++i ) {
+    if( i ) {
+      tree->text[ builder->text_length++ ] = '.';
+    }
+    memcpy( tree->text + builder->text_length,
+            webvtt_string_text( css_classes->items + i ),
+            webvtt_string_length( css_classes->items + i ) );
+    builder->text_length += webvtt_string_length( css_classes->items + i );
+  }
+  node->data.tag.classes.length = builder->text_length -
+                                  node->data.tag.classes.offset;
+  node->data.tag.class_count = css_classes ? css_classes->length : 0;
+
+  /**
+   * The annotation of a lang tag is its language, which nodes inside of it
+   * share, just as they share the top of the language stack.
+   */
+  if( kind == WEBVTT_LANG ) {
+    append_text( builder, &node->data.tag.lang,
+                 webvtt_string_text( annotation ),
+                 webvtt_string_length( annotation ) );
+  } else {
+    append_text( builder, &node->data.tag.annotation,
+                 webvtt_string_text( annotation ),
+                 webvtt_string_length( annotation ) );
+    node->data.tag.lang = tree->nodes[ node->parent ].data.tag.lang;
+  }
+  builder->current = ( webvtt_uint )( node - tree->nodes );
+}
+
+/**
+ * Build the tree as webvtt_parse_cuetext() would for the text at 'position'.
+ */
+static webvtt_status
+build_tree( flat_builder *builder, const char *position )
+{
+  webvtt_flat_tree *tree = builder->tree;
+  webvtt_flat_node *node;
+  webvtt_cuetext_context context;
+  webvtt_cuetext_token token;
+  webvtt_node_kind kind;
+  webvtt_status status = WEBVTT_SUCCESS;
+
+  webvtt_init_cuetext_context( &context );
+  memset( &token, 0, sizeof( token ) );
+
+  while( *position != '\0' ) {
+    webvtt_clear_token( &token );
+    if( WEBVTT_FAILED( status = webvtt_cuetext_tokenizer( &position, &context,
+                                                          &token ) ) ) {
+      break;
+    }
+
+    node = tree->nodes + builder->current;
+    switch( token.token_type ) {
+      case END_TOKEN:
+        if( webvtt_end_tag_closes( node->kind, &token.tag_name, &kind ) ) {
+          builder->current = node->parent;
+        }
+        break;
+      case START_TOKEN:
+        if( !WEBVTT_FAILED( webvtt_start_tag_kind( node->kind,
+                                                   &token.tag_name,
+                                                   &kind ) ) ) {
+          add_tag( builder, &token, kind );
+        }
+        break;
+      case TIME_STAMP_TOKEN:
+        node = add_node( tree, builder->current, WEBVTT_TIME_STAMP );
+        node->data.timestamp = token.time_stamp;
+        break;
+      case TEXT_TOKEN:
+        node = add_node( tree, builder->current, WEBVTT_TEXT );
+        append_text( builder, &node->data.text,
+                     webvtt_string_text( &token.text ),
+                     webvtt_string_length( &token.text ) );
+        tree->text[ builder->text_length++ ] = 0;
+        break;
+    }
+  }
+
+  webvtt_clear_token( &token );
+  webvtt_release_cuetext_context( &context );
+  return status;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_create_flat_tree( const char *text, webvtt_uint length,
+                         webvtt_flat_tree **ptree )
+{
+  flat_builder builder;
+  webvtt_flat_tree *tree;
+  webvtt_uint tags = 0, max_nodes, max_text;
+  webvtt_status status;
+  const char *t, *end;
+  char *source;
+
+  if( !text || !ptree ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  /**
+   * Every tag adds at most one node, and ends at most one text node, along
+   * with its NUL. Every other byte is copied to the buffer at most once, on
+   * top of the copy which is tokenized.
+   */
+  if( length > ( ( webvtt_uint )-1 - HEADER_SIZE - 2 *
+                 sizeof( webvtt_flat_node ) - 3 ) /
+               ( 2 * sizeof( webvtt_flat_node ) + 3 ) ) {
+    return WEBVTT_OUT_OF_MEMORY;
+  }
+  for( t = text, end = text + length;
+       ( t = ( const char * )memchr( t, '<', end - t ) ) != 0; ++t ) {
+    ++tags;
+  }
+  max_nodes = 2 * tags + 2;
+  max_text = length + tags + 1;
+
+  tree = ( webvtt_flat_tree * )webvtt_alloc( HEADER_SIZE + max_nodes *
+                                             sizeof( webvtt_flat_node ) +
+                                             max_text + length + 1 );
+  if( !tree ) {
+    return WEBVTT_OUT_OF_MEMORY;
+  }
+  tree->nodes = ( webvtt_flat_node * )( ( char * )tree + HEADER_SIZE );
+  tree->text = ( char * )( tree->nodes + max_nodes );
+  source = tree->text + max_text;
+  memcpy( source, text, length );
+  source[ length ] = 0;
+
+  memset( tree->nodes, 0, sizeof( webvtt_flat_node ) );
+  tree->nodes->kind = WEBVTT_HEAD_NODE;
+  tree->nodes->parent = tree->nodes->first_child = WEBVTT_NO_NODE;
+  tree->nodes->last_child = tree->nodes->next_sibling = WEBVTT_NO_NODE;
+  tree->length = 1;
+
+  builder.tree = tree;
+  builder.current = 0;
+  builder.text_length = 0;
+  if( WEBVTT_FAILED( status = build_tree( &builder, source ) ) ) {
+    webvtt_free( tree );
+    return status;
+  }
+
+  *ptree = tree;
+  return WEBVTT_SUCCESS;
+}
+
+WEBVTT_EXPORT void
+webvtt_delete_flat_tree( webvtt_flat_tree *tree )
+{
+  webvtt_free( tree );
+}
+
+WEBVTT_EXPORT const char *
+webvtt_flat_text( const webvtt_flat_tree *tree,
+                  const webvtt_text_range *range )
+{
+  if( !tree || !range ) {
+    return 0;
+  }
+  return tree->text + range->offset;
+}
+
+WEBVTT_EXPORT void
+webvtt_flat_children( const webvtt_flat_tree *tree, webvtt_uint parent,
+                      webvtt_flat_iterator *it )
+{
+  if( !it ) {
+    return;
+  }
+  it->tree = tree;
+  it->next = tree && parent < tree->length ? tree->nodes[ parent ].first_child
+                                           : WEBVTT_NO_NODE;
+}
+
+WEBVTT_EXPORT const webvtt_flat_node *
+webvtt_flat_next( webvtt_flat_iterator *it )
+{
+  const webvtt_flat_node *node;
+  if( !it || it->next == WEBVTT_NO_NODE ) {
+    return 0;
+  }
+  node = it->tree->nodes + it->next;
+  it->next = node->next_sibling;
+  return node;
+}
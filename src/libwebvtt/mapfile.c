@@ -0,0 +1,246 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "parser_internal.h"
+#include <stdio.h>
+#include <string.h>
+#if WEBVTT_OS_WIN32
+# include <windows.h>
+#elif defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+# define WEBVTT_HAVE_MMAP 1
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+/**
+ * Fallback for when a document can't be mapped: read the whole thing into a
+ * heap buffer, which is released along with the string wrapping it.
+ */
+static void
+release_buffer( webvtt_string_data *d )
+{
+  webvtt_free( d->text );
+}
+
+static webvtt_status
+read_file( const char *path, webvtt_string *out )
+{
+  webvtt_status status = WEBVTT_SUCCESS;
+  FILE *fh;
+  char *text = 0;
+  webvtt_uint32 length = 0, alloc = 0;
+
+  if( !( fh = fopen( path, "rb" ) ) ) {
+    return WEBVTT_UNSUCCESSFUL;
+  }
+
+  for( ;; ) {
+    size_t n;
+    if( length == alloc ) {
+      char *p;
+      alloc = alloc ? alloc * 2 : 0x10000;
+      if( alloc <= length || !( p = ( char * )webvtt_alloc( alloc ) ) ) {
+        status = WEBVTT_OUT_OF_MEMORY;
+        break;
+      }
+      if( text ) {
+        memcpy( p, text, length );
+        webvtt_free( text );
+      }
+      text = p;
+    }
+    n = fread( text + length, 1, alloc - length, fh );
+    length += ( webvtt_uint32 )n;
+    if( n == 0 ) {
+      if( ferror( fh ) ) {
+        status = WEBVTT_UNSUCCESSFUL;
+      }
+      break;
+    }
+  }
+  fclose( fh );
+
+  if( status == WEBVTT_SUCCESS ) {
+    if( length == 0 ) {
+      webvtt_init_string( out );
+    } else if( !WEBVTT_FAILED( status = webvtt_create_external_string( out,
+                               text, length, &release_buffer ) ) ) {
+      return WEBVTT_SUCCESS;
+    }
+  }
+  webvtt_free( text );
+  return status;
+}
+
+#if WEBVTT_OS_WIN32
+static void
+release_mapping( webvtt_string_data *d )
+{
+  UnmapViewOfFile( d->text );
+}
+
+static webvtt_status
+map_file( const char *path, webvtt_string *out )
+{
+  webvtt_status status;
+  HANDLE file, mapping;
+  LARGE_INTEGER size;
+  char *text;
+
+  file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+                      FILE_FLAG_SEQUENTIAL_SCAN, 0 );
+  if( file == INVALID_HANDLE_VALUE ) {
+    return WEBVTT_UNSUCCESSFUL;
+  }
+  if( !GetFileSizeEx( file, &size ) ) {
+    CloseHandle( file );
+    return WEBVTT_UNSUCCESSFUL;
+  }
+  if( size.QuadPart == 0 || size.QuadPart > 0xFFFFFFFE ) {
+    CloseHandle( file );
+    return read_file( path, out );
+  }
+
+  /**
+   * The view is copy-on-write, so that the parser can terminate the strings
+   * it borrows from it in place.
+   */
+  mapping = CreateFileMappingA( file, 0, PAGE_WRITECOPY, 0, 0, 0 );
+  CloseHandle( file );
+  if( !mapping ) {
+    return read_file( path, out );
+  }
+  text = ( char * )MapViewOfFile( mapping, FILE_MAP_COPY, 0, 0, 0 );
+  CloseHandle( mapping );
+  if( !text ) {
+    return read_file( path, out );
+  }
+
+  if( WEBVTT_FAILED( status = webvtt_create_external_string( out, text,
+                     ( webvtt_uint32 )size.QuadPart, &release_mapping ) ) ) {
+    UnmapViewOfFile( text );
+  }
+  return status;
+}
+#elif WEBVTT_HAVE_MMAP
+static void
+release_mapping( webvtt_string_data *d )
+{
+  munmap( d->text, d->length );
+}
+
+static webvtt_status
+map_file( const char *path, webvtt_string *out )
+{
+  webvtt_status status;
+  struct stat st;
+  void *text;
+  int fd;
+
+  if( ( fd = open( path, O_RDONLY ) ) < 0 ) {
+    return WEBVTT_UNSUCCESSFUL;
+  }
+  if( fstat( fd, &st ) != 0 ) {
+    close( fd );
+    return WEBVTT_UNSUCCESSFUL;
+  }
+  if( !S_ISREG( st.st_mode ) || st.st_size == 0
+      || ( unsigned long long )st.st_size > 0xFFFFFFFEULL ) {
+    /* Pipes and such have to be read the old-fashioned way */
+    close( fd );
+    return read_file( path, out );
+  }
+
+  /**
+   * The mapping is private and writable, so that the parser can terminate the
+   * strings it borrows from it in place. Only the pages which are written to
+   * ever get copied.
+   */
+  text = mmap( 0, ( size_t )st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+               fd, 0 );
+  close( fd );
+  if( text == MAP_FAILED ) {
+    return read_file( path, out );
+  }
+#ifdef MADV_SEQUENTIAL
+  madvise( text, ( size_t )st.st_size, MADV_SEQUENTIAL );
+#endif
+
+  if( WEBVTT_FAILED( status = webvtt_create_external_string( out,
+                     ( char * )text, ( webvtt_uint32 )st.st_size,
+                     &release_mapping ) ) ) {
+    munmap( text, ( size_t )st.st_size );
+  }
+  return status;
+}
+#else
+static webvtt_status
+map_file( const char *path, webvtt_string *out )
+{
+  return read_file( path, out );
+}
+#endif
+
+WEBVTT_EXPORT webvtt_status
+webvtt_parse_mapped_file( webvtt_parser self, const char *path )
+{
+  webvtt_status status = WEBVTT_SUCCESS, finish_status;
+
+  if( !self || !path || self->source.d || self->finished ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  if( WEBVTT_FAILED( status = map_file( path, &self->source ) ) ) {
+    self->source.d = 0;
+    return status;
+  }
+
+  /**
+   * The whole document is handed to the parser in one piece, which lets it
+   * refer to lines of cue text in place rather than copying them.
+   */
+  if( webvtt_string_length( &self->source ) ) {
+    status = webvtt_parse_chunk( self, webvtt_string_text( &self->source ),
+                                 webvtt_string_length( &self->source ) );
+  }
+  finish_status = webvtt_finish_parsing( self );
+
+  /**
+   * Cues which borrow text from the document keep it alive. Those allocated
+   * from an arena are never released individually, so the parser keeps the
+   * document until it is deleted along with the arena.
+   */
+  if( !self->arena ) {
+    webvtt_release_string( &self->source );
+  }
+
+  return WEBVTT_FAILED( status ) ? status : finish_status;
+}
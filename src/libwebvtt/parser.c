@@ -28,15 +28,11 @@
 #include "parser_internal.h"
 #include "cuetext_internal.h"
 #include "cue_internal.h"
+#include "scan_internal.h"
 #include <string.h>
 
 #define _ERROR(X) do { if( skip_error == 0 ) { ERROR(X); } } while(0)
 
-static const char separator[] = {
-  '-', '-', '>'
-};
-/* UTF8 encoding of U+FFFD REPLACEMENT CHAR */
-static const char replacement[] = { 0xEF, 0xBF, 0xBD };
 
 #define MSECS_PER_HOUR (3600000)
 #define MSECS_PER_MINUTE (60000)
@@ -44,25 +40,29 @@ static const char replacement[] = { 0xEF, 0xBF, 0xBD };
 #define BUFFER (self->buffer + self->position)
 #define MALFORMED_TIME ((webvtt_timestamp_t)-1.0)
 
-static webvtt_status find_bytes( const char *buffer, webvtt_uint len,
-                                 const char *sbytes, webvtt_uint slen );
-
-WEBVTT_EXPORT webvtt_status
-webvtt_create_parser( webvtt_cue_fn on_read,
-                      webvtt_error_fn on_error, void *
-                      userdata,
-                      webvtt_parser *ppout )
+static webvtt_status
+create_parser( webvtt_cue_fn on_read, webvtt_error_fn on_error, void *userdata,
+               webvtt_arena *arena, webvtt_parser *ppout )
 {
   webvtt_parser p;
-  if( !on_read || !on_error || !ppout ) {
+  if( !on_error || !ppout ) {
+    webvtt_delete_arena( arena );
     return WEBVTT_INVALID_PARAM;
   }
 
-  if( !( p = ( webvtt_parser )webvtt_alloc0( sizeof * p ) ) ) {
+  if( arena ) {
+    webvtt_arena *previous = webvtt_use_arena( arena );
+    p = ( webvtt_parser )webvtt_alloc0( sizeof * p );
+    webvtt_use_arena( previous );
+  } else {
+    p = ( webvtt_parser )webvtt_alloc0( sizeof * p );
+  }
+  if( !p ) {
+    webvtt_delete_arena( arena );
     return WEBVTT_OUT_OF_MEMORY;
   }
 
-  memset( p->astack, 0, sizeof( p->astack ) );
+  /* webvtt_alloc0() has cleared everything which isn't set here */
   p->stack = p->astack;
   p->top = p->stack;
   p->top->state = T_INITIAL;
@@ -73,11 +73,124 @@ webvtt_create_parser( webvtt_cue_fn on_read,
   p->column = p->line = 1;
   p->userdata = userdata;
   p->finished = 0;
+  p->arena = arena;
+  p->stats.stack_depth = 1;
+  /* The parser itself counts as allocated */
+  p->alloc_stats.allocs = 1;
+  p->alloc_stats.live_bytes = p->alloc_stats.peak_bytes = sizeof *p;
+  webvtt_init_cuetext_context( &p->cuetext );
   *ppout = p;
 
   return WEBVTT_SUCCESS;
 }
 
+WEBVTT_EXPORT webvtt_status
+webvtt_create_parser( webvtt_cue_fn on_read,
+                      webvtt_error_fn on_error, void *
+                      userdata,
+                      webvtt_parser *ppout )
+{
+  return create_parser( on_read, on_error, userdata, 0, ppout );
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_create_parser_with_arena( webvtt_cue_fn on_read,
+                                 webvtt_error_fn on_error, void *userdata,
+                                 webvtt_uint slab_size, webvtt_parser *ppout )
+{
+  webvtt_arena *arena;
+  webvtt_status status;
+  if( WEBVTT_FAILED( status = webvtt_create_arena( slab_size, &arena ) ) ) {
+    return status;
+  }
+  return create_parser( on_read, on_error, userdata, arena, ppout );
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_set_parser_options( webvtt_parser self, webvtt_uint options )
+{
+  if( !self || ( options & ~WEBVTT_PARSE_LAZY_CUETEXT ) ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  self->options = options;
+  return WEBVTT_SUCCESS;
+}
+
+WEBVTT_EXPORT webvtt_uint
+webvtt_get_parser_options( webvtt_parser self )
+{
+  return self ? self->options : 0;
+}
+
+/**
+ * Hand the cues collected for 'read_cues' to the application
+ */
+static void
+flush_cues( webvtt_parser self )
+{
+  webvtt_uint count = self->cue_count;
+  if( count ) {
+    self->cue_count = 0;
+    self->read_cues( self->userdata, self->cues, count );
+  }
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_set_parser_cues_fn( webvtt_parser self, webvtt_cues_fn on_cues,
+                           webvtt_uint block_size )
+{
+  if( !self || ( on_cues && !block_size ) ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  if( self->read_cues ) {
+    flush_cues( self );
+  }
+  if( on_cues && block_size > self->cue_block ) {
+    webvtt_cue **cues;
+    if( !( cues = ( webvtt_cue ** )webvtt_alloc( block_size *
+                                                 sizeof *cues ) ) ) {
+      return WEBVTT_OUT_OF_MEMORY;
+    }
+    webvtt_free( self->cues );
+    self->cues = cues;
+  }
+  self->read_cues = on_cues;
+  if( on_cues ) {
+    self->cue_block = block_size;
+  }
+  return WEBVTT_SUCCESS;
+}
+
+/**
+ * Keep a cue for webvtt_parser_next_cue()
+ */
+static webvtt_status
+pull_cue( webvtt_parser self, webvtt_cue *cue )
+{
+  if( self->pulled_head ) {
+    memmove( self->pulled, self->pulled + self->pulled_head,
+             self->pulled_count * sizeof *self->pulled );
+    self->pulled_head = 0;
+  }
+  if( self->pulled_count == self->pulled_alloc ) {
+    webvtt_uint alloc = self->pulled_alloc ? self->pulled_alloc * 2 : 4;
+    webvtt_cue **pulled;
+    if( !( pulled = ( webvtt_cue ** )webvtt_alloc( alloc *
+                                                   sizeof *pulled ) ) ) {
+      return WEBVTT_OUT_OF_MEMORY;
+    }
+    if( self->pulled_count ) {
+      memcpy( pulled, self->pulled, self->pulled_count * sizeof *pulled );
+    }
+    webvtt_free( self->pulled );
+    self->pulled = pulled;
+    self->pulled_alloc = alloc;
+  }
+  self->pulled[ self->pulled_count++ ] = cue;
+  return WEBVTT_SUCCESS;
+}
+
 /**
  * Helper to validate a cue and, if valid, notify the application that a cue has
  * been read.
@@ -93,10 +206,23 @@ finish_cue( webvtt_parser self, webvtt_cue **pcue )
   if( pcue ) {
     webvtt_cue *cue = *pcue;
     if( cue ) {
-      if( webvtt_validate_cue( cue ) ) {
+      if( !webvtt_validate_cue( cue ) ) {
+        ++self->stats.dropped_cues;
+        webvtt_release_cue( &cue );
+      } else if( self->read_cues ) {
+        ++self->stats.cues;
+        self->cues[ self->cue_count++ ] = cue;
+        if( self->cue_count == self->cue_block ) {
+          flush_cues( self );
+        }
+      } else if( self->read ) {
+        ++self->stats.cues;
         self->read( self->userdata, cue );
-      } else {
+      } else if( WEBVTT_FAILED( pull_cue( self, cue ) ) ) {
+        ++self->stats.dropped_cues;
         webvtt_release_cue( &cue );
+      } else {
+        ++self->stats.cues;
       }
       *pcue = 0;
     }
@@ -113,6 +239,8 @@ WEBVTT_INTERN void
 cleanup_stack( webvtt_parser self )
 {
   webvtt_state *st = self->top;
+  self->cue_line = self->span = 0;
+  self->span_length = 0;
   while( st >= self->stack ) {
     switch( st->type ) {
       case V_CUE:
@@ -137,18 +265,75 @@ cleanup_stack( webvtt_parser self )
     }
     --st;
   }
-  if( self->stack != self->astack ) {
+  /**
+   * A stack which had to move to the heap stays there until the parser is
+   * deleted, as a document which needed it once may well need it again.
+   */
+}
+
+/**
+ * Read whatever is left over at the end of the document
+ */
+static webvtt_status
+finish_document( webvtt_parser self )
+{
+  webvtt_status status = WEBVTT_SUCCESS;
+  const char buffer[] = "\0";
+  const webvtt_uint len = 0;
+  webvtt_uint pos = 0;
+
+retry:
+  switch( self->mode ) {
+    /**
+     * We've left off parsing cue settings and are not in the empty state,
+     * return WEBVTT_CUE_INCOMPLETE.
+     */
+    case M_WEBVTT:
+      if( self->top->state == T_CUEREAD ) {
+        SAFE_ASSERT( self->top != self->stack );
+        --self->top;
+        self->popped = 1;
+      }
+
+      if( self->top->state == T_CUE ) {
+        webvtt_string text;
+        webvtt_cue *cue;
+        if( self->top->type == V_NONE ) {
+          webvtt_create_cue( &self->top->v.cue );
+          self->top->type = V_CUE;
+        }
+        cue = self->top->v.cue;
+        SAFE_ASSERT( self->popped && (self->top+1)->state == T_CUEREAD );
+        SAFE_ASSERT( cue != 0 );
+        text.d = (self->top+1)->v.text.d;
+        (self->top+1)->v.text.d = 0;
+        (self->top+1)->type = V_NONE;
+        (self->top+1)->state = 0;
+        self->column = 1;
+        status = webvtt_proc_cueline( self, cue, &text );
+        if( cue_is_incomplete( cue ) ) {
+          ERROR( WEBVTT_CUE_INCOMPLETE );
+        }
+        ++self->line;
+        self->column = 1;
+        if( self->mode == M_CUETEXT ) {
+          goto retry;
+        }
+      }
+      break;
     /**
-     * If the stack is dynamically allocated (probably not),
-     * then point it to the statically allocated one (and zeromem it),
-     * then finally delete the old dynamically allocated stack
+     * We've left off on trying to read in a cue text.
+     * Parse the partial cue text read and pass the cue back to the
+     * application if possible.
      */
-    webvtt_state *pst = self->stack;
-    memset( self->astack, 0, sizeof( self->astack ) );
-    self->stack = self->astack;
-    self->stack_alloc = sizeof( self->astack ) / sizeof( *( self->astack ) );
-    webvtt_free( pst );
+    case M_CUETEXT:
+      status = webvtt_proc_cuetext( self, buffer, &pos, len, self->finished );
+      break;
+    case M_SKIP_CUE:
+      /* Nothing to do here. */
+      break;
   }
+  return status;
 }
 
 /**
@@ -158,77 +343,145 @@ WEBVTT_EXPORT webvtt_status
 webvtt_finish_parsing( webvtt_parser self )
 {
   webvtt_status status = WEBVTT_SUCCESS;
-  const char buffer[] = "\0";
-  const webvtt_uint len = 0;
-  webvtt_uint pos = 0;
+  webvtt_alloc_stats *previous_stats;
 
+  /**
+   * Whatever is left of the last chunk is read now, as it may not be around
+   * later, so cues which are still to be pulled pile up.
+   */
+  if( self->pending_length ) {
+    const char *pending = self->pending;
+    webvtt_uint pending_length = self->pending_length;
+    self->pending = 0;
+    self->pending_length = 0;
+    self->draining = 1;
+    status = webvtt_parse_chunk( self, pending, pending_length );
+    self->draining = 0;
+    /**
+     * A cue being skipped to the end of the chunk leaves it asking for more,
+     * but there is no more, so the document is finished all the same.
+     */
+    if( status == WEBVTT_UNFINISHED ) {
+      status = WEBVTT_SUCCESS;
+    } else if( WEBVTT_FAILED( status ) ) {
+      return status;
+    }
+  }
+
+  previous_stats = webvtt_use_alloc_stats( &self->alloc_stats );
   if( !self->finished ) {
+    webvtt_arena *previous = webvtt_use_arena( self->arena );
     self->finished = 1;
-
-retry:
-    switch( self->mode ) {
-      /**
-       * We've left off parsing cue settings and are not in the empty state,
-       * return WEBVTT_CUE_INCOMPLETE.
-       */
-      case M_WEBVTT:
-        if( self->top->state == T_CUEREAD ) {
-          SAFE_ASSERT( self->top != self->stack );
-          --self->top;
-          self->popped = 1;
-        }
-
-        if( self->top->state == T_CUE ) {
-          webvtt_string text;
-          webvtt_cue *cue;
-          if( self->top->type == V_NONE ) {
-            webvtt_create_cue( &self->top->v.cue );
-            self->top->type = V_CUE;
-          }
-          cue = self->top->v.cue;
-          SAFE_ASSERT( self->popped && (self->top+1)->state == T_CUEREAD );
-          SAFE_ASSERT( cue != 0 );
-          text.d = (self->top+1)->v.text.d;
-          (self->top+1)->v.text.d = 0;
-          (self->top+1)->type = V_NONE;
-          (self->top+1)->state = 0;
-          self->column = 1;
-          status = webvtt_proc_cueline( self, cue, &text );
-          if( cue_is_incomplete( cue ) ) {
-            ERROR( WEBVTT_CUE_INCOMPLETE );
-          }
-          ++self->line;
-          self->column = 1;
-          if( self->mode == M_CUETEXT ) {
-            goto retry;
-          }
-        }
-        break;
-      /**
-       * We've left off on trying to read in a cue text.
-       * Parse the partial cue text read and pass the cue back to the
-       * application if possible.
-       */
-      case M_CUETEXT:
-        status = webvtt_proc_cuetext( self, buffer, &pos, len, self->finished );
-        break;
-      case M_SKIP_CUE:
-        /* Nothing to do here. */
-        break;
-    }
+    status = finish_document( self );
     cleanup_stack( self );
+    webvtt_use_arena( previous );
+  }
+  if( self->read_cues ) {
+    flush_cues( self );
   }
+  webvtt_use_alloc_stats( previous_stats );
 
   return status;
 }
 
+WEBVTT_EXPORT webvtt_status
+webvtt_reset_parser( webvtt_parser self )
+{
+  webvtt_alloc_stats *previous_stats;
+  if( !self ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  if( self->arena ) {
+    /* An arena only gives its memory back when it is deleted */
+    return WEBVTT_NOT_SUPPORTED;
+  }
+
+  previous_stats = webvtt_use_alloc_stats( &self->alloc_stats );
+  while( self->cue_count ) {
+    webvtt_release_cue( &self->cues[ --self->cue_count ] );
+  }
+  while( self->pulled_count ) {
+    webvtt_release_cue( &self->pulled[ self->pulled_head
+                                       + --self->pulled_count ] );
+  }
+  self->pulled_head = 0;
+  self->pending = 0;
+  self->pending_length = 0;
+  self->draining = 0;
+
+  /**
+   * The stack, line_buffer and the cue text tokenizer's buffers are kept for
+   * the next document, everything else goes back to how
+   * webvtt_create_parser() left it.
+   */
+  cleanup_stack( self );
+  memset( self->stack, 0, sizeof *self->stack * self->stack_alloc );
+  self->top->state = T_INITIAL;
+  self->popped = 0;
+  self->mode = M_WEBVTT;
+  self->state = 0;
+  self->bytes = 0;
+  self->column = self->line = 1;
+  self->cuetext_line = 0;
+  self->finished = 0;
+  self->truncate = 0;
+  self->line_pos = 0;
+  webvtt_string_clear( &self->line_buffer );
+  webvtt_release_string( &self->source );
+  self->tstate = L_START;
+  self->token_pos = 0;
+  self->token[ 0 ] = 0;
+  webvtt_use_alloc_stats( previous_stats );
+
+  /**
+   * Counting starts over as it does for a new parser, with what was kept still
+   * live
+   */
+  memset( &self->stats, 0, sizeof self->stats );
+  self->stats_cr = 0;
+  self->stats.stack_depth = 1;
+  self->alloc_stats.allocs = 1;
+  self->alloc_stats.frees = 0;
+  self->alloc_stats.string_grows = 0;
+  self->alloc_stats.peak_bytes = self->alloc_stats.live_bytes;
+  return WEBVTT_SUCCESS;
+}
+
 WEBVTT_EXPORT void
 webvtt_delete_parser( webvtt_parser self )
 {
   if( self ) {
+    while( self->cue_count ) {
+      webvtt_release_cue( &self->cues[ --self->cue_count ] );
+    }
+    webvtt_free( self->cues );
+    while( self->pulled_count ) {
+      webvtt_release_cue( &self->pulled[ self->pulled_head
+                                         + --self->pulled_count ] );
+    }
+    webvtt_free( self->pulled );
+
+    if( self->arena ) {
+      /**
+       * Everything the parser allocated goes away with the arena, including
+       * the slices of a mapped document which are still holding on to it.
+       */
+      if( self->source.d ) {
+        self->source.d->refs.value = 1;
+        webvtt_release_string( &self->source );
+      }
+      webvtt_delete_arena( self->arena );
+      return;
+    }
+
     cleanup_stack( self );
+    if( self->stack != self->astack ) {
+      webvtt_free( self->stack );
+    }
 
     webvtt_release_string( &self->line_buffer );
+    webvtt_release_string( &self->source );
+    webvtt_release_cuetext_context( &self->cuetext );
     webvtt_free( self );
   }
 }
@@ -248,38 +501,18 @@ webvtt_delete_parser( webvtt_parser self )
 static int
 find_newline( const char *buffer, webvtt_uint *pos, webvtt_uint len )
 {
-  while( *pos < len ) {
-    if( buffer[ *pos ] == '\r' || buffer[ *pos ] == '\n' ) {
-      return 1;
-    } else {
-      ( *pos )++;
-    }
-  }
-  return -1;
+  const char *eol = webvtt_scan_eol( buffer + *pos, buffer + len );
+  *pos = ( webvtt_uint )( eol - buffer );
+  return *pos < len ? 1 : -1;
 }
 
 /**
- * basic strnstr-ish routine
+ * Does the line contain the cue timings separator, "-->"?
  */
-static webvtt_status
-find_bytes( const char *buffer, webvtt_uint len,
-    const char *sbytes, webvtt_uint slen )
+static int
+has_separator( const char *text, webvtt_uint len )
 {
-  webvtt_uint slen2;
-  // check params for integrity
-  if( !buffer || len < 1 || !sbytes || slen < 1 ) {
-    return WEBVTT_INVALID_PARAM;
-  }
-
-  slen2 = slen - 1;
-  while( len-- >= slen && *buffer ){
-    if( *buffer == *sbytes && memcmp( buffer + 1, sbytes + 1, slen2 ) == 0 ) {
-      return WEBVTT_SUCCESS;
-    }
-    buffer++;
-  }
-
-  return WEBVTT_NO_MATCH_FOUND;
+  return text && webvtt_scan_separator( text, text + len ) != 0;
 }
 
 /**
@@ -287,7 +520,6 @@ find_bytes( const char *buffer, webvtt_uint len,
  */
 #define SP (self->top)
 #define AT_BOTTOM (self->top == self->stack)
-#define ON_HEAP (self->stack_alloc == sizeof(p->astack) / sizeof(p->astack[0]))
 #define STACK_SIZE ((webvtt_uint)(self->top - self->stack))
 #define FRAME(i) (self->top - (i))
 #define FRAMEUP(i) (self->top + (i))
@@ -312,12 +544,16 @@ do_push( webvtt_parser self, webvtt_uint token, webvtt_uint back,
     memcpy( stack, self->stack, sizeof( webvtt_state ) * self->stack_alloc );
     tmp = self->stack;
     self->stack = stack;
+    self->stack_alloc <<= 1;
     self->top = stack + ( self->top - tmp );
     if( tmp != self->astack ) {
       webvtt_free( tmp );
     }
   }
   ++self->top;
+  if( STACK_SIZE >= self->stats.stack_depth ) {
+    self->stats.stack_depth = STACK_SIZE + 1;
+  }
   self->top->state = state;
   self->top->flags = 0;
   self->top->type = type;
@@ -378,7 +614,9 @@ webvtt_collect_timestamp( webvtt_parser self, webvtt_timestamp *result,
   int column = self->column;
   int line = self->line;
   int len;
-  int rv = webvtt_parse_timestamp( webvtt_string_text(input) + *position, &len, result );
+  int rv = webvtt_parse_timestamp( webvtt_string_text( input ) + *position,
+                                   webvtt_string_length( input ) - *position,
+                                   &len, result );
   if( !rv ) {
     if( BAD_TIMESTAMP(*result) ) {
       ERROR_AT( WEBVTT_EXPECTED_TIMESTAMP, line, column );
@@ -405,7 +643,6 @@ webvtt_collect_timings_and_settings( webvtt_parser self,
                                      webvtt_cue *cue )
 {
   webvtt_status s;
-  webvtt_string settings;
 
   /* 1. Let input be the string being parsed. */
   const webvtt_string *input = line;
@@ -483,10 +720,9 @@ webvtt_collect_timings_and_settings( webvtt_parser self,
   /**
    * 11. Let remainder be the trailing substring of input starting at position.
    */
-  webvtt_create_string_with_text( &settings,
-                                  webvtt_string_text( input ) + position, -1 );
-  webvtt_cue_validate_set_settings( self, cue, &settings );
-  webvtt_release_string( &settings );
+  webvtt_cue_set_settings_from_text( self, cue,
+                                     webvtt_string_text( input ) + position,
+                                     webvtt_string_length( input ) - position );
 
   return WEBVTT_SUCCESS;
 }
@@ -496,14 +732,15 @@ webvtt_proc_cueline( webvtt_parser self, webvtt_cue *cue,
                      webvtt_string *line )
 {
   const char *text;
+  const char *cue_line = self->cue_line;
   webvtt_uint length;
   DIE_IF( line == NULL );
+  self->cue_line = 0;
   length = webvtt_string_length( line );
   text = webvtt_string_text( line );
   /* backup the column */
   self->column = 1;
-  if( find_bytes( text, length, separator, sizeof( separator ) )
-      == WEBVTT_SUCCESS) {
+  if( has_separator( text, length ) ) {
     /* It's not a cue id, we found '-->'. It can't be a second
        cueparams line, because if we had it, we would be in
        a different state. */
@@ -535,10 +772,19 @@ webvtt_proc_cueline( webvtt_parser self, webvtt_cue *cue,
       webvtt_uint last_column = self->column;
       webvtt_uint last_line = self->line;
       webvtt_token token = UNFINISHED;
+      webvtt_status status;
       self->column += length;
       self->cuetext_line = self->line;
-      if( WEBVTT_FAILED( webvtt_string_append( &cue->id, text,
-                                               length ) ) ) {
+      if( cue_line && webvtt_string_is_equal( line, cue_line, length ) ) {
+        /* The id can be shared with the mapped source */
+        webvtt_release_string( &cue->id );
+        status = webvtt_create_string_slice( &cue->id, &self->source,
+          ( webvtt_uint32 )( cue_line - webvtt_string_text( &self->source ) ),
+          length );
+      } else {
+        status = webvtt_string_append( &cue->id, text, length );
+      }
+      if( WEBVTT_FAILED( status ) ) {
         webvtt_release_string( line );
         ERROR( WEBVTT_ALLOCATION_FAILED );
         return WEBVTT_OUT_OF_MEMORY;
@@ -579,8 +825,10 @@ parse_webvtt( webvtt_parser self, const char *buffer, webvtt_uint *ppos,
       DIE_IF( SP->type != V_TEXT );
       if( SP->flags == 0 ) {
         int v;
-        if( ( v = webvtt_string_getline( &SP->v.text, buffer, &pos, len, 0,
-                                         finish ) ) ) {
+        /* replace '\0' with u+fffd */
+        if( ( v = webvtt_string_getline_replace_nul( &SP->v.text, buffer,
+                                                     &pos, len, 0,
+                                                     finish ) ) ) {
           if( v < 0 ) {
             webvtt_release_string( &SP->v.text );
             SP->type = V_NONE;
@@ -589,17 +837,6 @@ parse_webvtt( webvtt_parser self, const char *buffer, webvtt_uint *ppos,
             status = WEBVTT_OUT_OF_MEMORY;
             goto _finish;
           }
-          /* replace '\0' with u+fffd */
-          if( WEBVTT_FAILED( status = webvtt_string_replace_all( &SP->v.text,
-                                                                 "\0", 1,
-                                                                 replacement,
-                                                                 3 ) ) ) {
-            webvtt_release_string( &SP->v.text );
-            SP->type = V_NONE;
-            POP();
-            ERROR( WEBVTT_ALLOCATION_FAILED );
-            goto _finish;
-          }
           SP->flags = 1;
         }
       }
@@ -776,6 +1013,10 @@ _recheck:
           PUSH0( T_CUE, cue, V_CUE );
           PUSH0( T_CUEREAD, 0, V_TEXT );
           SP->v.text.d = tk.d;
+          if( self->source.d && buffer == webvtt_string_text( &self->source )
+              && pos >= self->token_pos ) {
+            self->cue_line = buffer + pos - self->token_pos;
+          }
         }
         break;
 
@@ -829,6 +1070,82 @@ _finish:
   return status;
 }
 
+/**
+ * Materialize the part of the source collected as the payload of 'cue' so far
+ * into its body, so that a line which does not directly follow it can be
+ * appended.
+ */
+static webvtt_status
+flush_cuetext_span( webvtt_parser self, webvtt_cue *cue )
+{
+  webvtt_status status = WEBVTT_SUCCESS;
+  if( self->span ) {
+    status = webvtt_string_append( &cue->body, self->span,
+                                   self->span_length );
+    self->span = 0;
+    self->span_length = 0;
+  }
+  return status;
+}
+
+/**
+ * Once the payload of 'cue' is complete, turn the part of the source which has
+ * been collected as its payload into the body of the cue, without copying it.
+ */
+static webvtt_status
+finish_cuetext_span( webvtt_parser self, webvtt_cue *cue )
+{
+  webvtt_status status = WEBVTT_SUCCESS;
+  if( self->span ) {
+    webvtt_string body;
+    webvtt_uint32 offset = ( webvtt_uint32 )( self->span -
+                           webvtt_string_text( &self->source ) );
+    if( !WEBVTT_FAILED( status = webvtt_create_string_slice( &body,
+                        &self->source, offset, self->span_length ) ) ) {
+      webvtt_release_string( &cue->body );
+      cue->body.d = body.d;
+    }
+    self->span = 0;
+    self->span_length = 0;
+  }
+  return status;
+}
+
+/**
+ * Append a line of cue text to the payload of 'cue'.
+ *
+ * Lines read straight out of a mapped source which follow each other,
+ * separated by a single line feed, are collected as one span of the source
+ * rather than being copied.
+ */
+static webvtt_status
+append_cuetext_line( webvtt_parser self, webvtt_cue *cue, const char *line,
+                     webvtt_uint length, webvtt_bool in_source )
+{
+  webvtt_status status;
+  if( in_source ) {
+    if( !self->span && webvtt_string_length( &cue->body ) == 0 ) {
+      self->span = line;
+      self->span_length = length;
+      return WEBVTT_SUCCESS;
+    } else if( self->span
+               && line == self->span + self->span_length + 1
+               && self->span[ self->span_length ] == '\n' ) {
+      self->span_length += length + 1;
+      return WEBVTT_SUCCESS;
+    }
+  }
+
+  if( WEBVTT_FAILED( status = flush_cuetext_span( self, cue ) ) ) {
+    return status;
+  }
+  if( webvtt_string_length( &cue->body ) &&
+      WEBVTT_FAILED( status = webvtt_string_putc( &cue->body, '\n' ) ) ) {
+    return status;
+  }
+  return webvtt_string_append( &cue->body, line, length );
+}
+
 WEBVTT_INTERN webvtt_status
 webvtt_read_cuetext( webvtt_parser self, const char *b,
                      webvtt_uint *ppos, webvtt_uint len, webvtt_bool finish )
@@ -838,38 +1155,72 @@ webvtt_read_cuetext( webvtt_parser self, const char *b,
   int finished = 0;
   int flags = 0;
   webvtt_cue *cue;
+  /**
+   * A line which is read directly out of 'b', rather than being copied into
+   * line_buffer first.
+   */
+  const char *line = 0;
+  webvtt_uint line_length = 0;
+  webvtt_bool in_source = self->source.d != 0 &&
+                          b == webvtt_string_text( &self->source );
 
   /* Ensure that we have a cue to work with */
   SAFE_ASSERT( self->top->type = V_CUE );
   cue = self->top->v.cue;
 
   /**
-   * Hack to support lines spanning multiple buffers.
-   *
-   * TODO: Do this some better way. This is not good!
+   * A line which was read to the end in the last buffer, but whose line break
+   * wasn't, is marked by a trailing '\n' in line_buffer.
    */
-  if( self->line_buffer.d != 0 && self->line_buffer.d->text[
+  if( webvtt_string_length( &self->line_buffer ) && self->line_buffer.d->text[
       self->line_buffer.d->length - 1 ] == '\n' ) {
     flags = 1;
   }
 
   do {
+    webvtt_bool copy = 0;
     if( !flags ) {
-      int v;
-      if( ( v = webvtt_string_getline( &self->line_buffer, b, &pos, len,
-                                       &self->truncate, finish ) ) ) {
-        if( v < 0 || WEBVTT_FAILED( webvtt_string_putc( &self->line_buffer,
-                                                        '\n' ) ) ) {
+      /**
+       * If the whole line is in this buffer and there is nothing to replace
+       * in it, there is no need to copy it anywhere. If it is split across
+       * buffers, its pieces are copied into line_buffer as they are found.
+       * Anything else is left to webvtt_string_getline_replace_nul().
+       */
+      webvtt_uint begin = pos;
+      webvtt_uint buffered = webvtt_string_length( &self->line_buffer );
+      webvtt_bool nul, eol;
+      pos = ( webvtt_uint )( webvtt_scan_eol_nul( b + pos, b + len, &nul ) - b );
+      eol = pos < len || finish;
+      if( nul || buffered + ( pos - begin ) + 1 >= WEBVTT_MAX_LINE ) {
+        pos = begin;
+        copy = 1;
+      } else if( eol && !buffered ) {
+        line = b + begin;
+        line_length = pos - begin;
+        flags = 1;
+      } else {
+        if( WEBVTT_FAILED( status = webvtt_string_append( &self->line_buffer,
+                                                          b + begin,
+                                                          pos - begin ) )
+            || ( eol && WEBVTT_FAILED( status = webvtt_string_putc(
+                                         &self->line_buffer, '\n' ) ) ) ) {
           ERROR( WEBVTT_ALLOCATION_FAILED );
           status = WEBVTT_OUT_OF_MEMORY;
           goto _finish;
         }
-        /* replace '\0' with u+fffd */
-        if( WEBVTT_FAILED( status =
-                           webvtt_string_replace_all( &self->line_buffer,
-                                                      "\0", 1, replacement,
-                                                      3 ) ) ) {
+        flags = eol;
+      }
+    }
+    if( copy ) {
+      int v;
+      /* replace '\0' with u+fffd */
+      if( ( v = webvtt_string_getline_replace_nul( &self->line_buffer, b, &pos,
+                                                   len, &self->truncate,
+                                                   finish ) ) ) {
+        if( v < 0 || WEBVTT_FAILED( webvtt_string_putc( &self->line_buffer,
+                                                        '\n' ) ) ) {
           ERROR( WEBVTT_ALLOCATION_FAILED );
+          status = WEBVTT_OUT_OF_MEMORY;
           goto _finish;
         }
 
@@ -879,31 +1230,38 @@ webvtt_read_cuetext( webvtt_parser self, const char *b,
     if( flags ) {
       webvtt_token token = webvtt_lex_newline( self, b, &pos, len, finish );
       if( token == NEWLINE ) {
+        webvtt_bool from_source = in_source && line != 0;
         self->token_pos = 0;
         self->line++;
 
-        /* Remove the '\n' that we appended to determine that we're in state 1
-         */
-        self->line_buffer.d->text[ --self->line_buffer.d->length ] = 0;
+        if( !line ) {
+          /* Remove the '\n' that we appended to determine that we're in state
+           * 1 */
+          self->line_buffer.d->text[ --self->line_buffer.d->length ] = 0;
+          line = webvtt_string_text( &self->line_buffer );
+          line_length = webvtt_string_length( &self->line_buffer );
+        }
         /**
          * We've encountered a line without any cuetext on it, i.e. there is no
          * newline character and len is 0 or there is and len is 1, therefore,
          * the cue text is finished.
          */
-        if( self->line_buffer.d->length == 0 ) {
-          webvtt_release_string( &self->line_buffer );
+        if( line_length == 0 ) {
           finished = 1;
-        } else if( find_bytes( webvtt_string_text( &self->line_buffer ),
-                   webvtt_string_length( &self->line_buffer ), separator,
-                   sizeof( separator ) ) == WEBVTT_SUCCESS ) {
+        } else if( has_separator( line, line_length ) ) {
           /**
            * Line contains cue-times separator, and thus we treat it as a
            * separate cue. Trick program into thinking that T_CUEREAD had read
            * this line.
            */
           do_push( self, 0, 0, T_CUEREAD, 0, V_NONE, self->line, self->column );
-          webvtt_copy_string( &SP->v.text, &self->line_buffer );
-          webvtt_release_string( &self->line_buffer );
+          if( webvtt_string_length( &self->line_buffer ) ) {
+            webvtt_copy_string( &SP->v.text, &self->line_buffer );
+          } else if( WEBVTT_FAILED( status = webvtt_create_string_with_text(
+                                    &SP->v.text, line, line_length ) ) ) {
+            ERROR( WEBVTT_ALLOCATION_FAILED );
+            goto _finish;
+          }
           SP->type = V_TEXT;
           POP();
           finished = 1;
@@ -912,15 +1270,33 @@ webvtt_read_cuetext( webvtt_parser self, const char *b,
            * If it's not the end of a cue, simply append it to the cue's payload
            * text.
            */
-          if( webvtt_string_length( &cue->body ) &&
-              WEBVTT_FAILED( webvtt_string_putc( &cue->body, '\n' ) ) ) {
-            status = WEBVTT_OUT_OF_MEMORY;
+          if( WEBVTT_FAILED( status = append_cuetext_line( self, cue, line,
+                             line_length, from_source ) ) ) {
             goto _finish;
           }
-          webvtt_string_append_string( &cue->body, &self->line_buffer );
-          webvtt_release_string( &self->line_buffer );
           flags = 0;
         }
+        /**
+         * line_buffer keeps its buffer for the next line which is split
+         * across chunks, unless the cue took it
+         */
+        if( webvtt_string_length( &self->line_buffer ) ) {
+          webvtt_string_clear( &self->line_buffer );
+        }
+        line = 0;
+      } else if( line ) {
+        /**
+         * The line break is split across buffers, so the line has to be kept
+         * around until the next one.
+         */
+        if( WEBVTT_FAILED( status = webvtt_string_append( &self->line_buffer,
+                                                          line, line_length ) )
+            || WEBVTT_FAILED( status = webvtt_string_putc( &self->line_buffer,
+                                                           '\n' ) ) ) {
+          ERROR( WEBVTT_ALLOCATION_FAILED );
+          goto _finish;
+        }
+        line = 0;
       }
     }
   } while( pos < len && !finished );
@@ -930,6 +1306,11 @@ _finish:
     finished = 1;
   }
 
+  if( finished && !WEBVTT_FAILED( status ) &&
+      WEBVTT_FAILED( status = finish_cuetext_span( self, cue ) ) ) {
+    ERROR( WEBVTT_ALLOCATION_FAILED );
+  }
+
   /**
    * If we didn't encounter 2 successive EOLs, and it's not the final buffer in
    * the file, notify the caller.
@@ -940,107 +1321,220 @@ _finish:
   return status;
 }
 
-WEBVTT_INTERN webvtt_status
-webvtt_proc_cuetext( webvtt_parser self, const char *b,
-                     webvtt_uint *ppos, webvtt_uint len, webvtt_bool finish )
+/**
+ * Hand on the cue whose text webvtt_read_cuetext() has just read to the end,
+ * and go back to reading cues
+ */
+static webvtt_status
+end_cuetext( webvtt_parser self )
 {
-  webvtt_status status;
+  webvtt_status status = WEBVTT_SUCCESS;
   webvtt_cue *cue;
   SAFE_ASSERT( ( self->mode == M_CUETEXT || self->mode == M_SKIP_CUE )
                && self->top->type == V_CUE );
   cue = self->top->v.cue;
   SAFE_ASSERT( cue != 0 );
-  status  = webvtt_read_cuetext( self, b, ppos, len, finish );
 
-  if( status == WEBVTT_SUCCESS ) {
-    if( self->mode != M_SKIP_CUE ) {
-      /**
-       * Once we've successfully read the cuetext into line_buffer, call the
-       * cuetext parser from cuetext.c
-       */
-      status = webvtt_parse_cuetext( self, cue, &cue->body,
-                                     self->finished );
+  if( self->mode != M_SKIP_CUE ) {
+    /**
+     * Once we've successfully read the cuetext into line_buffer, call the
+     * cuetext parser from cuetext.c, unless the application will ask for
+     * the nodes itself if it wants them.
+     */
+    if( !( self->options & WEBVTT_PARSE_LAZY_CUETEXT ) ) {
+      status = webvtt_parse_cuetext( self, cue, &cue->body, self->finished );
+    }
+
+    /**
+     * return the cue to the user, if possible.
+     */
+    finish_cue( self, &cue );
+  } else {
+    ++self->stats.dropped_cues;
+    webvtt_release_cue( &cue );
+  }
+
+  self->top->type = V_NONE;
+  self->top->state = 0;
+  self->top->v.cue = 0;
+
+  if( (self->top+1)->type == V_NONE ) {
+    (self->top+1)->state = 0;
+    /* Pop from T_CUE state */
+    POP();
+  } else {
+    /**
+     * If we found '-->', we need to create another cue and remain
+     * in T_CUE state
+     */
+    webvtt_create_cue( &self->top->v.cue );
+    self->top->type = V_CUE;
+    self->top->state = T_CUE;
+  }
+  self->mode = M_WEBVTT;
+  return status;
+}
 
+WEBVTT_INTERN webvtt_status
+webvtt_proc_cuetext( webvtt_parser self, const char *b,
+                     webvtt_uint *ppos, webvtt_uint len, webvtt_bool finish )
+{
+  webvtt_status status;
+  SAFE_ASSERT( ( self->mode == M_CUETEXT || self->mode == M_SKIP_CUE )
+               && self->top->type == V_CUE && self->top->v.cue != 0 );
+  if( ( status = webvtt_read_cuetext( self, b, ppos, len, finish ) )
+      == WEBVTT_SUCCESS ) {
+    status = end_cuetext( self );
+  }
+  return status;
+}
+
+static webvtt_status
+parse_chunk( webvtt_parser self, const void *buffer, webvtt_uint len )
+{
+  webvtt_status status;
+  webvtt_uint pos = 0;
+  const char *b = ( const char * )buffer;
+
+  while( pos < len ) {
+    if( self->pulled_count && !self->draining ) {
+      self->pending = b + pos;
+      self->pending_length = len - pos;
+      return WEBVTT_SUCCESS;
+    }
+    if( self->mode == M_WEBVTT ) {
+      if( WEBVTT_FAILED( status = parse_webvtt( self, b, &pos, len,
+                                                self->finished ) ) ) {
+        return status;
+      }
+      continue;
+    }
+
+    /**
+     * Most chunks but the first pick up in the middle of some cue text. It is
+     * read on from where the last chunk left it, and the state stack is only
+     * looked at once the cue text has been read to the end.
+     */
+    status = webvtt_read_cuetext( self, b, &pos, len, self->finished );
+    if( status == WEBVTT_SUCCESS ) {
+      status = end_cuetext( self );
+    }
+    if( WEBVTT_FAILED( status ) ) {
       /**
-       * return the cue to the user, if possible.
+       * Cue text which goes on into the next chunk isn't really a failure,
+       * but a cue being skipped asks for more.
        */
-      finish_cue( self, &cue );
-    } else {
-      webvtt_release_cue( &cue );
+      if( status == WEBVTT_UNFINISHED && self->mode == M_CUETEXT ) {
+        return WEBVTT_SUCCESS;
+      }
+      return status;
     }
+  }
 
-    self->top->type = V_NONE;
-    self->top->state = 0;
-    self->top->v.cue = 0;
+  return WEBVTT_SUCCESS;
+}
 
-    if( (self->top+1)->type == V_NONE ) {
-      (self->top+1)->state = 0;
-      /* Pop from T_CUE state */
-      POP();
-    } else {
-      /**
-       * If we found '-->', we need to create another cue and remain
-       * in T_CUE state
-       */
-      webvtt_create_cue( &self->top->v.cue );
-      self->top->type = V_CUE;
-      self->top->state = T_CUE;
+/**
+ * Count the line breaks in the 'len' bytes at 'b', which the parser has read
+ */
+static void
+count_lines( webvtt_parser self, const char *b, webvtt_uint len )
+{
+  const char *end = b + len;
+  if( !len ) {
+    return;
+  }
+  if( self->stats_cr && *b == '\n' ) {
+    ++b;
+  }
+  self->stats_cr = 0;
+  while( ( b = webvtt_scan_eol( b, end ) ) < end ) {
+    ++self->stats.lines;
+    if( *b++ == '\r' ) {
+      if( b == end ) {
+        self->stats_cr = 1;
+      } else if( *b == '\n' ) {
+        ++b;
+      }
     }
-    self->mode = M_WEBVTT;
   }
-  return status;
 }
 
 WEBVTT_EXPORT webvtt_status
 webvtt_parse_chunk( webvtt_parser self, const void *buffer, webvtt_uint len )
 {
   webvtt_status status;
-  webvtt_uint pos = 0;
-  const char *b = ( const char * )buffer;
-
-  while( pos < len ) {
-    switch( self->mode ) {
-      case M_WEBVTT:
-        if( WEBVTT_FAILED( status = parse_webvtt( self, b, &pos, len,
-                                                  self->finished ) ) ) {
-          return status;
-        }
-        break;
+  webvtt_arena *previous;
+  webvtt_alloc_stats *previous_stats;
+  if( self->pending_length ) {
+    /* The last chunk hasn't been read to the end yet */
+    return WEBVTT_INVALID_PARAM;
+  }
+  previous_stats = webvtt_use_alloc_stats( &self->alloc_stats );
+  if( !self->arena ) {
+    status = parse_chunk( self, buffer, len );
+  } else {
+    previous = webvtt_use_arena( self->arena );
+    status = parse_chunk( self, buffer, len );
+    webvtt_use_arena( previous );
+  }
+  /* What's pending is counted when it is read */
+  self->stats.bytes += len - self->pending_length;
+  count_lines( self, ( const char * )buffer, len - self->pending_length );
+  if( self->read_cues ) {
+    flush_cues( self );
+  }
+  webvtt_use_alloc_stats( previous_stats );
+  return status;
+}
 
-      case M_CUETEXT:
-        /**
-         * read in cuetext
-         */
-        if( WEBVTT_FAILED( status = webvtt_proc_cuetext( self, b, &pos, len,
-                                                         self->finished ) ) ) {
-          if( status == WEBVTT_UNFINISHED ) {
-            /* Make an exception here, because this isn't really a failure. */
-            return WEBVTT_SUCCESS;
-          }
-          return status;
-        }
+WEBVTT_EXPORT webvtt_status
+webvtt_parser_next_cue( webvtt_parser self, webvtt_cue **pcue )
+{
+  webvtt_status status;
+  if( !self || !pcue || self->read ) {
+    return WEBVTT_INVALID_PARAM;
+  }
 
-        /* If we failed to parse cuetext, return the error */
-        if( WEBVTT_FAILED( status ) ) {
-          return status;
-        }
-        break;
+  *pcue = 0;
+  if( !self->pulled_count && self->pending_length ) {
+    const char *pending = self->pending;
+    webvtt_uint pending_length = self->pending_length;
+    self->pending = 0;
+    self->pending_length = 0;
+    if( WEBVTT_FAILED( status = webvtt_parse_chunk( self, pending,
+                                                    pending_length ) ) ) {
+      return status;
+    }
+  }
 
-      case M_SKIP_CUE:
-        if( WEBVTT_FAILED( status = webvtt_proc_cuetext( self, b, &pos, len,
-                                                         self->finished ) ) ) {
-          return status;
-        }
-        break;
+  if( self->pulled_count ) {
+    *pcue = self->pulled[ self->pulled_head++ ];
+    if( !--self->pulled_count ) {
+      self->pulled_head = 0;
     }
+    return WEBVTT_SUCCESS;
   }
+  return self->finished ? WEBVTT_SUCCESS : WEBVTT_UNFINISHED;
+}
 
+WEBVTT_EXPORT webvtt_status
+webvtt_parser_get_stats( webvtt_parser self, webvtt_parser_stats *out )
+{
+  if( !self || !out ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  *out = self->stats;
+  out->allocs = self->alloc_stats.allocs;
+  out->frees = self->alloc_stats.frees;
+  out->live_bytes = self->alloc_stats.live_bytes;
+  out->peak_bytes = self->alloc_stats.peak_bytes;
+  out->string_grows = self->alloc_stats.string_grows;
   return WEBVTT_SUCCESS;
 }
 
 #undef SP
 #undef AT_BOTTOM
-#undef ON_HEAP
 #undef STACK_SIZE
 #undef FRAME
 #undef PUSH
@@ -1078,19 +1572,159 @@ webvtt_parse_int( const char **pb, int *pdigits )
   return result * mul;
 }
 
+/**
+ * Little-endian loads, put together a byte at a time so that they are the same
+ * on any host. Compilers turn them into plain loads where they can.
+ */
+static webvtt_uint64
+load_le64( const char *b )
+{
+  const unsigned char *u = ( const unsigned char * )b;
+  return ( webvtt_uint64 )u[ 0 ] | ( webvtt_uint64 )u[ 1 ] << 8
+         | ( webvtt_uint64 )u[ 2 ] << 16 | ( webvtt_uint64 )u[ 3 ] << 24
+         | ( webvtt_uint64 )u[ 4 ] << 32 | ( webvtt_uint64 )u[ 5 ] << 40
+         | ( webvtt_uint64 )u[ 6 ] << 48 | ( webvtt_uint64 )u[ 7 ] << 56;
+}
+
+static webvtt_uint32
+load_le32( const char *b )
+{
+  const unsigned char *u = ( const unsigned char * )b;
+  return ( webvtt_uint32 )u[ 0 ] | ( webvtt_uint32 )u[ 1 ] << 8
+         | ( webvtt_uint32 )u[ 2 ] << 16 | ( webvtt_uint32 )u[ 3 ] << 24;
+}
+
+/**
+ * SWAR constants. Each byte of a word XORed with the bytes of the form it
+ * should have ('0' for digits, the separator itself for separators) is 0-9
+ * for a digit and 0 for the right separator, and every byte of x is at most 9
+ * exactly when ( ( x + ALL8( 0x76 ) ) | x ) has no high bits set.
+ */
+#define ALL8( b ) ( ( webvtt_uint64 )( b ) * 0x0101010101010101ULL )
+#define HIGH8 ALL8( 0x80 )
+#define BYTE( x, i ) ( ( webvtt_uint )( ( x ) >> ( 8 * ( i ) ) & 0xFF ) )
+
+/* "00:00:00", "00:00.00" and ".000", as little-endian words */
+#define LONG_FORM 0x30303a30303a3030ULL
+#define SHORT_FORM 0x30302e30303a3030ULL
+#define FRAC_FORM 0x3030302eUL
+/* The separator bytes of each */
+#define LONG_SEPARATORS 0x0000ff0000ff0000ULL
+#define SHORT_SEPARATORS LONG_SEPARATORS
+#define FRAC_SEPARATORS 0x000000ffUL
+
+/**
+ * Fast path for timestamps in the canonical "HH:MM:SS.mmm" and "MM:SS.mmm"
+ * forms, which are all but universal. 'length' is the number of bytes which
+ * may be read at 'b' (not counting the NUL terminator).
+ *
+ * Returns the length of the timestamp, or 0 if it isn't in one of those forms
+ * (or is out of range), in which case it is left to the general routine.
+ */
+static int
+parse_canonical_timestamp( const char *b, webvtt_uint length,
+                           webvtt_timestamp *result )
+{
+  webvtt_uint64 x, pairs;
+  webvtt_uint32 f;
+  webvtt_uint hours = 0, minutes, seconds, millis;
+  int n;
+
+  if( length < 9 ) {
+    return 0;
+  }
+
+  x = load_le64( b );
+  if( b[ 5 ] == ':' ) {
+    if( length < 12 ) {
+      return 0;
+    }
+    x ^= LONG_FORM;
+    f = load_le32( b + 8 ) ^ FRAC_FORM;
+    if( ( ( ( x + ALL8( 0x76 ) ) | x ) & HIGH8 ) || ( x & LONG_SEPARATORS ) ||
+        ( ( ( f + 0x76767676UL ) | f ) & 0x80808080UL ) ||
+        ( f & FRAC_SEPARATORS ) ) {
+      return 0;
+    }
+    /* Each pair of digits becomes one byte: tens * 10 + units */
+    pairs = x * 10 + ( x >> 8 );
+    hours = BYTE( pairs, 0 );
+    minutes = BYTE( pairs, 3 );
+    seconds = BYTE( pairs, 6 );
+    millis = BYTE( f, 1 ) * 100 + BYTE( f, 2 ) * 10 + BYTE( f, 3 );
+    n = 12;
+  } else {
+    x ^= SHORT_FORM;
+    if( ( ( ( x + ALL8( 0x76 ) ) | x ) & HIGH8 ) || ( x & SHORT_SEPARATORS ) ||
+        !webvtt_isdigit( b[ 8 ] ) ) {
+      return 0;
+    }
+    pairs = x * 10 + ( x >> 8 );
+    minutes = BYTE( pairs, 0 );
+    seconds = BYTE( pairs, 3 );
+    millis = BYTE( pairs, 6 ) * 10 + ( b[ 8 ] - '0' );
+    n = 9;
+  }
+
+  /**
+   * More fraction digits, or fields out of range, make for a malformed
+   * timestamp, which the general routine knows what to do with.
+   */
+  if( webvtt_isdigit( b[ n ] ) || minutes > 59 || seconds > 59 ) {
+    return 0;
+  }
+
+  *result = ( webvtt_timestamp )hours * MSECS_PER_HOUR
+            + ( webvtt_timestamp )minutes * MSECS_PER_MINUTE
+            + ( webvtt_timestamp )seconds * MSECS_PER_SECOND + millis;
+  return n;
+}
+
+WEBVTT_EXPORT webvtt_uint
+webvtt_parse_timestamps( const char **texts, webvtt_uint n,
+                         webvtt_timestamp *out )
+{
+  webvtt_uint i, count = 0;
+
+  if( !texts || !out ) {
+    return 0;
+  }
+
+  for( i = 0; i < n; ++i ) {
+    if( !texts[ i ] ) {
+      out[ i ] = 0xFFFFFFFFFFFFFFFF;
+    } else if( webvtt_parse_timestamp( texts[ i ],
+                                       ( webvtt_uint )strlen( texts[ i ] ), 0,
+                                       out + i ) ) {
+      ++count;
+    }
+  }
+  return count;
+}
+
 /**
  * Turn the token of a TIMESTAMP tag into something useful, and returns non-zero
  * returns 0 if it fails
  */
 WEBVTT_INTERN int
-webvtt_parse_timestamp( const char *b, int *tokenLength, webvtt_timestamp *result )
+webvtt_parse_timestamp( const char *b, webvtt_uint length, int *tokenLength,
+                        webvtt_timestamp *result )
 {
   webvtt_int64 tmp;
   int have_hours = 0;
   int digits;
   int malformed = 0;
   webvtt_int64 v[4];
-  int n = 0;
+  int n;
+
+  if( ( n = parse_canonical_timestamp( b, length, result ) ) ) {
+    if( tokenLength ) {
+      *tokenLength = n;
+    }
+    return 1;
+  }
+
+  n = 0;
   if ( !webvtt_isdigit( *b ) ) {
     goto not_timestamp;
   }
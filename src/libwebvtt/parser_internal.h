@@ -28,7 +28,9 @@
 #ifndef __INTERN_PARSER_H__
 # define __INTERN_PARSER_H__
 # include <webvtt/parser.h>
+# include "alloc_internal.h"
 # include "string_internal.h"
+# include "cuetext_internal.h"
 # ifndef NDEBUG
 #   define NDEBUG
 # endif
@@ -42,6 +44,14 @@ static void break_on_assert();
 #   endif
 # endif
 
+/**
+ * Parse states kept inside the parser itself. The stack only moves to the heap
+ * if it grows deeper than this, which no document seems to need.
+ */
+# ifndef WEBVTT_PARSER_STACK
+#   define WEBVTT_PARSER_STACK 8
+# endif
+
 typedef enum
 webvtt_token_t {
   BADTOKEN = -2,
@@ -177,9 +187,32 @@ webvtt_parser_t {
   webvtt_cue_fn read;
   webvtt_error_fn error;
   void *userdata;
+
+  /**
+   * Cues waiting to be handed to 'read_cues', which takes them up to
+   * 'cue_block' at a time (see webvtt_set_parser_cues_fn())
+   */
+  webvtt_cues_fn read_cues;
+  webvtt_cue **cues;
+  webvtt_uint cue_count;
+  webvtt_uint cue_block;
+
+  /**
+   * Without a 'read' callback, cues wait in 'pulled' for
+   * webvtt_parser_next_cue(), and reading stops after each one. 'pending' is
+   * what was left of the chunk at that point.
+   */
+  webvtt_cue **pulled;
+  webvtt_uint pulled_head;
+  webvtt_uint pulled_count;
+  webvtt_uint pulled_alloc;
+  const char *pending;
+  webvtt_uint pending_length;
+  webvtt_bool draining;
   webvtt_bool finished;
 
   webvtt_uint cuetext_line; /* start line of cuetext */
+  webvtt_uint options; /* webvtt_parser_option flags */
 
   /**
    * 'mode' can have several states, it is not boolean.
@@ -187,10 +220,10 @@ webvtt_parser_t {
   webvtt_parse_mode mode;
 
   webvtt_state *top; /* Top parse state */
-  webvtt_state astack[0x100];
-  webvtt_state *stack; /* dynamically allocated stack, if 'astack' fills up */
+  webvtt_state *stack; /* 'astack', or a copy on the heap once it fills up */
   webvtt_uint stack_alloc; /* item capacity in 'stack' */
   webvtt_bool popped;
+  webvtt_state astack[WEBVTT_PARSER_STACK];
 
   /**
    * line (cue payload also stored here)
@@ -199,6 +232,39 @@ webvtt_parser_t {
   webvtt_uint line_pos;
   webvtt_string line_buffer;
 
+  /**
+   * Zero-copy input (see webvtt_parse_mapped_file())
+   *
+   * 'source' is the mapped document while it is being parsed, 'cue_line' is
+   * the start of the line being read in T_CUEREAD, and 'span' is the part of
+   * the source which has been collected as cue payload so far.
+   */
+  webvtt_string source;
+  const char *cue_line;
+  const char *span;
+  webvtt_uint span_length;
+
+  /**
+   * Arena which everything created while parsing is allocated from, if the
+   * parser was created with webvtt_create_parser_with_arena()
+   */
+  webvtt_arena *arena;
+
+  /**
+   * Reusable buffers for the cue text tokenizer
+   */
+  webvtt_cuetext_context cuetext;
+
+  /**
+   * Counters for webvtt_parser_get_stats(). Allocations are counted in
+   * 'alloc_stats' while one of the parser's functions is running.
+   * 'stats_cr' is set when the input read so far ends in a CR, which a LF
+   * starting the next chunk belongs to.
+   */
+  webvtt_parser_stats stats;
+  webvtt_alloc_stats alloc_stats;
+  webvtt_bool stats_cr;
+
   /**
    * tokenizer
    */
@@ -244,8 +310,13 @@ WEBVTT_INTERN webvtt_status
 webvtt_parse_vertical( webvtt_parser self, webvtt_cue *cue, const char *text,
                        webvtt_uint *pos, webvtt_uint len );
 
+/**
+ * Read the timestamp at the start of 'b', which is NUL-terminated at or after
+ * 'length' bytes. Canonical timestamps are converted a word at a time, and
+ * anything else is read a field at a time.
+ */
 WEBVTT_INTERN int
-webvtt_parse_timestamp( const char *b, int *tokenLength,
+webvtt_parse_timestamp( const char *b, webvtt_uint length, int *tokenLength,
                         webvtt_timestamp *result );
 
 WEBVTT_INTERN webvtt_status
@@ -358,6 +429,9 @@ if( !(condition) ) { \
 #define __ERROR_AT_OR(errno, line, column, __or) \
 do \
 { \
+  if( (webvtt_uint)(errno) < WEBVTT_ERROR_COUNT ) { \
+    ++self->stats.errors[ (errno) ]; \
+  } \
   if( !self->error \
     || self->error( (self->userdata), (line), (column), (errno) ) < 0 ) { \
     __or \
@@ -0,0 +1,418 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "scan_internal.h"
+
+#if ( WEBVTT_CC_GCC && ( defined(__x86_64__) || \
+      ( defined(__i386__) && defined(__SSE2__) ) ) ) || \
+    ( WEBVTT_CC_MSVC && ( defined(_M_X64) || \
+      ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 ) ) )
+# define WEBVTT_SCAN_HAVE_SSE2 1
+# include <emmintrin.h>
+#endif
+
+#if WEBVTT_SCAN_HAVE_SSE2 && ( ( WEBVTT_CC_GCC && ( __GNUC__ > 4 || \
+    ( __GNUC__ == 4 && __GNUC_MINOR__ >= 8 ) ) ) || \
+    ( WEBVTT_CC_MSVC && _MSC_VER >= 1700 ) )
+# define WEBVTT_SCAN_HAVE_AVX2 1
+# include <immintrin.h>
+# if WEBVTT_CC_GCC
+#   define TARGET_AVX2 __attribute__((target("avx2")))
+# else
+#   define TARGET_AVX2
+# endif
+#endif
+
+#if WEBVTT_SCAN_HAVE_SSE2
+# if WEBVTT_CC_MSVC
+#   include <intrin.h>
+static WEBVTT_INLINE unsigned
+first_bit( unsigned mask )
+{
+  unsigned long index;
+  _BitScanForward( &index, mask );
+  return ( unsigned )index;
+}
+# else
+#   define first_bit(mask) ( ( unsigned )__builtin_ctz( mask ) )
+# endif
+#endif
+
+typedef struct
+{
+  const char *( *eol )( const char *p, const char *end );
+  const char *( *eol_nul )( const char *p, const char *end,
+                            webvtt_bool *nul );
+  const char *( *separator )( const char *p, const char *end );
+} scanners;
+
+/**
+ * Portable implementation
+ */
+static const char *
+eol_portable( const char *p, const char *end )
+{
+  while( p < end && *p != '\r' && *p != '\n' ) {
+    ++p;
+  }
+  return p;
+}
+
+static const char *
+eol_nul_portable( const char *p, const char *end, webvtt_bool *nul )
+{
+  webvtt_bool found = 0;
+  for( ; p < end && *p != '\r' && *p != '\n'; ++p ) {
+    found |= !*p;
+  }
+  *nul = found;
+  return p;
+}
+
+static const char *
+separator_portable( const char *p, const char *end )
+{
+  for( ; end - p >= 3; ++p ) {
+    if( p[ 0 ] == '-' && p[ 1 ] == '-' && p[ 2 ] == '>' ) {
+      return p;
+    }
+  }
+  return 0;
+}
+
+static const scanners portable = {
+  &eol_portable, &eol_nul_portable, &separator_portable
+};
+
+#if WEBVTT_SCAN_HAVE_SSE2
+/**
+ * SSE2 implementation: 16 bytes at a time. Whatever is left at the end is
+ * scanned with one more load of the last 16 bytes, overlapping what has
+ * already been scanned, so nothing is ever read past 'end'. Only ranges
+ * shorter than that are left to the portable loops.
+ *
+ * Lines which reach the end of a chunk end in such a tail, so this keeps small
+ * chunks about as cheap to scan as large ones.
+ */
+static const char *
+eol_sse2( const char *p, const char *end )
+{
+  const __m128i cr = _mm_set1_epi8( '\r' );
+  const __m128i lf = _mm_set1_epi8( '\n' );
+  const char *begin = p;
+  __m128i v;
+  unsigned mask;
+  for( ; end - p >= 16; p += 16 ) {
+    v = _mm_loadu_si128( ( const __m128i * )p );
+    mask = ( unsigned )_mm_movemask_epi8(
+      _mm_or_si128( _mm_cmpeq_epi8( v, cr ), _mm_cmpeq_epi8( v, lf ) ) );
+    if( mask ) {
+      return p + first_bit( mask );
+    }
+  }
+  if( p == end || end - begin < 16 ) {
+    return eol_portable( p, end );
+  }
+  v = _mm_loadu_si128( ( const __m128i * )( end - 16 ) );
+  mask = ( unsigned )_mm_movemask_epi8(
+    _mm_or_si128( _mm_cmpeq_epi8( v, cr ), _mm_cmpeq_epi8( v, lf ) ) )
+    >> ( p - ( end - 16 ) );
+  return mask ? p + first_bit( mask ) : end;
+}
+
+static const char *
+eol_nul_sse2( const char *p, const char *end, webvtt_bool *nul )
+{
+  const __m128i cr = _mm_set1_epi8( '\r' );
+  const __m128i lf = _mm_set1_epi8( '\n' );
+  const __m128i zero = _mm_setzero_si128();
+  const char *begin = p;
+  webvtt_bool found = 0;
+  __m128i v;
+  unsigned mask, nuls, shift;
+  for( ; end - p >= 16; p += 16 ) {
+    v = _mm_loadu_si128( ( const __m128i * )p );
+    mask = ( unsigned )_mm_movemask_epi8(
+      _mm_or_si128( _mm_cmpeq_epi8( v, cr ), _mm_cmpeq_epi8( v, lf ) ) );
+    nuls = ( unsigned )_mm_movemask_epi8( _mm_cmpeq_epi8( v, zero ) );
+    if( mask ) {
+      unsigned i = first_bit( mask );
+      *nul = found || ( nuls & ( ( 1u << i ) - 1 ) );
+      return p + i;
+    }
+    found |= nuls != 0;
+  }
+  if( p == end || end - begin < 16 ) {
+    p = eol_nul_portable( p, end, nul );
+    *nul |= found;
+    return p;
+  }
+  v = _mm_loadu_si128( ( const __m128i * )( end - 16 ) );
+  shift = ( unsigned )( p - ( end - 16 ) );
+  mask = ( unsigned )_mm_movemask_epi8(
+    _mm_or_si128( _mm_cmpeq_epi8( v, cr ), _mm_cmpeq_epi8( v, lf ) ) )
+    >> shift;
+  nuls = ( unsigned )_mm_movemask_epi8( _mm_cmpeq_epi8( v, zero ) ) >> shift;
+  if( mask ) {
+    unsigned i = first_bit( mask );
+    *nul = found || ( nuls & ( ( 1u << i ) - 1 ) );
+    return p + i;
+  }
+  *nul = found || nuls;
+  return end;
+}
+
+static const char *
+separator_sse2( const char *p, const char *end )
+{
+  const __m128i minus = _mm_set1_epi8( '-' );
+  const __m128i gt = _mm_set1_epi8( '>' );
+  for( ; end - p >= 18; p += 16 ) {
+    __m128i a = _mm_loadu_si128( ( const __m128i * )p );
+    __m128i b = _mm_loadu_si128( ( const __m128i * )( p + 1 ) );
+    __m128i c = _mm_loadu_si128( ( const __m128i * )( p + 2 ) );
+    unsigned mask = ( unsigned )_mm_movemask_epi8( _mm_and_si128(
+      _mm_and_si128( _mm_cmpeq_epi8( a, minus ), _mm_cmpeq_epi8( b, minus ) ),
+      _mm_cmpeq_epi8( c, gt ) ) );
+    if( mask ) {
+      return p + first_bit( mask );
+    }
+  }
+  return separator_portable( p, end );
+}
+
+static const scanners sse2 = {
+  &eol_sse2, &eol_nul_sse2, &separator_sse2
+};
+#endif
+
+#if WEBVTT_SCAN_HAVE_AVX2
+/**
+ * AVX2 implementation: same as SSE2, but 32 bytes at a time.
+ */
+TARGET_AVX2 static const char *
+eol_avx2( const char *p, const char *end )
+{
+  const __m256i cr = _mm256_set1_epi8( '\r' );
+  const __m256i lf = _mm256_set1_epi8( '\n' );
+  const char *begin = p;
+  __m256i v;
+  unsigned mask;
+  for( ; end - p >= 32; p += 32 ) {
+    v = _mm256_loadu_si256( ( const __m256i * )p );
+    mask = ( unsigned )_mm256_movemask_epi8( _mm256_or_si256(
+      _mm256_cmpeq_epi8( v, cr ), _mm256_cmpeq_epi8( v, lf ) ) );
+    if( mask ) {
+      return p + first_bit( mask );
+    }
+  }
+  if( p == end || end - begin < 32 ) {
+    return eol_sse2( p, end );
+  }
+  v = _mm256_loadu_si256( ( const __m256i * )( end - 32 ) );
+  mask = ( unsigned )_mm256_movemask_epi8( _mm256_or_si256(
+    _mm256_cmpeq_epi8( v, cr ), _mm256_cmpeq_epi8( v, lf ) ) )
+    >> ( p - ( end - 32 ) );
+  return mask ? p + first_bit( mask ) : end;
+}
+
+TARGET_AVX2 static const char *
+eol_nul_avx2( const char *p, const char *end, webvtt_bool *nul )
+{
+  const __m256i cr = _mm256_set1_epi8( '\r' );
+  const __m256i lf = _mm256_set1_epi8( '\n' );
+  const __m256i zero = _mm256_setzero_si256();
+  const char *begin = p;
+  webvtt_bool found = 0;
+  __m256i v;
+  unsigned mask, nuls, shift;
+  for( ; end - p >= 32; p += 32 ) {
+    v = _mm256_loadu_si256( ( const __m256i * )p );
+    mask = ( unsigned )_mm256_movemask_epi8( _mm256_or_si256(
+      _mm256_cmpeq_epi8( v, cr ), _mm256_cmpeq_epi8( v, lf ) ) );
+    nuls = ( unsigned )_mm256_movemask_epi8( _mm256_cmpeq_epi8( v, zero ) );
+    if( mask ) {
+      unsigned i = first_bit( mask );
+      *nul = found || ( nuls & ( ( 1u << i ) - 1 ) );
+      return p + i;
+    }
+    found |= nuls != 0;
+  }
+  if( p == end || end - begin < 32 ) {
+    p = eol_nul_sse2( p, end, nul );
+    *nul |= found;
+    return p;
+  }
+  v = _mm256_loadu_si256( ( const __m256i * )( end - 32 ) );
+  shift = ( unsigned )( p - ( end - 32 ) );
+  mask = ( unsigned )_mm256_movemask_epi8( _mm256_or_si256(
+    _mm256_cmpeq_epi8( v, cr ), _mm256_cmpeq_epi8( v, lf ) ) ) >> shift;
+  nuls = ( unsigned )_mm256_movemask_epi8( _mm256_cmpeq_epi8( v, zero ) )
+         >> shift;
+  if( mask ) {
+    unsigned i = first_bit( mask );
+    *nul = found || ( nuls & ( ( 1u << i ) - 1 ) );
+    return p + i;
+  }
+  *nul = found || nuls;
+  return end;
+}
+
+TARGET_AVX2 static const char *
+separator_avx2( const char *p, const char *end )
+{
+  const __m256i minus = _mm256_set1_epi8( '-' );
+  const __m256i gt = _mm256_set1_epi8( '>' );
+  for( ; end - p >= 34; p += 32 ) {
+    __m256i a = _mm256_loadu_si256( ( const __m256i * )p );
+    __m256i b = _mm256_loadu_si256( ( const __m256i * )( p + 1 ) );
+    __m256i c = _mm256_loadu_si256( ( const __m256i * )( p + 2 ) );
+    unsigned mask = ( unsigned )_mm256_movemask_epi8( _mm256_and_si256(
+      _mm256_and_si256( _mm256_cmpeq_epi8( a, minus ),
+                        _mm256_cmpeq_epi8( b, minus ) ),
+      _mm256_cmpeq_epi8( c, gt ) ) );
+    if( mask ) {
+      return p + first_bit( mask );
+    }
+  }
+  return separator_sse2( p, end );
+}
+
+static const scanners avx2 = {
+  &eol_avx2, &eol_nul_avx2, &separator_avx2
+};
+
+static int
+cpu_has_avx2( void )
+{
+# if WEBVTT_CC_MSVC
+  int info[ 4 ];
+  __cpuid( info, 0 );
+  if( info[ 0 ] < 7 ) {
+    return 0;
+  }
+  __cpuid( info, 1 );
+  /* OSXSAVE and AVX, and the OS saves the YMM registers */
+  if( ( info[ 2 ] & ( 1 << 27 | 1 << 28 ) ) != ( 1 << 27 | 1 << 28 ) ||
+      ( _xgetbv( 0 ) & 6 ) != 6 ) {
+    return 0;
+  }
+  __cpuidex( info, 7, 0 );
+  return ( info[ 1 ] & ( 1 << 5 ) ) != 0;
+# else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports( "avx2" );
+# endif
+}
+#endif
+
+static const scanners *selected = 0;
+
+/**
+ * Threads can pick an implementation while others scan, so 'selected' is
+ * only read and written atomically. MSVC gives volatile accesses acquire and
+ * release semantics.
+ */
+#if defined(__ATOMIC_ACQUIRE)
+# define LOAD_SELECTED() __atomic_load_n( &selected, __ATOMIC_ACQUIRE )
+# define STORE_SELECTED(s) __atomic_store_n( &selected, (s), __ATOMIC_RELEASE )
+#elif WEBVTT_CC_MSVC
+# define LOAD_SELECTED() ( *( const scanners *volatile * )&selected )
+# define STORE_SELECTED(s) \
+  ( *( const scanners *volatile * )&selected = (s) )
+#elif WEBVTT_CC_GCC
+# define LOAD_SELECTED() __sync_val_compare_and_swap( &selected, 0, 0 )
+# define STORE_SELECTED(s) \
+  do { __sync_synchronize(); selected = (s); __sync_synchronize(); } \
+  while( 0 )
+#else
+# define LOAD_SELECTED() ( selected )
+# define STORE_SELECTED(s) ( selected = (s) )
+#endif
+
+WEBVTT_INTERN int
+webvtt_scan_select( webvtt_scan_isa isa )
+{
+  switch( isa ) {
+    case WEBVTT_SCAN_BEST:
+#if WEBVTT_SCAN_HAVE_AVX2
+    case WEBVTT_SCAN_AVX2:
+      if( cpu_has_avx2() ) {
+        STORE_SELECTED( &avx2 );
+        return 0;
+      } else if( isa == WEBVTT_SCAN_AVX2 ) {
+        return -1;
+      }
+#endif
+#if WEBVTT_SCAN_HAVE_SSE2
+      /* Fall through */
+    case WEBVTT_SCAN_SSE2:
+      STORE_SELECTED( &sse2 );
+      return 0;
+#endif
+      /* Fall through */
+    case WEBVTT_SCAN_PORTABLE:
+      STORE_SELECTED( &portable );
+      return 0;
+    default:
+      return -1;
+  }
+}
+
+/**
+ * Whichever thread gets here first picks the implementation. If several do at
+ * once, they all pick the same one.
+ */
+static WEBVTT_INLINE const scanners *
+get_scanners( void )
+{
+  const scanners *s = LOAD_SELECTED();
+  if( !s ) {
+    webvtt_scan_select( WEBVTT_SCAN_BEST );
+    s = LOAD_SELECTED();
+  }
+  return s;
+}
+
+WEBVTT_INTERN const char *
+webvtt_scan_eol( const char *p, const char *end )
+{
+  return get_scanners()->eol( p, end );
+}
+
+WEBVTT_INTERN const char *
+webvtt_scan_eol_nul( const char *p, const char *end, webvtt_bool *nul )
+{
+  return get_scanners()->eol_nul( p, end, nul );
+}
+
+WEBVTT_INTERN const char *
+webvtt_scan_separator( const char *p, const char *end )
+{
+  return get_scanners()->separator( p, end );
+}
@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INTERN_SCAN_H__
+# define __INTERN_SCAN_H__
+# include <webvtt/util.h>
+
+/**
+ * Scanners for the bytes the parser looks for on every line: line breaks,
+ * '\0' and the "-->" separator.
+ *
+ * Where the CPU supports it, these look at 16 (SSE2) or 32 (AVX2) bytes at a
+ * time. The best implementation is picked at run time, the first time any of
+ * them is used, with plain byte loops as the fallback.
+ */
+
+/**
+ * Return the first CR or LF in [p, end), or 'end' if there is none.
+ */
+WEBVTT_INTERN const char *webvtt_scan_eol( const char *p, const char *end );
+
+/**
+ * Same as webvtt_scan_eol(), but also set '*nul' if there is a '\0' before
+ * the line break (or end).
+ */
+WEBVTT_INTERN const char *webvtt_scan_eol_nul( const char *p, const char *end,
+                                               webvtt_bool *nul );
+
+/**
+ * Return the first "-->" in [p, end), or NULL if there is none.
+ */
+WEBVTT_INTERN const char *webvtt_scan_separator( const char *p,
+                                                 const char *end );
+
+/**
+ * Implementations which can be selected with webvtt_scan_select(), mostly for
+ * testing purposes.
+ */
+typedef enum
+{
+  WEBVTT_SCAN_PORTABLE = 0,
+  WEBVTT_SCAN_SSE2,
+  WEBVTT_SCAN_AVX2,
+  WEBVTT_SCAN_BEST
+} webvtt_scan_isa;
+
+/**
+ * Use the 'isa' implementation of the scanners. Returns 0 on success, or -1 if
+ * it is not available on this CPU or in this build.
+ */
+WEBVTT_INTERN int webvtt_scan_select( webvtt_scan_isa isa );
+
+#endif
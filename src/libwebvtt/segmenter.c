@@ -0,0 +1,286 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <string.h>
+#include <webvtt/segmenter.h>
+
+/**
+ * Room for "X-TIMESTAMP-MAP=MPEGTS:", 20 digits, ",LOCAL:", a timestamp and a
+ * line break
+ */
+#define MAX_MAP_LENGTH ( 64 + WEBVTT_MAX_TIMESTAMP_LENGTH )
+
+struct
+webvtt_segmenter_t {
+  webvtt_timestamp duration;
+  webvtt_uint options;
+  webvtt_segment_fn on_segment;
+  void *userdata;
+  /**
+   * First failure, after which nothing more is emitted
+   */
+  webvtt_status status;
+
+  /**
+   * X-TIMESTAMP-MAP header line, if there is one
+   */
+  char map[ MAX_MAP_LENGTH ];
+  webvtt_uint map_length;
+
+  /**
+   * Whether a cue has been added or a segment emitted, after which the first
+   * segment can't be moved
+   */
+  webvtt_bool started;
+
+  /**
+   * Segment being built, and the cues which overlap it in the order they were
+   * added
+   */
+  webvtt_uint64 index;
+  webvtt_cue **cues;
+  webvtt_uint count;
+  webvtt_uint alloc;
+
+  /**
+   * Text of the last segment, reused by the next one
+   */
+  char *text;
+  webvtt_uint size;
+};
+
+static webvtt_timestamp
+segment_start( webvtt_segmenter self, webvtt_uint64 index )
+{
+  return ( webvtt_timestamp )index * self->duration;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_create_segmenter( webvtt_timestamp duration, webvtt_uint options,
+                         webvtt_segment_fn on_segment, void *userdata,
+                         webvtt_segmenter *ppout )
+{
+  webvtt_segmenter self;
+  if( !duration || !on_segment || !ppout ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  if( !( self = ( webvtt_segmenter )webvtt_alloc0( sizeof *self ) ) ) {
+    return WEBVTT_OUT_OF_MEMORY;
+  }
+
+  self->duration = duration;
+  self->options = options;
+  self->on_segment = on_segment;
+  self->userdata = userdata;
+  self->status = WEBVTT_SUCCESS;
+  *ppout = self;
+  return WEBVTT_SUCCESS;
+}
+
+WEBVTT_EXPORT void
+webvtt_delete_segmenter( webvtt_segmenter self )
+{
+  webvtt_uint i;
+  if( self ) {
+    for( i = 0; i < self->count; ++i ) {
+      webvtt_release_cue( self->cues + i );
+    }
+    webvtt_free( self->cues );
+    webvtt_free( self->text );
+    webvtt_free( self );
+  }
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_set_segmenter_timestamp_map( webvtt_segmenter self,
+                                    webvtt_uint64 mpegts,
+                                    webvtt_timestamp local )
+{
+  static const char prefix[] = "X-TIMESTAMP-MAP=MPEGTS:";
+  static const char separator[] = ",LOCAL:";
+  char digits[ 20 ];
+  webvtt_uint n = 0, length;
+  if( !self ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  self->started = 1;
+
+  do {
+    digits[ n++ ] = ( char )( '0' + mpegts % 10 );
+    mpegts /= 10;
+  } while( mpegts );
+
+  length = sizeof prefix - 1;
+  memcpy( self->map, prefix, length );
+  while( n ) {
+    self->map[ length++ ] = digits[ --n ];
+  }
+  memcpy( self->map + length, separator, sizeof separator - 1 );
+  length += sizeof separator - 1;
+  length += webvtt_format_timestamp( local, self->map + length );
+  self->map[ length++ ] = '\n';
+  self->map_length = length;
+  return WEBVTT_SUCCESS;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_set_segmenter_first( webvtt_segmenter self, webvtt_uint64 index )
+{
+  if( !self || self->started ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  self->index = index;
+  return WEBVTT_SUCCESS;
+}
+
+static webvtt_status
+write_segment( webvtt_segmenter self, webvtt_writer *writer )
+{
+  webvtt_uint i;
+  webvtt_write_text( writer, "WEBVTT\n", 7 );
+  webvtt_write_text( writer, self->map, self->map_length );
+  webvtt_write_text( writer, "\n", 1 );
+  for( i = 0; i < self->count; ++i ) {
+    webvtt_write_cue( writer, self->cues[ i ], self->options );
+  }
+  return writer->status;
+}
+
+/**
+ * Write the segment being built to the reusable text buffer, and hand it to
+ * the callback.
+ */
+static webvtt_status
+emit_segment( webvtt_segmenter self )
+{
+  webvtt_writer writer;
+  webvtt_timestamp start = segment_start( self, self->index );
+
+  webvtt_init_writer( &writer, self->text, self->size, 0, 0 );
+  if( write_segment( self, &writer ) == WEBVTT_OUT_OF_MEMORY ) {
+    /**
+     * The writer has counted how much room the segment needs, so it only has
+     * to be written again with a buffer that big.
+     */
+    char *text = ( char * )webvtt_alloc( writer.total );
+    if( !text ) {
+      return self->status = WEBVTT_OUT_OF_MEMORY;
+    }
+    webvtt_free( self->text );
+    self->text = text;
+    self->size = writer.total;
+    webvtt_init_writer( &writer, self->text, self->size, 0, 0 );
+    write_segment( self, &writer );
+  }
+
+  if( writer.status == WEBVTT_SUCCESS ) {
+    writer.status = self->on_segment( self->userdata, self->index, start,
+                                      start + self->duration, writer.buffer,
+                                      writer.length );
+  }
+  return self->status = writer.status;
+}
+
+/**
+ * Move on to the following segment, letting go of the cues which end before
+ * it.
+ */
+static void
+next_segment( webvtt_segmenter self )
+{
+  webvtt_uint i, kept = 0;
+  webvtt_timestamp start = segment_start( self, ++self->index );
+  for( i = 0; i < self->count; ++i ) {
+    if( self->cues[ i ]->until > start ) {
+      self->cues[ kept++ ] = self->cues[ i ];
+    } else {
+      webvtt_release_cue( self->cues + i );
+    }
+  }
+  self->count = kept;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_segment_cue( webvtt_segmenter self, webvtt_cue *cue )
+{
+  webvtt_timestamp start;
+  if( !self || !cue ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  self->started = 1;
+
+  while( self->status == WEBVTT_SUCCESS
+         && cue->from >= segment_start( self, self->index + 1 ) ) {
+    if( emit_segment( self ) == WEBVTT_SUCCESS ) {
+      next_segment( self );
+    }
+  }
+  if( self->status != WEBVTT_SUCCESS ) {
+    return self->status;
+  }
+
+  start = segment_start( self, self->index );
+  if( cue->from < start && cue->until <= start ) {
+    return WEBVTT_UNSUCCESSFUL;
+  }
+
+  if( self->count == self->alloc ) {
+    webvtt_uint alloc = self->alloc ? self->alloc * 2 : 8;
+    webvtt_cue **cues = ( webvtt_cue ** )webvtt_alloc( alloc * sizeof *cues );
+    if( !cues ) {
+      return WEBVTT_OUT_OF_MEMORY;
+    }
+    if( self->count ) {
+      memcpy( cues, self->cues, self->count * sizeof *cues );
+    }
+    webvtt_free( self->cues );
+    self->cues = cues;
+    self->alloc = alloc;
+  }
+
+  webvtt_ref_cue( cue );
+  self->cues[ self->count++ ] = cue;
+  return WEBVTT_SUCCESS;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_finish_segmenter( webvtt_segmenter self )
+{
+  if( !self ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  self->started = 1;
+
+  do {
+    if( self->status != WEBVTT_SUCCESS
+        || emit_segment( self ) != WEBVTT_SUCCESS ) {
+      return self->status;
+    }
+    next_segment( self );
+  } while( self->count );
+  return WEBVTT_SUCCESS;
+}
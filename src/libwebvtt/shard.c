@@ -0,0 +1,483 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <string.h>
+#include "parser_internal.h"
+
+/**
+ * A cue (if 'cue' is not NULL) or an error, in the order the parser of a
+ * shard reported them
+ */
+typedef struct
+shard_event_t {
+  webvtt_cue *cue;
+  webvtt_uint line;
+  webvtt_uint column;
+  webvtt_error error;
+} shard_event;
+
+typedef struct
+shard_t {
+  webvtt_uint offset;
+  webvtt_uint length;
+  /**
+   * Number of lines the parser counted over the shard, so that the shards
+   * after it know which line they start on. The parser has its own ideas
+   * about counting some runs of blank lines, which is why this isn't simply
+   * counted from the text.
+   */
+  webvtt_uint lines;
+  /**
+   * Whether the parser was left in the state every shard is started in. If it
+   * wasn't, the shard after this one has to be parsed again following on from
+   * it.
+   */
+  webvtt_bool clean;
+  webvtt_status status;
+  webvtt_bool parsed;
+  shard_event *events;
+  webvtt_uint count;
+  webvtt_uint alloc;
+} shard;
+
+struct
+webvtt_sharded_parser_t {
+  const char *buffer;
+  webvtt_uint options;
+  webvtt_cue_fn read;
+  webvtt_error_fn error;
+  void *userdata;
+  shard *shards;
+  webvtt_uint count;
+};
+
+/**
+ * What the parser of a shard does with the cues and errors it reports: they
+ * are kept in 'keep' while shards are parsed, otherwise the first 'skip' of
+ * them have already been reported and the rest go to the application.
+ */
+typedef struct
+shard_run_t {
+  webvtt_sharded_parser parser;
+  shard *keep;
+  webvtt_bool started;
+  webvtt_uint base;
+  webvtt_uint skip;
+  webvtt_uint seen;
+  /* Whether the last skipped error was answered by stopping */
+  webvtt_bool stop;
+} shard_run;
+
+/**
+ * Every shard but the first follows a blank line after a cue, so its parser
+ * is put in the same state by reading one of those first.
+ */
+static const char shard_prefix[] = "WEBVTT\n\n00:00.000 --> 00:00.000\n\n";
+
+/**
+ * Length of the line break at 'pos', if there is one
+ */
+static webvtt_uint
+line_break_length( const char *b, webvtt_uint pos, webvtt_uint length )
+{
+  if( b[ pos ] == '\n' ) {
+    return 1;
+  } else if( b[ pos ] == '\r' ) {
+    return pos + 1 < length && b[ pos + 1 ] == '\n' ? 2 : 1;
+  }
+  return 0;
+}
+
+/**
+ * Find the first block at or after 'pos' which follows a blank line, or
+ * 'length' if there is none.
+ *
+ * The run of line breaks before it has to end with a '\n', as a '\r' at the
+ * end of a shard would leave the parser waiting to see whether a '\n' comes
+ * next.
+ */
+static webvtt_uint
+next_block( const char *b, webvtt_uint pos, webvtt_uint length )
+{
+  webvtt_uint breaks, n;
+
+  /**
+   * Don't start half way through a run of line breaks, which could miss the
+   * blank line in it.
+   */
+  while( pos > 0 && line_break_length( b, pos - 1, length ) ) {
+    --pos;
+  }
+
+  while( pos < length ) {
+    if( !( n = line_break_length( b, pos, length ) ) ) {
+      ++pos;
+      continue;
+    }
+    breaks = 0;
+    do {
+      pos += n;
+      ++breaks;
+    } while( pos < length && ( n = line_break_length( b, pos, length ) ) );
+    if( breaks >= 2 && pos < length && b[ pos - 1 ] == '\n' ) {
+      break;
+    }
+  }
+  return pos;
+}
+
+/**
+ * Whether 'parser' is between blocks, in the state a shard's parser starts in
+ */
+static webvtt_bool
+is_clean( webvtt_parser parser )
+{
+  return parser->mode == M_WEBVTT && parser->top == parser->stack
+         && parser->top->state == T_BODY && parser->popped
+         && parser->tstate == L_START && !parser->token_pos;
+}
+
+static webvtt_status
+add_event( shard *s, webvtt_cue *cue, webvtt_uint line, webvtt_uint column,
+           webvtt_error error )
+{
+  shard_event *event;
+  if( s->count == s->alloc ) {
+    webvtt_uint alloc = s->alloc ? s->alloc * 2 : 64;
+    shard_event *events;
+    if( !( events = ( shard_event * )webvtt_alloc( alloc *
+                                                   sizeof *events ) ) ) {
+      return WEBVTT_OUT_OF_MEMORY;
+    }
+    if( s->count ) {
+      memcpy( events, s->events, s->count * sizeof *events );
+    }
+    webvtt_free( s->events );
+    s->events = events;
+    s->alloc = alloc;
+  }
+  event = s->events + s->count++;
+  event->cue = cue;
+  event->line = line;
+  event->column = column;
+  event->error = error;
+  return WEBVTT_SUCCESS;
+}
+
+static void WEBVTT_CALLBACK
+run_cue( void *userdata, webvtt_cue *cue )
+{
+  shard_run *r = ( shard_run * )userdata;
+  if( !r->started ) {
+    webvtt_release_cue( &cue );
+  } else if( r->keep ) {
+    if( add_event( r->keep, cue, 0, 0, 0 ) != WEBVTT_SUCCESS ) {
+      r->keep->status = WEBVTT_OUT_OF_MEMORY;
+      webvtt_release_cue( &cue );
+    }
+  } else if( ++r->seen <= r->skip ) {
+    webvtt_release_cue( &cue );
+  } else {
+    r->parser->read( r->parser->userdata, cue );
+  }
+}
+
+static int WEBVTT_CALLBACK
+run_error( void *userdata, webvtt_uint line, webvtt_uint column,
+           webvtt_error error )
+{
+  shard_run *r = ( shard_run * )userdata;
+  if( !r->started ) {
+    return 0;
+  } else if( r->keep ) {
+    if( add_event( r->keep, 0, line, column, error ) != WEBVTT_SUCCESS ) {
+      r->keep->status = WEBVTT_OUT_OF_MEMORY;
+    }
+    return 0;
+  } else if( ++r->seen < r->skip ) {
+    return 0;
+  } else if( r->seen == r->skip ) {
+    return r->stop ? -1 : 0;
+  }
+  return r->parser->error( r->parser->userdata, r->base + line, column,
+                           error );
+}
+
+/**
+ * Create a parser for the shard 'index', in the state it would be in at the
+ * start of it, and with lines counted from there.
+ */
+static webvtt_status
+start_shard( webvtt_sharded_parser self, webvtt_uint index, shard_run *r,
+             webvtt_parser *ppout )
+{
+  webvtt_parser parser;
+  webvtt_status status;
+  r->started = 0;
+  if( WEBVTT_FAILED( status = webvtt_create_parser( &run_cue, &run_error, r,
+                                                    &parser ) ) ) {
+    return status;
+  }
+  webvtt_set_parser_options( parser, self->options );
+  if( self->shards[ index ].offset ) {
+    status = webvtt_parse_chunk( parser, shard_prefix,
+                                 sizeof shard_prefix - 1 );
+    if( WEBVTT_FAILED( status ) ) {
+      webvtt_delete_parser( parser );
+      return status;
+    }
+    parser->line = 1;
+    parser->column = 1;
+  }
+  r->started = 1;
+  *ppout = parser;
+  return WEBVTT_SUCCESS;
+}
+
+/**
+ * Finish 'parser' once it has read up to the end of a shard. The parser is
+ * always finished, to let go of anything it is part way through, but only
+ * what it reports at the end of the document counts.
+ */
+static webvtt_status
+finish_shard( webvtt_parser parser, shard_run *r, webvtt_status status,
+              webvtt_bool last )
+{
+  if( WEBVTT_FAILED( status ) || !last ) {
+    r->started = 0;
+    webvtt_finish_parsing( parser );
+    return status;
+  }
+  return webvtt_finish_parsing( parser );
+}
+
+/**
+ * Parse the document from the start of shard '*pindex' in one go, until the
+ * parser is back in a clean state at the end of a shard. The first 'skip'
+ * cues and errors have already been reported, and anything after them is
+ * reported to the application. '*pindex' and '*pbase' are moved on to the
+ * shard after the last one parsed.
+ */
+static webvtt_status
+reparse_shards( webvtt_sharded_parser self, webvtt_uint *pindex,
+                webvtt_uint *pbase, webvtt_uint skip, webvtt_bool stop )
+{
+  webvtt_parser parser;
+  webvtt_status status;
+  webvtt_uint i = *pindex;
+  shard_run r;
+  r.parser = self;
+  r.keep = 0;
+  r.base = *pbase;
+  r.skip = skip;
+  r.seen = 0;
+  r.stop = stop;
+  if( WEBVTT_FAILED( status = start_shard( self, i, &r, &parser ) ) ) {
+    return status;
+  }
+
+  while( i < self->count ) {
+    shard *s = self->shards + i++;
+    if( s->length && WEBVTT_FAILED( status = webvtt_parse_chunk( parser,
+                                      self->buffer + s->offset,
+                                      s->length ) ) ) {
+      break;
+    }
+    if( is_clean( parser ) ) {
+      break;
+    }
+  }
+  *pbase += parser->line - 1;
+  *pindex = i;
+  status = finish_shard( parser, &r, status, i == self->count );
+  webvtt_delete_parser( parser );
+  return status;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_create_sharded_parser( const char *buffer, webvtt_uint length,
+                              webvtt_uint count, webvtt_uint options,
+                              webvtt_cue_fn on_read, webvtt_error_fn on_error,
+                              void *userdata, webvtt_sharded_parser *ppout )
+{
+  webvtt_sharded_parser self;
+  webvtt_uint n = 0, i, pos, target;
+  if( ( !buffer && length ) || !count || !on_read || !on_error || !ppout ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  if( !( self = ( webvtt_sharded_parser )webvtt_alloc0( sizeof *self ) ) ) {
+    return WEBVTT_OUT_OF_MEMORY;
+  }
+  if( !( self->shards = ( shard * )webvtt_alloc0( count *
+                                                  sizeof *self->shards ) ) ) {
+    webvtt_free( self );
+    return WEBVTT_OUT_OF_MEMORY;
+  }
+  self->buffer = buffer;
+  self->options = options;
+  self->read = on_read;
+  self->error = on_error;
+  self->userdata = userdata;
+
+  /**
+   * The header ends at the first blank line, and the parser is only left in
+   * the state shards start in once it has read a block after that, so the
+   * first shard takes both.
+   */
+  pos = length ? next_block( buffer, 0, length ) : 0;
+  if( pos < length ) {
+    pos = next_block( buffer, pos + 1, length );
+  }
+  for( i = 1; i < count && pos < length; ++i ) {
+    target = ( webvtt_uint )( ( webvtt_uint64 )length * i / count );
+    if( pos < target && ( pos = next_block( buffer, target,
+                                            length ) ) >= length ) {
+      break;
+    }
+    if( pos > self->shards[ n ].offset ) {
+      self->shards[ n ].length = pos - self->shards[ n ].offset;
+      self->shards[ ++n ].offset = pos;
+    }
+  }
+  self->shards[ n ].length = length - self->shards[ n ].offset;
+  self->count = n + 1;
+  *ppout = self;
+  return WEBVTT_SUCCESS;
+}
+
+WEBVTT_EXPORT void
+webvtt_delete_sharded_parser( webvtt_sharded_parser self )
+{
+  webvtt_uint i, j;
+  if( self ) {
+    for( i = 0; i < self->count; ++i ) {
+      shard *s = self->shards + i;
+      for( j = 0; j < s->count; ++j ) {
+        if( s->events[ j ].cue ) {
+          webvtt_release_cue( &s->events[ j ].cue );
+        }
+      }
+      webvtt_free( s->events );
+    }
+    webvtt_free( self->shards );
+    webvtt_free( self );
+  }
+}
+
+WEBVTT_EXPORT webvtt_uint
+webvtt_sharded_parser_count( webvtt_sharded_parser self )
+{
+  return self ? self->count : 0;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_parse_shard( webvtt_sharded_parser self, webvtt_uint index )
+{
+  webvtt_parser parser;
+  webvtt_status status;
+  shard_run r;
+  shard *s;
+  if( !self || index >= self->count || self->shards[ index ].parsed ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  s = self->shards + index;
+  s->parsed = 1;
+  r.parser = self;
+  r.keep = s;
+  if( WEBVTT_FAILED( status = start_shard( self, index, &r, &parser ) ) ) {
+    return s->status = status;
+  }
+  if( s->length ) {
+    status = webvtt_parse_chunk( parser, self->buffer + s->offset,
+                                 s->length );
+  }
+  s->lines = parser->line - 1;
+  s->clean = is_clean( parser );
+  status = finish_shard( parser, &r, status, index + 1 == self->count );
+  webvtt_delete_parser( parser );
+  if( !WEBVTT_FAILED( s->status ) ) {
+    s->status = status;
+  }
+  return s->status;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_finish_sharded_parser( webvtt_sharded_parser self )
+{
+  webvtt_uint i, j, base = 0;
+  webvtt_status status;
+  if( !self ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  for( i = 0; i < self->count; ++i ) {
+    if( !self->shards[ i ].parsed ) {
+      return WEBVTT_INVALID_PARAM;
+    }
+  }
+
+  for( i = 0; i < self->count; ) {
+    shard *s = self->shards + i;
+    for( j = 0; j < s->count; ++j ) {
+      shard_event *event = s->events + j;
+      if( event->cue ) {
+        webvtt_cue *cue = event->cue;
+        event->cue = 0;
+        self->read( self->userdata, cue );
+      } else if( self->error( self->userdata, base + event->line,
+                              event->column, event->error ) < 0 ) {
+        /**
+         * The parser doesn't give up on every error it is told to, so rather
+         * than guessing, the shard is parsed again up to this error, which is
+         * answered the same way, and whatever the parser does next goes
+         * straight to the application.
+         */
+        break;
+      }
+    }
+    if( j < s->count ) {
+      status = reparse_shards( self, &i, &base, j + 1, 1 );
+    } else if( WEBVTT_FAILED( s->status ) ) {
+      return s->status;
+    } else if( !s->clean && i + 1 < self->count ) {
+      /**
+       * The next shard didn't start where the parser would have been, so it
+       * is parsed again following on from this one.
+       */
+      status = reparse_shards( self, &i, &base, s->count, 0 );
+    } else {
+      base += s->lines;
+      ++i;
+      continue;
+    }
+    if( WEBVTT_FAILED( status ) ) {
+      return status;
+    }
+  }
+  return WEBVTT_SUCCESS;
+}
@@ -26,6 +26,8 @@
  */
 
 #include "string_internal.h"
+#include "scan_internal.h"
+#include "alloc_internal.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -69,9 +71,28 @@ static webvtt_string_data empty_string = {
   0, /* length */
   0, /* capacity */
   empty_string.array, /* text */
+  0, /* base */
+  0, /* release */
   { '\0' } /* array */
 };
 
+/**
+ * Free string data whose reference count has dropped to 0, along with whatever
+ * its text was borrowed from.
+ */
+static void
+free_string_data( webvtt_string_data *d )
+{
+  if( d->base ) {
+    webvtt_string base;
+    base.d = d->base;
+    webvtt_release_string( &base );
+  } else if( d->release ) {
+    d->release( d );
+  }
+  webvtt_free( d );
+}
+
 WEBVTT_EXPORT void
 webvtt_init_string( webvtt_string *result )
 {
@@ -110,12 +131,92 @@ webvtt_create_string( webvtt_uint32 alloc, webvtt_string *result )
   d->length = 0;
   d->text = d->array;
   d->text[0] = 0;
+  d->base = 0;
+  d->release = 0;
 
   result->d = d;
 
   return WEBVTT_SUCCESS;
 }
 
+WEBVTT_INTERN webvtt_status
+webvtt_create_external_string( webvtt_string *out, char *text,
+                               webvtt_uint32 length,
+                               webvtt_string_release_fn release )
+{
+  webvtt_string_data *d;
+
+  if( !out || !text ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  d = ( webvtt_string_data * )webvtt_alloc( sizeof( webvtt_string_data ) );
+
+  if( !d ) {
+    return WEBVTT_OUT_OF_MEMORY;
+  }
+
+  d->refs.value = 1;
+  d->alloc = 0;
+  d->length = length;
+  d->text = text;
+  d->base = 0;
+  d->release = release;
+  d->array[0] = 0;
+
+  out->d = d;
+
+  return WEBVTT_SUCCESS;
+}
+
+WEBVTT_INTERN webvtt_status
+webvtt_create_string_slice( webvtt_string *out, const webvtt_string *base,
+                            webvtt_uint32 offset, webvtt_uint32 length )
+{
+  webvtt_string_data *d, *b;
+
+  if( !out || !base || !base->d || offset + length > base->d->length ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  b = base->d;
+  if( length == 0 ) {
+    webvtt_init_string( out );
+    return WEBVTT_SUCCESS;
+  }
+
+  if( offset + length == b->length ) {
+    /* There is no byte left to terminate the slice with */
+    return webvtt_create_string_with_text( out, b->text + offset, length );
+  }
+
+  /* Slices always share the text of the string which owns it. */
+  if( b->base ) {
+    offset += ( webvtt_uint32 )( b->text - b->base->text );
+    b = b->base;
+  }
+
+  d = ( webvtt_string_data * )webvtt_alloc( sizeof( webvtt_string_data ) );
+
+  if( !d ) {
+    return WEBVTT_OUT_OF_MEMORY;
+  }
+
+  d->refs.value = 1;
+  d->alloc = 0;
+  d->length = length;
+  d->text = b->text + offset;
+  d->text[ length ] = 0;
+  d->base = b;
+  d->release = 0;
+  d->array[0] = 0;
+  webvtt_ref( &b->refs );
+
+  out->d = d;
+
+  return WEBVTT_SUCCESS;
+}
+
 WEBVTT_EXPORT webvtt_status
 webvtt_create_string_with_text( webvtt_string *out, const char *init_text,
                                 int len )
@@ -169,11 +270,26 @@ webvtt_release_string( webvtt_string *str )
     webvtt_string_data *d = str->d;
     str->d = 0;
     if( d && webvtt_deref( &d->refs ) == 0 ) {
-      webvtt_free( d );
+      free_string_data( d );
     }
   }
 }
 
+WEBVTT_INTERN void
+webvtt_string_clear( webvtt_string *str )
+{
+  if( !str ) {
+    return;
+  }
+  if( str->d && str->d->alloc && webvtt_ref_count( &str->d->refs ) == 1 ) {
+    str->d->length = 0;
+    str->d->text[ 0 ] = 0;
+  } else {
+    webvtt_release_string( str );
+    webvtt_init_string( str );
+  }
+}
+
 /**
  * "Detach" a shared string, so that it's safely mutable
  */
@@ -181,6 +297,7 @@ WEBVTT_EXPORT webvtt_status
 webvtt_string_detach( /* in, out */ webvtt_string *str )
 {
   webvtt_string_data *d, *q;
+  webvtt_uint32 alloc;
 
   if( !str ) {
     return WEBVTT_INVALID_PARAM;
@@ -188,23 +305,33 @@ webvtt_string_detach( /* in, out */ webvtt_string *str )
 
   q = str->d;
 
-  if( q->refs.value == 1 ) {
+  if( webvtt_ref_count( &q->refs ) == 1 ) {
     return WEBVTT_SUCCESS;
   }
 
+  /* Borrowed text has no capacity of its own */
+  alloc = q->alloc < q->length ? q->length : q->alloc;
+
   d = ( webvtt_string_data * )webvtt_alloc( sizeof( webvtt_string_data ) +
-                                           ( sizeof( char ) * str->d->alloc ) );
+                                           ( sizeof( char ) * alloc ) );
+
+  if( !d ) {
+    return WEBVTT_OUT_OF_MEMORY;
+  }
 
   d->refs.value = 1;
   d->text = d->array;
-  d->alloc = q->alloc;
+  d->alloc = alloc;
   d->length = q->length;
+  d->base = 0;
+  d->release = 0;
   memcpy( d->text, q->text, q->length );
+  d->text[ d->length ] = 0;
 
   str->d = d;
 
   if( webvtt_deref( &q->refs ) == 0 ) {
-    webvtt_free( q );
+    free_string_data( q );
   }
 
   return WEBVTT_SUCCESS;
@@ -298,6 +425,7 @@ grow( webvtt_string *str, webvtt_uint need )
     } while ( n < grow );
   }
 
+  webvtt_count_string_grow();
   p = ( webvtt_string_data * )webvtt_alloc( n );
 
   if( !p ) {
@@ -308,28 +436,51 @@ grow( webvtt_string *str, webvtt_uint need )
   p->alloc = ( n - sizeof( *p ) ) / sizeof( char );
   p->length = d->length;
   p->text = p->array;
+  p->base = 0;
+  p->release = 0;
   memcpy( p->text, d->text, sizeof( char ) * p->length );
   p->text[ p->length ] = 0;
   str->d = p;
 
   if( webvtt_deref( &d->refs ) == 0 ) {
-    webvtt_free( d );
+    free_string_data( d );
   }
 
   return WEBVTT_SUCCESS;
 }
 
-WEBVTT_EXPORT int
-webvtt_string_getline( webvtt_string *src, const char *buffer,
-                       webvtt_uint *pos, int len, int *truncate,
-                       webvtt_bool finish )
+/* UTF8 encoding of U+FFFD REPLACEMENT CHAR */
+static const char replacement[] = { 0xEF, 0xBF, 0xBD };
+
+/**
+ * Copy 'len' bytes of 's' to 'out', replacing each '\0' with U+FFFD on the way
+ */
+static void
+copy_replacing_nul( char *out, const char *s, webvtt_uint len )
+{
+  const char *end = s + len;
+  const char *nul;
+  while( ( nul = ( const char * )memchr( s, 0, end - s ) ) ) {
+    memcpy( out, s, nul - s );
+    out += nul - s;
+    memcpy( out, replacement, sizeof( replacement ) );
+    out += sizeof( replacement );
+    s = nul + 1;
+  }
+  memcpy( out, s, end - s );
+}
+
+static int
+read_line( webvtt_string *str, const char *buffer, webvtt_uint *pos, int len,
+         int *truncate, webvtt_bool finish, webvtt_bool replace_nul )
 {
   int ret = 0;
-  webvtt_string *str = src;
   webvtt_string_data *d = 0;
   const char *s = buffer + *pos;
   const char *p = s;
   const char *n;
+  webvtt_uint nuls = 0;
+  webvtt_uint out_len;
 
   /**
    *if this is public now, maybe we should return webvtt_status so we can
@@ -352,8 +503,18 @@ webvtt_string_getline( webvtt_string *src, const char *buffer,
   }
   n = buffer + len;
 
-  while( p < n && *p != '\r' && *p != '\n' ) {
-    ++p;
+  if( replace_nul ) {
+    webvtt_bool has_nul;
+    p = webvtt_scan_eol_nul( s, n, &has_nul );
+    if( has_nul ) {
+      /* Each '\0' grows by two bytes once it is replaced */
+      const char *q;
+      for( q = s; q < p; ++q ) {
+        nuls += !*q;
+      }
+    }
+  } else {
+    p = webvtt_scan_eol( s, n );
   }
 
   if( p < n || finish ) {
@@ -361,12 +522,14 @@ webvtt_string_getline( webvtt_string *src, const char *buffer,
   }
   len = (webvtt_uint)( p - s );
   *pos += len;
-  if( d->length + len + 1 >= d->alloc ) {
+  out_len = len + 2 * nuls;
+
+  if( d->length + out_len + 1 >= d->alloc ) {
     if( truncate && d->alloc >= WEBVTT_MAX_LINE ) {
       /* truncate. */
       (*truncate)++;
     } else {
-      if( grow( str, len + 1 ) == WEBVTT_OUT_OF_MEMORY ) {
+      if( grow( str, out_len + 1 ) == WEBVTT_OUT_OF_MEMORY ) {
         ret = -1;
       }
       d = str->d;
@@ -374,15 +537,35 @@ webvtt_string_getline( webvtt_string *src, const char *buffer,
   }
 
   /* Copy everything in */
-  if( len && ret >= 0 && d->length + len < d->alloc ) {
-    memcpy( d->text + d->length, s, len );
-    d->length += len;
+  if( out_len && ret >= 0 && d->length + out_len < d->alloc ) {
+    if( nuls ) {
+      copy_replacing_nul( d->text + d->length, s, len );
+    } else {
+      memcpy( d->text + d->length, s, len );
+    }
+    d->length += out_len;
     d->text[ d->length ] = 0;
   }
 
   return ret;
 }
 
+WEBVTT_EXPORT int
+webvtt_string_getline( webvtt_string *src, const char *buffer,
+                       webvtt_uint *pos, int len, int *truncate,
+                       webvtt_bool finish )
+{
+  return read_line( src, buffer, pos, len, truncate, finish, 0 );
+}
+
+WEBVTT_INTERN int
+webvtt_string_getline_replace_nul( webvtt_string *str, const char *buffer,
+                                   webvtt_uint *pos, int len, int *truncate,
+                                   webvtt_bool finish )
+{
+  return read_line( str, buffer, pos, len, truncate, finish, 1 );
+}
+
 WEBVTT_EXPORT webvtt_status
 webvtt_string_putc( webvtt_string *str, char to_append )
 {
@@ -444,6 +627,10 @@ webvtt_string_append( webvtt_string *str, const char *buffer, int len )
     return WEBVTT_SUCCESS;
   }
 
+  if( WEBVTT_FAILED( result = webvtt_string_detach( str ) ) ) {
+    return result;
+  }
+
   if( !WEBVTT_FAILED( result = grow( str, str->d->length + len ) ) ) {
     memcpy( str->d->text + str->d->length, buffer, len );
     str->d->length += len;
@@ -513,7 +700,10 @@ webvtt_string_replace_all( webvtt_string *str, const char *search,
                            int search_len, const char *replace,
                            int replace_len )
 {
-  webvtt_status status = WEBVTT_SUCCESS;
+  webvtt_status status;
+  webvtt_string result;
+  const char *text, *end, *p, *q;
+  webvtt_uint count = 0;
   if( !str || !search || !replace ) {
     return WEBVTT_INVALID_PARAM;
   }
@@ -526,9 +716,45 @@ webvtt_string_replace_all( webvtt_string *str, const char *search,
     replace_len = ( int )strlen( replace );
   }
 
-  while( ( status = webvtt_string_replace( str, search, search_len, replace,
-                                           replace_len ) ) == 1 );
-  return status;
+  if( search_len == 0 ) {
+    return WEBVTT_SUCCESS;
+  }
+
+  /**
+   * Count the matches first, and then build the result in a single pass,
+   * rather than moving the rest of the string along for every match.
+   */
+  text = webvtt_string_text( str );
+  end = text + webvtt_string_length( str );
+  for( p = text; ( q = ( const char * )memmem( p, end - p, search,
+                                                search_len ) );
+       p = q + search_len ) {
+    ++count;
+  }
+  if( count == 0 ) {
+    return WEBVTT_SUCCESS;
+  }
+
+  if( WEBVTT_FAILED( status = webvtt_create_string( webvtt_string_length( str )
+                     - count * search_len + count * replace_len + 1,
+                     &result ) ) ) {
+    return status;
+  }
+  for( p = text; ( q = ( const char * )memmem( p, end - p, search,
+                                                search_len ) );
+       p = q + search_len ) {
+    memcpy( result.d->text + result.d->length, p, q - p );
+    result.d->length += q - p;
+    memcpy( result.d->text + result.d->length, replace, replace_len );
+    result.d->length += replace_len;
+  }
+  memcpy( result.d->text + result.d->length, p, end - p );
+  result.d->length += end - p;
+  result.d->text[ result.d->length ] = 0;
+
+  webvtt_release_string( str );
+  str->d = result.d;
+  return WEBVTT_SUCCESS;
 }
 
 /**
@@ -598,6 +824,162 @@ webvtt_release_stringlist( webvtt_stringlist **list )
   *list = 0;
 }
 
+WEBVTT_INTERN webvtt_status
+webvtt_stringlist_clear( webvtt_stringlist **list )
+{
+  webvtt_uint i;
+  webvtt_stringlist *l;
+
+  if( !list ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  l = *list;
+
+  if( !l || webvtt_ref_count( &l->refs ) != 1 ) {
+    webvtt_release_stringlist( list );
+    return webvtt_create_stringlist( list );
+  }
+
+  for( i = 0; i < l->length; i++ ) {
+    webvtt_release_string( &l->items[ i ] );
+  }
+  l->length = 0;
+  return WEBVTT_SUCCESS;
+}
+
+WEBVTT_INTERN void
+webvtt_init_intern_table( webvtt_intern_table *table )
+{
+  table->count = 0;
+  table->alloc = 0;
+  table->items = 0;
+}
+
+WEBVTT_INTERN void
+webvtt_release_intern_table( webvtt_intern_table *table )
+{
+  webvtt_uint i;
+  if( !table ) {
+    return;
+  }
+  for( i = 0; i < table->alloc; i++ ) {
+    if( table->items[ i ].str.d ) {
+      webvtt_release_string( &table->items[ i ].str );
+    }
+  }
+  webvtt_free( table->items );
+  webvtt_init_intern_table( table );
+}
+
+/**
+ * FNV-1a, which is plenty for the handful of short names a document uses.
+ */
+static webvtt_uint32
+intern_hash( const char *text, webvtt_uint length )
+{
+  webvtt_uint32 hash = 2166136261u;
+  while( length-- ) {
+    hash = ( hash ^ ( unsigned char )*text++ ) * 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * The slot holding 'text', or else the empty slot it belongs in. 'alloc' is
+ * always a power of two, and the table is never more than half full.
+ */
+static webvtt_interned *
+intern_slot( webvtt_interned *items, webvtt_uint alloc, webvtt_uint32 hash,
+             const char *text, webvtt_uint length )
+{
+  webvtt_uint i = hash & ( alloc - 1 );
+  while( items[ i ].str.d ) {
+    if( items[ i ].hash == hash &&
+        webvtt_string_length( &items[ i ].str ) == length &&
+        !memcmp( webvtt_string_text( &items[ i ].str ), text, length ) ) {
+      break;
+    }
+    i = ( i + 1 ) & ( alloc - 1 );
+  }
+  return items + i;
+}
+
+static webvtt_status
+intern_grow( webvtt_intern_table *table )
+{
+  webvtt_uint i, alloc = table->alloc ? table->alloc * 2 : 16;
+  webvtt_interned *items, *slot;
+  const webvtt_string *str;
+
+  items = ( webvtt_interned * )webvtt_alloc0( sizeof( webvtt_interned ) *
+                                              alloc );
+  if( !items ) {
+    return WEBVTT_OUT_OF_MEMORY;
+  }
+
+  for( i = 0; i < table->alloc; i++ ) {
+    str = &table->items[ i ].str;
+    if( str->d ) {
+      slot = intern_slot( items, alloc, table->items[ i ].hash,
+                          webvtt_string_text( str ),
+                          webvtt_string_length( str ) );
+      *slot = table->items[ i ];
+    }
+  }
+
+  webvtt_free( table->items );
+  table->items = items;
+  table->alloc = alloc;
+  return WEBVTT_SUCCESS;
+}
+
+WEBVTT_INTERN webvtt_status
+webvtt_intern_string( webvtt_intern_table *table, const char *text,
+                      webvtt_uint length, webvtt_string *out )
+{
+  webvtt_uint32 hash;
+  webvtt_interned *slot;
+  webvtt_status status;
+
+  if( !table || !out || ( !text && length ) ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  if( !length ) {
+    webvtt_init_string( out );
+    return WEBVTT_SUCCESS;
+  }
+
+  hash = intern_hash( text, length );
+  if( table->alloc ) {
+    slot = intern_slot( table->items, table->alloc, hash, text, length );
+    if( slot->str.d ) {
+      webvtt_copy_string( out, &slot->str );
+      return WEBVTT_SUCCESS;
+    }
+  }
+
+  if( table->count >= WEBVTT_INTERN_LIMIT ) {
+    return webvtt_create_string_with_text( out, text, ( int )length );
+  }
+
+  if( ( table->count + 1 ) * 2 > table->alloc &&
+      WEBVTT_FAILED( status = intern_grow( table ) ) ) {
+    return status;
+  }
+
+  slot = intern_slot( table->items, table->alloc, hash, text, length );
+  if( WEBVTT_FAILED( status = webvtt_create_string_with_text( &slot->str, text,
+                                                              ( int )length ) ) ) {
+    webvtt_release_string( &slot->str );
+    return status;
+  }
+  slot->hash = hash;
+  table->count++;
+  webvtt_copy_string( out, &slot->str );
+  return WEBVTT_SUCCESS;
+}
+
 WEBVTT_EXPORT webvtt_status
 webvtt_stringlist_push( webvtt_stringlist *list, webvtt_string *str )
 {
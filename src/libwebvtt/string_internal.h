@@ -60,15 +60,118 @@
 #   define __WEBVTT_STRING_INLINE
 # endif
 
+typedef void ( *webvtt_string_release_fn )( webvtt_string_data *d );
+
 struct
 webvtt_string_data_t {
   struct webvtt_refcount_t refs;
   webvtt_uint32 alloc;
   webvtt_uint32 length;
   char *text;
+
+  /**
+   * Borrowed text: when 'base' is non-null, 'text' points into the text of
+   * 'base' (which is kept alive by this string) rather than into 'array'.
+   * When 'release' is non-null, 'text' is externally owned memory which is
+   * handed to 'release' once the last reference goes away.
+   *
+   * Borrowed strings always have an 'alloc' of 0, so that any attempt to
+   * modify them will first copy the text into a private buffer.
+   */
+  webvtt_string_data *base;
+  webvtt_string_release_fn release;
   char array[1];
 };
 
+/**
+ * Wrap 'length' bytes of externally owned 'text' in a string without copying
+ * it. 'release' is called with the string data when the last reference to it
+ * is released.
+ */
+WEBVTT_INTERN webvtt_status
+webvtt_create_external_string( webvtt_string *out, char *text,
+                               webvtt_uint32 length,
+                               webvtt_string_release_fn release );
+
+/**
+ * Create a string sharing 'length' bytes of 'base', starting at 'offset',
+ * without copying them.
+ *
+ * The byte following the slice in 'base' is overwritten with a null
+ * terminator, so this may only be used on writable text which has already
+ * been consumed up to that point. If the slice reaches the end of 'base', the
+ * text is copied instead.
+ */
+WEBVTT_INTERN webvtt_status
+webvtt_create_string_slice( webvtt_string *out, const webvtt_string *base,
+                            webvtt_uint32 offset, webvtt_uint32 length );
+
+/**
+ * Same as webvtt_string_getline(), but replaces every '\0' in the line with
+ * U+FFFD REPLACEMENT CHARACTER as it is copied.
+ */
+WEBVTT_INTERN int
+webvtt_string_getline_replace_nul( webvtt_string *str, const char *buffer,
+                                   webvtt_uint *pos, int len, int *truncate,
+                                   webvtt_bool finish );
+
+/**
+ * Empty 'str', keeping its buffer for reuse if nothing else shares it.
+ */
+WEBVTT_INTERN void
+webvtt_string_clear( webvtt_string *str );
+
+/**
+ * Empty '*list', keeping it (and its item array) for reuse if nothing else
+ * shares it, or replacing it with a new list otherwise.
+ */
+WEBVTT_INTERN webvtt_status
+webvtt_stringlist_clear( webvtt_stringlist **list );
+
+/**
+ * Most interned strings a table will hold on to. Text seen after the table is
+ * full still gets a string, just not a shared one, so that a document with an
+ * endless supply of distinct class names can't grow the table without bound.
+ */
+# ifndef WEBVTT_INTERN_LIMIT
+#   define WEBVTT_INTERN_LIMIT 0x1000
+# endif
+
+typedef struct
+webvtt_interned_t {
+  webvtt_uint32 hash;
+  webvtt_string str;
+} webvtt_interned;
+
+/**
+ * Open addressed hash set of strings, so that text which turns up over and
+ * over (such as class names and voice annotations) is only stored once, and
+ * every copy of it shares the same webvtt_string_data.
+ */
+typedef struct
+webvtt_intern_table_t {
+  webvtt_uint count;
+  webvtt_uint alloc;
+  webvtt_interned *items;
+} webvtt_intern_table;
+
+WEBVTT_INTERN void
+webvtt_init_intern_table( webvtt_intern_table *table );
+
+WEBVTT_INTERN void
+webvtt_release_intern_table( webvtt_intern_table *table );
+
+/**
+ * Set 'out' to a string holding the 'length' bytes at 'text', sharing it with
+ * every other string interned in 'table' with the same text.
+ *
+ * Interned strings must never be modified in place, which is taken care of by
+ * their reference count: the table always holds one of its own.
+ */
+WEBVTT_INTERN webvtt_status
+webvtt_intern_string( webvtt_intern_table *table, const char *text,
+                      webvtt_uint length, webvtt_string *out );
+
 static __WEBVTT_STRING_INLINE  int
 webvtt_isalpha( char ch )
 {
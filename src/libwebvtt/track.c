@@ -0,0 +1,280 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "track_internal.h"
+
+/**
+ * Subtrees with no more than this many levels are scanned from one end to the
+ * other, rather than walked node by node
+ */
+#define SCAN_LEVELS 3
+
+/**
+ * Text track cue order
+ */
+static int
+compare_entries( const void *a, const void *b )
+{
+  const track_entry *x = ( const track_entry * )a;
+  const track_entry *y = ( const track_entry * )b;
+  if( x->from != y->from ) {
+    return x->from < y->from ? -1 : 1;
+  }
+  if( x->until != y->until ) {
+    return x->until > y->until ? -1 : 1;
+  }
+  return x->order < y->order ? -1 : x->order > y->order;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_create_cue_track( webvtt_cue_track *ppout )
+{
+  webvtt_cue_track self;
+  if( !ppout ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  if( !( self = ( webvtt_cue_track )webvtt_alloc0( sizeof *self ) ) ) {
+    return WEBVTT_OUT_OF_MEMORY;
+  }
+  self->levels = -1;
+  self->sorted = 1;
+  *ppout = self;
+  return WEBVTT_SUCCESS;
+}
+
+WEBVTT_EXPORT void
+webvtt_delete_cue_track( webvtt_cue_track self )
+{
+  webvtt_uint i;
+  if( self ) {
+    for( i = 0; i < self->count; ++i ) {
+      webvtt_release_cue( &self->entries[ i ].cue );
+    }
+    webvtt_free( self->entries );
+    webvtt_free( self );
+  }
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_cue_track_add( webvtt_cue_track self, webvtt_cue *cue )
+{
+  track_entry *entry;
+  if( !self || !cue || cue->until < cue->from ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  if( self->count == self->alloc ) {
+    webvtt_uint alloc = self->alloc ? self->alloc * 2 : 16;
+    track_entry *entries;
+    if( alloc < self->alloc ||
+        !( entries = ( track_entry * )webvtt_alloc( alloc *
+                                                    sizeof *entries ) ) ) {
+      return WEBVTT_OUT_OF_MEMORY;
+    }
+    if( self->count ) {
+      memcpy( entries, self->entries, self->count * sizeof *entries );
+    }
+    webvtt_free( self->entries );
+    self->entries = entries;
+    self->alloc = alloc;
+  }
+
+  entry = self->entries + self->count;
+  entry->from = cue->from;
+  entry->until = cue->until;
+  entry->max = cue->until;
+  entry->cue = cue;
+  entry->order = self->count;
+  webvtt_ref_cue( cue );
+
+  if( self->count && compare_entries( entry - 1, entry ) > 0 ) {
+    self->sorted = 0;
+  }
+  ++self->count;
+  self->levels = -1;
+  return WEBVTT_SUCCESS;
+}
+
+/**
+ * Sort the entries if need be, and fill in the 'max' of every node of the
+ * implicit tree.
+ *
+ * The level of the entry at index i is the number of trailing 1 bits in i:
+ * leaves are at even indices, and the children of a node x at level k > 0 are
+ * x - 2^(k-1) and x + 2^(k-1). When the count isn't one less than a power of
+ * two, parts of the tree fall off the end of the array; a missing right child
+ * stands for the entries past the last one in its subtree, which 'last'
+ * carries up level by level.
+ */
+WEBVTT_INTERN void
+webvtt_index_cue_track( webvtt_cue_track self )
+{
+  webvtt_uint n = self->count, i, last_i = 0, x, step;
+  webvtt_timestamp last = 0, left, right, max;
+  track_entry *entries = self->entries;
+  int k;
+
+  if( self->levels >= 0 ) {
+    return;
+  }
+
+  if( !self->sorted ) {
+    qsort( entries, n, sizeof *entries, &compare_entries );
+    self->sorted = 1;
+  }
+
+  for( i = 0; i < n; i += 2 ) {
+    last_i = i;
+    last = entries[ i ].max = entries[ i ].until;
+  }
+  for( k = 1; ( ( webvtt_uint64 )1 << k ) <= n; ++k ) {
+    x = ( webvtt_uint )1 << ( k - 1 );
+    step = x << 2;
+    for( i = ( x << 1 ) - 1; i < n; i += step ) {
+      left = entries[ i - x ].max;
+      right = i + x < n ? entries[ i + x ].max : last;
+      max = entries[ i ].until;
+      max = left > max ? left : max;
+      max = right > max ? right : max;
+      entries[ i ].max = max;
+    }
+    last_i = ( last_i >> k ) & 1 ? last_i - x : last_i + x;
+    if( last_i < n && entries[ last_i ].max > last ) {
+      last = entries[ last_i ].max;
+    }
+  }
+  self->levels = n ? k - 1 : 0;
+}
+
+WEBVTT_EXPORT webvtt_uint
+webvtt_cue_track_count( webvtt_cue_track self )
+{
+  return self ? self->count : 0;
+}
+
+WEBVTT_EXPORT webvtt_cue *
+webvtt_cue_track_get( webvtt_cue_track self, webvtt_uint index )
+{
+  if( !self || index >= self->count ) {
+    return 0;
+  }
+  webvtt_index_cue_track( self );
+  return self->entries[ index ].cue;
+}
+
+typedef struct
+track_visit_t {
+  webvtt_uint node;
+  int level;
+  webvtt_bool left_done;
+} track_visit;
+
+WEBVTT_EXPORT webvtt_uint
+webvtt_cue_track_overlapping( webvtt_cue_track self, webvtt_timestamp from,
+                              webvtt_timestamp until, webvtt_cue **out,
+                              webvtt_uint max )
+{
+  /**
+   * Each level of the tree adds at most two visits to the stack
+   */
+  track_visit stack[ 2 * 64 ];
+  track_visit visit;
+  const track_entry *entries;
+  webvtt_uint n, found = 0, i, end, half;
+  int top = 0;
+
+  if( !self || !self->count || from >= until ) {
+    return 0;
+  }
+  webvtt_index_cue_track( self );
+  entries = self->entries;
+  n = self->count;
+
+  /**
+   * An in-order walk, so that the cues come out in text track cue order.
+   * Subtrees whose latest end time is no later than 'from' are skipped, and
+   * so is everything to the right of an entry starting at or after 'until'.
+   */
+  stack[ top ].node = ( ( webvtt_uint )1 << self->levels ) - 1;
+  stack[ top ].level = self->levels;
+  stack[ top++ ].left_done = 0;
+  while( top ) {
+    visit = stack[ --top ];
+    if( visit.level <= SCAN_LEVELS ) {
+      i = visit.node >> visit.level << visit.level;
+      end = i + ( ( webvtt_uint )1 << ( visit.level + 1 ) ) - 1;
+      if( end > n ) {
+        end = n;
+      }
+      for( ; i < end && entries[ i ].from < until; ++i ) {
+        if( entries[ i ].until > from ) {
+          if( found < max ) {
+            out[ found ] = entries[ i ].cue;
+          }
+          ++found;
+        }
+      }
+    } else if( !visit.left_done ) {
+      half = ( webvtt_uint )1 << ( visit.level - 1 );
+      visit.left_done = 1;
+      stack[ top++ ] = visit;
+      if( visit.node - half >= n || entries[ visit.node - half ].max > from ) {
+        stack[ top ].node = visit.node - half;
+        stack[ top ].level = visit.level - 1;
+        stack[ top++ ].left_done = 0;
+      }
+    } else if( visit.node < n && entries[ visit.node ].from < until ) {
+      if( entries[ visit.node ].until > from ) {
+        if( found < max ) {
+          out[ found ] = entries[ visit.node ].cue;
+        }
+        ++found;
+      }
+      half = ( webvtt_uint )1 << ( visit.level - 1 );
+      stack[ top ].node = visit.node + half;
+      stack[ top ].level = visit.level - 1;
+      stack[ top++ ].left_done = 0;
+    }
+  }
+  return found;
+}
+
+WEBVTT_EXPORT webvtt_uint
+webvtt_cue_track_active( webvtt_cue_track self, webvtt_timestamp time,
+                         webvtt_cue **out, webvtt_uint max )
+{
+  /**
+   * Timestamps are whole milliseconds, so this is [time, time + 1). Nothing
+   * can be active at the very last timestamp, which ends nowhere.
+   */
+  if( time + 1 < time ) {
+    return 0;
+  }
+  return webvtt_cue_track_overlapping( self, time, time + 1, out, max );
+}
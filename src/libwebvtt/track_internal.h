@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INTERN_TRACK_H__
+# define __INTERN_TRACK_H__
+# include <webvtt/track.h>
+
+/**
+ * 'from' comes first, so that cursors can search entries by start time the
+ * same way as their own arrays of times.
+ */
+typedef struct
+track_entry_t {
+  webvtt_timestamp from;
+  webvtt_timestamp until;
+  /**
+   * Latest 'until' in the subtree rooted at this entry
+   */
+  webvtt_timestamp max;
+  webvtt_cue *cue;
+  /**
+   * Number of cues added to the track before this one
+   */
+  webvtt_uint order;
+} track_entry;
+
+struct
+webvtt_cue_track_t {
+  track_entry *entries;
+  webvtt_uint count;
+  webvtt_uint alloc;
+  /**
+   * Level of the root of the implicit tree, or -1 if the index is out of date
+   */
+  int levels;
+  webvtt_bool sorted;
+};
+
+/**
+ * Bring the index of 'track' up to date, if cues were added since it was last
+ * built.
+ */
+WEBVTT_INTERN void
+webvtt_index_cue_track( webvtt_cue_track track );
+
+#endif
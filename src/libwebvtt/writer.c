@@ -0,0 +1,418 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <webvtt/writer.h>
+#include "cue_internal.h"
+#include "parser_internal.h"
+
+#define MSECS_PER_HOUR (3600000)
+#define MSECS_PER_MINUTE (60000)
+#define MSECS_PER_SECOND (1000)
+
+/**
+ * Every two digit number, so that numbers are written two digits at a time
+ */
+static const char digit_pairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+static const char *const tag_names[] = {
+  "c", "i", "b", "u", "ruby", "rt", "v", "lang"
+};
+
+static const char *const align_names[] = {
+  "start", "middle", "end", "left", "right"
+};
+
+static const char *const vertical_names[] = {
+  "", "lr", "rl"
+};
+
+WEBVTT_EXPORT void
+webvtt_init_writer( webvtt_writer *writer, char *buffer, webvtt_uint size,
+                    webvtt_write_fn sink, void *userdata )
+{
+  if( !writer ) {
+    return;
+  }
+  writer->sink = sink;
+  writer->userdata = userdata;
+  writer->buffer = buffer;
+  writer->size = buffer ? size : 0;
+  writer->length = 0;
+  writer->total = 0;
+  writer->status = WEBVTT_SUCCESS;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_flush_writer( webvtt_writer *writer )
+{
+  if( !writer ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  if( writer->sink && writer->length && writer->status == WEBVTT_SUCCESS ) {
+    writer->status = writer->sink( writer->userdata, writer->buffer,
+                                   writer->length );
+    writer->length = 0;
+  }
+  return writer->status;
+}
+
+static void
+put( webvtt_writer *writer, const char *text, webvtt_uint length )
+{
+  writer->total += length;
+  if( writer->status != WEBVTT_SUCCESS ) {
+    return;
+  }
+
+  if( writer->size - writer->length >= length ) {
+    memcpy( writer->buffer + writer->length, text, length );
+    writer->length += length;
+  } else if( !writer->sink ) {
+    writer->status = WEBVTT_OUT_OF_MEMORY;
+  } else if( webvtt_flush_writer( writer ) == WEBVTT_SUCCESS ) {
+    if( length > writer->size ) {
+      writer->status = writer->sink( writer->userdata, text, length );
+    } else {
+      memcpy( writer->buffer, text, length );
+      writer->length = length;
+    }
+  }
+}
+
+#define PUT_LITERAL( writer, literal ) \
+  put( ( writer ), ( literal ), sizeof( literal ) - 1 )
+
+static void
+put_string( webvtt_writer *writer, const webvtt_string *str )
+{
+  put( writer, webvtt_string_text( str ), webvtt_string_length( str ) );
+}
+
+/**
+ * Write the decimal digits of 'value' to the end of the buffer which ends at
+ * 'end', returning where they start.
+ */
+static char *
+format_uint( webvtt_uint64 value, char *end )
+{
+  while( value >= 100 ) {
+    end -= 2;
+    memcpy( end, digit_pairs + 2 * ( value % 100 ), 2 );
+    value /= 100;
+  }
+  if( value >= 10 ) {
+    end -= 2;
+    memcpy( end, digit_pairs + 2 * value, 2 );
+  } else {
+    *--end = ( char )( '0' + value );
+  }
+  return end;
+}
+
+static void
+put_int( webvtt_writer *writer, int value )
+{
+  char buffer[ 16 ], *end = buffer + sizeof( buffer ), *p;
+  p = format_uint( value < 0 ? -( webvtt_uint64 )value : ( webvtt_uint64 )value,
+                   end );
+  if( value < 0 ) {
+    *--p = '-';
+  }
+  put( writer, p, ( webvtt_uint )( end - p ) );
+}
+
+WEBVTT_EXPORT webvtt_uint
+webvtt_format_timestamp( webvtt_timestamp ts, char *out )
+{
+  webvtt_uint64 hours = ts / MSECS_PER_HOUR;
+  webvtt_uint rest = ( webvtt_uint )( ts % MSECS_PER_HOUR );
+  webvtt_uint minutes = rest / MSECS_PER_MINUTE;
+  webvtt_uint seconds = rest / MSECS_PER_SECOND % 60;
+  webvtt_uint millis = rest % MSECS_PER_SECOND;
+  char *p = out;
+
+  if( !out ) {
+    return 0;
+  }
+
+  if( hours < 100 ) {
+    memcpy( p, digit_pairs + 2 * hours, 2 );
+    p += 2;
+  } else {
+    char digits[ 20 ], *end = digits + sizeof( digits ), *q;
+    q = format_uint( hours, end );
+    memcpy( p, q, end - q );
+    p += end - q;
+  }
+
+  p[ 0 ] = ':';
+  memcpy( p + 1, digit_pairs + 2 * minutes, 2 );
+  p[ 3 ] = ':';
+  memcpy( p + 4, digit_pairs + 2 * seconds, 2 );
+  p[ 6 ] = '.';
+  p[ 7 ] = ( char )( '0' + millis / 100 );
+  memcpy( p + 8, digit_pairs + 2 * ( millis % 100 ), 2 );
+  p[ 10 ] = 0;
+
+  return ( webvtt_uint )( p + 10 - out );
+}
+
+static void
+put_timestamp( webvtt_writer *writer, webvtt_timestamp ts )
+{
+  char buffer[ WEBVTT_MAX_TIMESTAMP_LENGTH ];
+  put( writer, buffer, webvtt_format_timestamp( ts, buffer ) );
+}
+
+/**
+ * Write cue text, escaping the characters which would otherwise be read as
+ * markup.
+ */
+static void
+put_escaped( webvtt_writer *writer, const webvtt_string *str )
+{
+  const char *p = webvtt_string_text( str );
+  const char *end = p + webvtt_string_length( str );
+  webvtt_uint run;
+
+  while( p < end ) {
+    run = ( webvtt_uint )strcspn( p, "&<>" );
+    if( run > ( webvtt_uint )( end - p ) ) {
+      run = ( webvtt_uint )( end - p );
+    }
+    put( writer, p, run );
+    p += run;
+    if( p == end ) {
+      break;
+    }
+    switch( *p++ ) {
+      case '&':
+        PUT_LITERAL( writer, "&amp;" );
+        break;
+      case '<':
+        PUT_LITERAL( writer, "&lt;" );
+        break;
+      case '>':
+        PUT_LITERAL( writer, "&gt;" );
+        break;
+      default:
+        /* A NUL, which strcspn() stopped at */
+        put( writer, p - 1, 1 );
+        break;
+    }
+  }
+}
+
+static void
+put_node( webvtt_writer *writer, const webvtt_node *node )
+{
+  const webvtt_internal_node_data *data;
+  const char *name;
+  webvtt_uint i;
+
+  if( !node ) {
+    return;
+  }
+
+  if( node->kind == WEBVTT_TEXT ) {
+    put_escaped( writer, &node->data.text );
+    return;
+  } else if( node->kind == WEBVTT_TIME_STAMP ) {
+    PUT_LITERAL( writer, "<" );
+    put_timestamp( writer, node->data.timestamp );
+    PUT_LITERAL( writer, ">" );
+    return;
+  } else if( !WEBVTT_IS_VALID_INTERNAL_NODE( node->kind ) ) {
+    return;
+  }
+
+  data = node->data.internal_data;
+  name = 0;
+  if( node->kind != WEBVTT_HEAD_NODE ) {
+    name = tag_names[ WEBVTT_NODE_INDEX( node->kind ) ];
+    PUT_LITERAL( writer, "<" );
+    put( writer, name, ( webvtt_uint )strlen( name ) );
+    if( data->css_classes ) {
+      for( i = 0; i < data->css_classes->length; ++i ) {
+        PUT_LITERAL( writer, "." );
+        put_string( writer, data->css_classes->items + i );
+      }
+    }
+    if( node->kind == WEBVTT_VOICE &&
+        !webvtt_string_is_empty( &data->annotation ) ) {
+      PUT_LITERAL( writer, " " );
+      put_string( writer, &data->annotation );
+    } else if( node->kind == WEBVTT_LANG &&
+               !webvtt_string_is_empty( &data->lang ) ) {
+      PUT_LITERAL( writer, " " );
+      put_string( writer, &data->lang );
+    }
+    PUT_LITERAL( writer, ">" );
+  }
+
+  for( i = 0; i < data->length; ++i ) {
+    put_node( writer, data->children[ i ] );
+  }
+
+  if( name ) {
+    PUT_LITERAL( writer, "</" );
+    put( writer, name, ( webvtt_uint )strlen( name ) );
+    PUT_LITERAL( writer, ">" );
+  }
+}
+
+/**
+ * Write the settings of 'cue' which differ from the defaults, or which were
+ * given explicitly when the cue was read.
+ */
+static void
+put_settings( webvtt_writer *writer, const webvtt_cue *cue )
+{
+  const webvtt_cue_settings *settings = &cue->settings;
+  const char *name;
+
+  if( settings->vertical != WEBVTT_HORIZONTAL &&
+      ( webvtt_uint )settings->vertical <
+        sizeof( vertical_names ) / sizeof( *vertical_names ) ) {
+    PUT_LITERAL( writer, " vertical:" );
+    name = vertical_names[ settings->vertical ];
+    put( writer, name, ( webvtt_uint )strlen( name ) );
+  }
+  /* line:-1 is stored the same way as auto, only the flag tells them apart */
+  if( cue->flags & CUE_HAVE_LINE ) {
+    PUT_LITERAL( writer, " line:" );
+    put_int( writer, settings->line );
+    if( !cue->snap_to_lines ) {
+      PUT_LITERAL( writer, "%" );
+    }
+  }
+  if( settings->position != 50 || cue->flags & CUE_HAVE_POSITION ) {
+    PUT_LITERAL( writer, " position:" );
+    put_int( writer, ( int )settings->position );
+    PUT_LITERAL( writer, "%" );
+  }
+  if( settings->size != 100 || cue->flags & CUE_HAVE_SIZE ) {
+    PUT_LITERAL( writer, " size:" );
+    put_int( writer, ( int )settings->size );
+    PUT_LITERAL( writer, "%" );
+  }
+  if( ( settings->align != WEBVTT_ALIGN_MIDDLE ||
+        cue->flags & CUE_HAVE_ALIGN ) &&
+      ( webvtt_uint )settings->align <
+        sizeof( align_names ) / sizeof( *align_names ) ) {
+    PUT_LITERAL( writer, " align:" );
+    name = align_names[ settings->align ];
+    put( writer, name, ( webvtt_uint )strlen( name ) );
+  }
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_write_text( webvtt_writer *writer, const char *text,
+                   webvtt_uint length )
+{
+  if( !writer || ( !text && length ) ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  put( writer, text, length );
+  return writer->status;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_write_header( webvtt_writer *writer )
+{
+  if( !writer ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+  PUT_LITERAL( writer, "WEBVTT\n\n" );
+  return writer->status;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_write_cue( webvtt_writer *writer, const webvtt_cue *cue,
+                  webvtt_uint options )
+{
+  if( !writer || !cue || BAD_TIMESTAMP( cue->from ) ||
+      BAD_TIMESTAMP( cue->until ) ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  if( !webvtt_string_is_empty( &cue->id ) ) {
+    put_string( writer, &cue->id );
+    PUT_LITERAL( writer, "\n" );
+  }
+
+  put_timestamp( writer, cue->from );
+  PUT_LITERAL( writer, " --> " );
+  put_timestamp( writer, cue->until );
+  put_settings( writer, cue );
+  PUT_LITERAL( writer, "\n" );
+
+  if( ( options & WEBVTT_WRITE_NODES ) && cue->node_head ) {
+    if( cue->node_head->data.internal_data->length ) {
+      put_node( writer, cue->node_head );
+      PUT_LITERAL( writer, "\n" );
+    }
+  } else if( !webvtt_string_is_empty( &cue->body ) ) {
+    put_string( writer, &cue->body );
+    PUT_LITERAL( writer, "\n" );
+  }
+  PUT_LITERAL( writer, "\n" );
+
+  return writer->status;
+}
+
+WEBVTT_EXPORT webvtt_status
+webvtt_write_document( webvtt_writer *writer, webvtt_cue *const *cues,
+                       webvtt_uint count, webvtt_uint options )
+{
+  webvtt_uint i;
+  webvtt_status status;
+
+  if( !writer || ( !cues && count ) ) {
+    return WEBVTT_INVALID_PARAM;
+  }
+
+  webvtt_write_header( writer );
+  for( i = 0; i < count; ++i ) {
+    if( ( status = webvtt_write_cue( writer, cues[ i ], options ) )
+        == WEBVTT_INVALID_PARAM ) {
+      return status;
+    }
+  }
+  return webvtt_flush_writer( writer );
+}
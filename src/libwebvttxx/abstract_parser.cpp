@@ -53,12 +53,55 @@ AbstractParser::finishParsing()
   return webvtt_finish_parsing( parser );
 }
 
+::webvtt_status
+AbstractParser::reset()
+{
+  return webvtt_reset_parser( parser );
+}
+
 ::webvtt_status
 AbstractParser::parseChunk( const void *chunk, webvtt_uint length )
 {
   return webvtt_parse_chunk( parser, chunk, length );
 }
 
+::webvtt_status
+AbstractParser::parseMappedFile( const char *path )
+{
+  return webvtt_parse_mapped_file( parser, path );
+}
+
+::webvtt_status
+AbstractParser::setLazyCueText( bool lazy )
+{
+  webvtt_uint options = webvtt_get_parser_options( parser );
+  if( lazy ) {
+    options |= WEBVTT_PARSE_LAZY_CUETEXT;
+  } else {
+    options &= ~WEBVTT_PARSE_LAZY_CUETEXT;
+  }
+  return webvtt_set_parser_options( parser, options );
+}
+
+::webvtt_status
+AbstractParser::setCueBlockSize( webvtt_uint size )
+{
+  if( !size ) {
+    return webvtt_set_parser_cues_fn( parser, 0, 0 );
+  }
+  cueBlock.reserve( size );
+  return webvtt_set_parser_cues_fn( parser, &__parsedCues, size );
+}
+
+void
+AbstractParser::parsedCues( const Cue *cues, size_t count )
+{
+  for( size_t i = 0; i < count; ++i ) {
+    Cue cue( cues[ i ] );
+    parsedCue( cue );
+  }
+}
+
 void WEBVTT_CALLBACK
 AbstractParser::__parsedCue( void *userdata, webvtt_cue *pcue )
 {
@@ -72,6 +115,20 @@ AbstractParser::__parsedCue( void *userdata, webvtt_cue *pcue )
   self->parsedCue( cue );
 }
 
+void WEBVTT_CALLBACK
+AbstractParser::__parsedCues( void *userdata, webvtt_cue **pcues,
+                              webvtt_uint count )
+{
+  AbstractParser *self = reinterpret_cast<AbstractParser *>( userdata );
+  std::vector<Cue> &cues = self->cueBlock;
+  for( webvtt_uint i = 0; i < count; ++i ) {
+    cues.push_back( Cue( pcues[ i ] ) );
+    webvtt_release_cue( &pcues[ i ] );
+  }
+  self->parsedCues( &cues[ 0 ], cues.size() );
+  cues.clear();
+}
+
 int WEBVTT_CALLBACK
 AbstractParser::__reportError( void *userdata, webvtt_uint line,
                                webvtt_uint col, webvtt_error error )
@@ -0,0 +1,108 @@
+//
+// Copyright (c) 2013 Mozilla Foundation and Contributors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//  - Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//  - Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <webvttxx/cue_reader>
+
+namespace WebVTT
+{
+
+CueReader::CueReader( std::istream &src, uint chunkSize )
+  : source( src ), chunk( chunkSize ? chunkSize : 0x1000 ), parser( 0 )
+{
+  _status = webvtt_create_parser( 0, &__reportError, this, &parser );
+}
+
+CueReader::~CueReader()
+{
+  webvtt_delete_parser( parser );
+}
+
+bool
+CueReader::reportError( const Error & )
+{
+  return true;
+}
+
+webvtt_cue *
+CueReader::nextCue()
+{
+  webvtt_cue *cue = 0;
+  /**
+   * WEBVTT_UNFINISHED only means that the parser wants more input, which is
+   * what a cue that is being skipped gives back at the end of a chunk, so
+   * only stop on real errors.
+   */
+  while( _status == WEBVTT_SUCCESS || _status == WEBVTT_UNFINISHED ) {
+    _status = webvtt_parser_next_cue( parser, &cue );
+    if( _status != WEBVTT_UNFINISHED ) {
+      break;
+    }
+
+    /**
+     * The parser needs more input, so read another chunk, or finish at the
+     * end of the stream.
+     */
+    source.read( &chunk[ 0 ], chunk.size() );
+    uint length = (uint)source.gcount();
+    if( length ) {
+      _status = webvtt_parse_chunk( parser, &chunk[ 0 ], length );
+    } else {
+      _status = webvtt_finish_parsing( parser );
+    }
+  }
+  return WEBVTT_FAILED( _status ) ? 0 : cue;
+}
+
+void
+CueReader::iterator::next()
+{
+  webvtt_cue *pcue = reader ? reader->nextCue() : 0;
+  if( !pcue ) {
+    reader = 0;
+    cue = Cue();
+    return;
+  }
+  cue = Cue( pcue );
+  /**
+   * Cue object increases the reference count of pcue, so we can dereference it
+   */
+  webvtt_release_cue( &pcue );
+}
+
+int WEBVTT_CALLBACK
+CueReader::__reportError( void *userdata, webvtt_uint line, webvtt_uint col,
+                          webvtt_error error )
+{
+  CueReader *self = reinterpret_cast<CueReader *>( userdata );
+  Error err( line, col, error );
+  if( !self->reportError( err ) ) {
+    return -1;
+  }
+  return 0;
+}
+
+}
@@ -28,8 +28,21 @@
 #include <webvtt/parser.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <ctype.h>
+#include <time.h>
+#include <sys/stat.h>
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+# include <unistd.h>
+# include <sys/time.h>
+#endif
+
+#define USAGE \
+  "Usage: parsevtt [-s <shards>] -f <vttfile>\n" \
+  "       parsevtt [-j <workers>] [-l <listfile>] [-f <vttfile>]... " \
+  "[vttfile]...\n"
 
 static int WEBVTT_CALLBACK
 error( void *userdata, webvtt_uint line, webvtt_uint col, webvtt_error errcode )
@@ -46,24 +59,367 @@ cue( void *userdata, webvtt_cue *cue )
   (void)cue;
 }
 
-int
-parse_fh(FILE *fh, webvtt_parser vtt)
+/**
+ * Batch mode: every file is parsed to the end, counting its cues and errors,
+ * and a line is printed for each in the order they were given, followed by
+ * the totals.
+ */
+typedef struct
+job_t {
+  const char *path;
+  unsigned long cues;
+  unsigned long errors;
+  unsigned long bytes;
+  /* errno of a file which couldn't be read, or 0 */
+  int failed;
+} job;
+
+typedef struct
+batch_t {
+  job *jobs;
+  size_t count;
+  size_t alloc;
+  size_t next;
+#ifdef HAVE_PTHREAD
+  pthread_mutex_t lock;
+#endif
+} batch;
+
+static int WEBVTT_CALLBACK
+count_error( void *userdata, webvtt_uint line, webvtt_uint col,
+             webvtt_error errcode )
+{
+  (void)line;
+  (void)col;
+  (void)errcode;
+  ++( *(job **)userdata )->errors;
+  return 0; /* Keep going, to count them all */
+}
+
+static void WEBVTT_CALLBACK
+count_cue( void *userdata, webvtt_cue *cue )
+{
+  ++( *(job **)userdata )->cues;
+  webvtt_release_cue( &cue );
+}
+
+static int
+add_job( batch *b, const char *path )
+{
+  if( b->count == b->alloc ) {
+    size_t alloc = b->alloc ? b->alloc * 2 : 64;
+    job *jobs = (job *)realloc( b->jobs, alloc * sizeof *jobs );
+    if( !jobs ) {
+      fprintf( stderr, "error: out of memory\n" );
+      return 0;
+    }
+    b->jobs = jobs;
+    b->alloc = alloc;
+  }
+  memset( b->jobs + b->count, 0, sizeof *b->jobs );
+  b->jobs[ b->count++ ].path = path;
+  return 1;
+}
+
+/**
+ * Add every line of 'list' (or of standard input, for "-") as a file to parse.
+ * The paths are never freed, as they last as long as the program does.
+ */
+static int
+add_list( batch *b, const char *list )
+{
+  char line[ 4096 ];
+  FILE *f = strcmp( list, "-" ) ? fopen( list, "r" ) : stdin;
+  if( !f ) {
+    fprintf( stderr, "error: failed to open `%s': %s\n", list,
+             strerror( errno ) );
+    return 0;
+  }
+  while( fgets( line, sizeof line, f ) ) {
+    size_t length = strlen( line );
+    char *path;
+    while( length && isspace( (unsigned char)line[ length - 1 ] ) ) {
+      --length;
+    }
+    if( !length ) {
+      continue;
+    }
+    if( !( path = (char *)malloc( length + 1 ) ) ) {
+      fprintf( stderr, "error: out of memory\n" );
+      return 0;
+    }
+    memcpy( path, line, length );
+    path[ length ] = 0;
+    if( !add_job( b, path ) ) {
+      return 0;
+    }
+  }
+  if( f != stdin ) {
+    fclose( f );
+  }
+  return 1;
+}
+
+/**
+ * Parse one file with 'vtt', whose callbacks count into '*current'
+ */
+static void
+run_job( webvtt_parser vtt, job **current, job *j )
 {
-  /**
-   * Try to parse the file.
-   */
-  int finished;
   webvtt_status result;
-  do {
-    char buffer[0x1000];
-    webvtt_uint n_read = (webvtt_uint)fread( buffer, 1, sizeof(buffer), fh );
-    finished = feof( fh );
-    if( WEBVTT_FAILED(result = webvtt_parse_chunk( vtt, buffer, n_read )) ) {
-      return 1;
+  struct stat st;
+
+  if( !vtt ) {
+    j->failed = ENOMEM;
+    return;
+  }
+  *current = j;
+  if( stat( j->path, &st ) == 0 ) {
+    j->bytes = (unsigned long)st.st_size;
+  }
+  errno = 0;
+  result = webvtt_parse_mapped_file( vtt, j->path );
+  if( result == WEBVTT_UNSUCCESSFUL && errno ) {
+    j->failed = errno;
+  }
+  webvtt_reset_parser( vtt );
+}
+
+/**
+ * Take the next file off the batch until there are none left, reading all of
+ * them with the same parser
+ */
+static void *
+worker( void *userdata )
+{
+  batch *b = (batch *)userdata;
+  webvtt_parser vtt;
+  job *j, *current = 0;
+  if( webvtt_create_parser( &count_cue, &count_error, &current, &vtt )
+      != WEBVTT_SUCCESS ) {
+    vtt = 0;
+  }
+  for( ;; ) {
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock( &b->lock );
+#endif
+    j = b->next < b->count ? b->jobs + b->next++ : 0;
+#ifdef HAVE_PTHREAD
+    pthread_mutex_unlock( &b->lock );
+#endif
+    if( !j ) {
+      webvtt_delete_parser( vtt );
+      return 0;
     }
-  } while( !finished && result == WEBVTT_SUCCESS );
-  webvtt_finish_parsing( vtt );
-  
+    run_job( vtt, &current, j );
+  }
+}
+
+static double
+seconds( void )
+{
+#ifdef HAVE_PTHREAD
+  struct timeval tv;
+  gettimeofday( &tv, 0 );
+  return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static int
+run_batch( batch *b, long workers )
+{
+  unsigned long cues = 0, errors = 0, bytes = 0, failed = 0;
+  double start = seconds(), elapsed;
+  size_t i;
+  int ret = 0;
+
+#ifdef HAVE_PTHREAD
+  pthread_t *threads;
+  long started = 0;
+  if( workers <= 0 ) {
+    workers = sysconf( _SC_NPROCESSORS_ONLN );
+  }
+  if( workers > (long)b->count ) {
+    workers = (long)b->count;
+  }
+  pthread_mutex_init( &b->lock, 0 );
+  threads = workers > 1 ? (pthread_t *)malloc( workers * sizeof *threads ) : 0;
+  if( threads ) {
+    for( ; started < workers - 1; ++started ) {
+      if( pthread_create( threads + started, 0, &worker, b ) != 0 ) {
+        break;
+      }
+    }
+  }
+  /* The main thread is a worker too */
+  worker( b );
+  while( started ) {
+    pthread_join( threads[ --started ], 0 );
+  }
+  free( threads );
+  pthread_mutex_destroy( &b->lock );
+#else
+  workers = 1;
+  worker( b );
+#endif
+
+  elapsed = seconds() - start;
+  for( i = 0; i < b->count; ++i ) {
+    const job *j = b->jobs + i;
+    if( j->failed ) {
+      fprintf( stdout, "%s: error: %s\n", j->path, strerror( j->failed ) );
+      ++failed;
+      ret = 1;
+      continue;
+    }
+    fprintf( stdout, "%s: %lu cues, %lu errors\n", j->path, j->cues,
+             j->errors );
+    cues += j->cues;
+    errors += j->errors;
+    bytes += j->bytes;
+    if( j->errors ) {
+      ret = 1;
+    }
+  }
+
+  fprintf( stdout, "%lu files (%lu unreadable), %lu cues, %lu errors; "
+           "%.1f MB in %.3f s on %ld workers",
+           (unsigned long)b->count, failed, cues, errors, bytes / 1e6,
+           elapsed, workers < 1 ? 1 : workers );
+  if( elapsed > 0 ) {
+    fprintf( stdout, " (%.1f MB/s, %.0f files/s)",
+             bytes / 1e6 / elapsed, b->count / elapsed );
+  }
+  fprintf( stdout, "\n" );
+  return ret;
+}
+
+/**
+ * Sharded mode: one large file is split into shards at cue boundaries, which
+ * are parsed on threads of their own. Errors are printed once they have all
+ * finished, the same as parsing the file in one go would have printed them.
+ */
+typedef struct
+shard_job_t {
+  webvtt_sharded_parser parser;
+  webvtt_uint index;
+} shard_job;
+
+static void WEBVTT_CALLBACK
+shard_cue( void *userdata, webvtt_cue *cue )
+{
+  (void)userdata;
+  webvtt_release_cue( &cue );
+}
+
+static void *
+parse_shard( void *userdata )
+{
+  shard_job *j = (shard_job *)userdata;
+  webvtt_parse_shard( j->parser, j->index );
+  return 0;
+}
+
+static int
+run_sharded( const char *path, long count )
+{
+  FILE *f;
+  char *buffer = 0;
+  long length = -1;
+  webvtt_sharded_parser parser;
+  shard_job *jobs;
+  webvtt_uint n, i;
+  int ret = 0;
+
+  if( ( f = fopen( path, "rb" ) ) ) {
+    if( fseek( f, 0, SEEK_END ) == 0 && ( length = ftell( f ) ) >= 0
+        && fseek( f, 0, SEEK_SET ) == 0
+        && ( buffer = (char *)malloc( length + 1 ) )
+        && fread( buffer, 1, length, f ) != (size_t)length ) {
+      length = -1;
+    }
+    fclose( f );
+  }
+  if( !buffer || length < 0 ) {
+    fprintf( stderr, "error: failed to open `%s': %s\n", path,
+             strerror( errno ) );
+    free( buffer );
+    return 1;
+  }
+
+  if( webvtt_create_sharded_parser( buffer, (webvtt_uint)length,
+                                    (webvtt_uint)count, 0, &shard_cue,
+                                    &error, (void *)path, &parser )
+      != WEBVTT_SUCCESS ) {
+    fprintf( stderr, "error: failed to create VTT parser.\n" );
+    free( buffer );
+    return 1;
+  }
+  n = webvtt_sharded_parser_count( parser );
+  if( !( jobs = (shard_job *)malloc( n * sizeof *jobs ) ) ) {
+    fprintf( stderr, "error: out of memory\n" );
+    webvtt_delete_sharded_parser( parser );
+    free( buffer );
+    return 1;
+  }
+  for( i = 0; i < n; ++i ) {
+    jobs[ i ].parser = parser;
+    jobs[ i ].index = i;
+  }
+
+#ifdef HAVE_PTHREAD
+  {
+    pthread_t *threads = (pthread_t *)malloc( n * sizeof *threads );
+    webvtt_uint started = 0;
+    if( threads ) {
+      for( i = 1; i < n; ++i, ++started ) {
+        if( pthread_create( threads + started, 0, &parse_shard,
+                            jobs + i ) != 0 ) {
+          break;
+        }
+      }
+    }
+    parse_shard( jobs );
+    /* Any shards which didn't get a thread are parsed here */
+    for( i = started + 1; i < n; ++i ) {
+      parse_shard( jobs + i );
+    }
+    while( started ) {
+      pthread_join( threads[ --started ], 0 );
+    }
+    free( threads );
+  }
+#else
+  for( i = 0; i < n; ++i ) {
+    parse_shard( jobs + i );
+  }
+#endif
+
+  if( webvtt_finish_sharded_parser( parser ) != WEBVTT_SUCCESS ) {
+    ret = 1;
+  }
+  webvtt_delete_sharded_parser( parser );
+  free( jobs );
+  free( buffer );
+  return ret;
+}
+
+/**
+ * Read the value of a switch, either attached to it or as the next argument
+ */
+static const char *
+switch_value( int argc, char **argv, int *i )
+{
+  const char *p = argv[ *i ] + 2;
+  while( isspace(*p) ) { ++p; }
+  if( *p ) {
+    return p;
+  } else if( *i + 1 < argc ) {
+    return argv[ ++*i ];
+  }
+  fprintf( stderr, "error: missing parameter for switch `%s'\n", argv[ *i ] );
   return 0;
 }
 
@@ -71,60 +427,104 @@ int
 main( int argc, char **argv )
 {
   const char *input_file = 0;
+  const char *value;
   webvtt_status result;
   webvtt_parser vtt;
-  FILE *fh;
+  batch b;
+  int batch_mode = 0;
+  long workers = 0;
+  long shards = 0;
   int i;
   int ret = 0;
-  for( i = 0; i < argc; ++i ) {
+
+  memset( &b, 0, sizeof b );
+  for( i = 1; i < argc; ++i ) {
     const char *a = argv[i];
     if( *a == '-' ) {
       switch( a[1] ) {
         case 'f': {
-          const char *p = a + 2;
-          while( isspace(*p) ) { ++p; }
-          if( *p ) {
-            input_file = p;
-          } else if( i + 1 < argc ) {
-            input_file = argv[i + 1];
-            ++i;
-          } else {
-            fprintf( stderr, "error: missing parameter for switch `-f'\n" );
+          if( ( value = switch_value( argc, argv, &i ) ) ) {
+            if( !add_job( &b, value ) ) {
+              return 1;
+            }
+          }
+        }
+        break;
+
+        case 'l': {
+          batch_mode = 1;
+          if( ( value = switch_value( argc, argv, &i ) )
+              && !add_list( &b, value ) ) {
+            return 1;
+          }
+        }
+        break;
+
+        case 'j': {
+          batch_mode = 1;
+          if( ( value = switch_value( argc, argv, &i ) ) ) {
+            workers = atol( value );
+          }
+        }
+        break;
+
+        case 's': {
+          if( ( value = switch_value( argc, argv, &i ) ) ) {
+            shards = atol( value );
           }
         }
         break;
 
         case '?': {
-          fprintf( stdout, "Usage: parsevtt -f <vttfile>\n" );
+          fprintf( stdout, USAGE );
           return 0;
         }
         break;
       }
+    } else if( !add_job( &b, a ) ) {
+      return 1;
     }
   }
+
+  if( batch_mode || b.count > 1 ) {
+    ret = run_batch( &b, workers );
+    free( b.jobs );
+    return ret;
+  }
+  if( b.count ) {
+    input_file = b.jobs[ 0 ].path;
+  }
   if( !input_file ) {
-    fprintf( stderr, "error: missing input file.\n\nUsage: parsevtt -f <vttfile>\n" );
+    fprintf( stderr, "error: missing input file.\n\n" USAGE );
     return 1;
   }
-
-  fh = fopen(input_file, "rb");
-  if( !fh ) {
-    fprintf( stderr, "error: failed to open `%s'"
-             ": %s"
-             "\n", input_file,
-             strerror(errno)
-           );
-    return 1;
+  if( shards > 1 ) {
+    ret = run_sharded( input_file, shards );
+    free( b.jobs );
+    return ret;
   }
 
   if( ( result = webvtt_create_parser( &cue, &error, (void *)input_file, &vtt ) ) != WEBVTT_SUCCESS ) {
     fprintf( stderr, "error: failed to create VTT parser.\n" );
-    fclose( fh );
     return 1;
   }
 
-  ret = parse_fh( fh, vtt );
+  /**
+   * Try to parse the file.
+   */
+  errno = 0;
+  result = webvtt_parse_mapped_file( vtt, input_file );
+  if( result == WEBVTT_UNSUCCESSFUL && errno ) {
+    fprintf( stderr, "error: failed to open `%s'"
+             ": %s"
+             "\n", input_file,
+             strerror(errno)
+           );
+    ret = 1;
+  } else if( WEBVTT_FAILED( result ) ) {
+    ret = 1;
+  }
   webvtt_delete_parser( vtt );
-  fclose( fh );
+  free( b.jobs );
   return ret;
 }
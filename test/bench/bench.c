@@ -0,0 +1,292 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define USAGE \
+  "generator switches: [-n cues] [-p payload bytes] [-t %% tagged words]\n" \
+  "                    [-s %% cues with settings] [-u %% UTF-8 words] [-c]\n" \
+  "                    [-r seed]\n"
+
+static const char *words[] = {
+  "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "and",
+  "then", "says", "hello", "caption", "subtitle", "again", "world"
+};
+
+static const char *utf8_words[] = {
+  "caf\xc3\xa9", "na\xc3\xafve", "\xce\xb1\xce\xb2\xce\xb3",
+  "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e", "\xd0\xbc\xd0\xb8\xd1\x80",
+  "\xf0\x9f\x98\x80"
+};
+
+static const char *settings[] = {
+  "align:start", "align:middle", "line:10%", "line:-2", "position:50%",
+  "size:80%", "vertical:rl", "vertical:lr"
+};
+
+typedef struct
+buffer_t {
+  char *text;
+  size_t length;
+  size_t alloc;
+} buffer;
+
+static void
+append( buffer *b, const char *text, size_t length )
+{
+  if( b->length + length + 1 > b->alloc ) {
+    size_t alloc = ( b->alloc + length + 1 ) * 2;
+    char *grown = ( char * )realloc( b->text, alloc );
+    if( !grown ) {
+      fprintf( stderr, "out of memory\n" );
+      exit( 1 );
+    }
+    b->text = grown;
+    b->alloc = alloc;
+  }
+  memcpy( b->text + b->length, text, length );
+  b->length += length;
+  b->text[ b->length ] = '\0';
+}
+
+static void
+append_str( buffer *b, const char *text )
+{
+  append( b, text, strlen( text ) );
+}
+
+static void
+append_timestamp( buffer *b, unsigned long ms, int hours )
+{
+  char text[ 32 ];
+  if( hours ) {
+    sprintf( text, "%02lu:%02lu:%02lu.%03lu", ms / 3600000, ms / 60000 % 60,
+             ms / 1000 % 60, ms % 1000 );
+  } else {
+    sprintf( text, "%02lu:%02lu.%03lu", ms / 60000 % 60, ms / 1000 % 60,
+             ms % 1000 );
+  }
+  append_str( b, text );
+}
+
+static const char *tags[][ 2 ] = {
+  { "<b>", "</b>" },
+  { "<i>", "</i>" },
+  { "<u>", "</u>" },
+  { "<c.yellow.bg>", "</c>" },
+  { "<v Speaker>", "</v>" },
+  { "<lang en>", "</lang>" },
+  { "<ruby>", "<rt>r</rt></ruby>" }
+};
+
+/**
+ * Wrap 'word' in one of the kinds of cue text tag, or put a timestamp tag in
+ * front of it
+ */
+static void
+append_tagged( buffer *b, const char *word, unsigned kind, unsigned long ms )
+{
+  if( kind < sizeof tags / sizeof *tags ) {
+    append_str( b, tags[ kind ][ 0 ] );
+    append_str( b, word );
+    append_str( b, tags[ kind ][ 1 ] );
+  } else {
+    append_str( b, "<" );
+    append_timestamp( b, ms, 1 );
+    append_str( b, ">" );
+    append_str( b, word );
+  }
+}
+
+unsigned
+vttgen_random( unsigned *seed, unsigned limit )
+{
+  *seed = *seed * 1103515245u + 12345u;
+  return ( *seed >> 8 ) % ( limit ? limit : 1 );
+}
+
+void
+vttgen_defaults( vttgen_options *options )
+{
+  options->cues = 2000;
+  options->payload = 60;
+  options->tags = 10;
+  options->settings = 30;
+  options->utf8 = 5;
+  options->crlf = 0;
+  options->seed = 2013;
+}
+
+int
+vttgen_parse_args( vttgen_options *options, int argc, char **argv )
+{
+  int i;
+  for( i = 1; i < argc && argv[ i ][ 0 ] == '-'; ++i ) {
+    char s = argv[ i ][ 1 ];
+    unsigned *value = 0;
+    switch( s ) {
+      case 'n': value = &options->cues; break;
+      case 'p': value = &options->payload; break;
+      case 't': value = &options->tags; break;
+      case 's': value = &options->settings; break;
+      case 'u': value = &options->utf8; break;
+      case 'r': value = &options->seed; break;
+      case 'c': options->crlf = 1; continue;
+      default:
+        fprintf( stderr, USAGE );
+        return -1;
+    }
+    if( argv[ i ][ 2 ] ) {
+      *value = ( unsigned )atol( argv[ i ] + 2 );
+    } else if( i + 1 < argc ) {
+      *value = ( unsigned )atol( argv[ ++i ] );
+    } else {
+      fprintf( stderr, USAGE );
+      return -1;
+    }
+  }
+  return i;
+}
+
+char *
+vttgen_generate( const vttgen_options *options, size_t *length )
+{
+  const char *eol = options->crlf ? "\r\n" : "\n";
+  unsigned seed = options->seed;
+  buffer b = { 0, 0, 0 };
+  unsigned i;
+
+  append_str( &b, "WEBVTT" );
+  append_str( &b, eol );
+  append_str( &b, eol );
+
+  for( i = 0; i < options->cues; ++i ) {
+    unsigned long from = i * 2000ul;
+    size_t start, line;
+    int hours = vttgen_random( &seed, 2 );
+
+    if( vttgen_random( &seed, 2 ) ) {
+      char id[ 32 ];
+      sprintf( id, "cue-%u", i );
+      append_str( &b, id );
+      append_str( &b, eol );
+    }
+    append_timestamp( &b, from, hours );
+    append_str( &b, " --> " );
+    append_timestamp( &b, from + 1500, hours );
+    if( vttgen_random( &seed, 100 ) < options->settings ) {
+      unsigned n = 1 + vttgen_random( &seed, 4 ), j;
+      for( j = 0; j < n; ++j ) {
+        append_str( &b, " " );
+        append_str( &b, settings[ vttgen_random( &seed, sizeof settings
+                                                 / sizeof *settings ) ] );
+      }
+    }
+    append_str( &b, eol );
+
+    start = line = b.length;
+    do {
+      const char *word;
+      if( vttgen_random( &seed, 100 ) < options->utf8 ) {
+        word = utf8_words[ vttgen_random( &seed, sizeof utf8_words
+                                          / sizeof *utf8_words ) ];
+      } else {
+        word = words[ vttgen_random( &seed, sizeof words / sizeof *words ) ];
+      }
+      if( b.length > line ) {
+        if( b.length - line > 40 ) {
+          append_str( &b, eol );
+          line = b.length;
+        } else {
+          append_str( &b, " " );
+        }
+      }
+      if( vttgen_random( &seed, 100 ) < options->tags ) {
+        append_tagged( &b, word, vttgen_random( &seed, sizeof tags
+                                                / sizeof *tags + 1 ),
+                       from + 500 );
+      } else {
+        append_str( &b, word );
+      }
+    } while( b.length - start < options->payload );
+    append_str( &b, eol );
+    append_str( &b, eol );
+  }
+
+  *length = b.length;
+  return b.text;
+}
+
+double
+bench_time( bench_fn fn, void *data, double seconds )
+{
+  long calls = 0, batch = 1, i;
+  clock_t start = clock(), elapsed;
+  do {
+    for( i = 0; i < batch; ++i ) {
+      fn( data );
+    }
+    calls += batch;
+    batch *= 2;
+    elapsed = clock() - start;
+  } while( ( double )elapsed / CLOCKS_PER_SEC < seconds );
+  return ( double )elapsed / CLOCKS_PER_SEC / calls;
+}
+
+double
+bench_best( bench_fn fn, void *data, double seconds, int runs )
+{
+  double best = bench_time( fn, data, seconds ), t;
+  while( --runs > 0 ) {
+    if( ( t = bench_time( fn, data, seconds ) ) < best ) {
+      best = t;
+    }
+  }
+  return best;
+}
+
+void
+bench_report( const char *bench, const char *name, double seconds,
+              double bytes, double items, const char *unit )
+{
+  printf( "{\"bench\":\"%s\",\"case\":\"%s\",\"seconds\":%.9g", bench, name,
+          seconds );
+  if( bytes > 0 ) {
+    printf( ",\"bytes\":%.0f,\"mb_per_s\":%.2f", bytes,
+            bytes / seconds / ( 1024.0 * 1024.0 ) );
+  }
+  if( items > 0 ) {
+    printf( ",\"%s\":%.0f,\"per_s\":%.0f,\"unit\":\"%s\"", unit, items,
+            items / seconds, unit );
+  }
+  printf( "}\n" );
+  fflush( stdout );
+}
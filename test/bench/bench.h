@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __WEBVTT_BENCH_H__
+# define __WEBVTT_BENCH_H__
+# include <stddef.h>
+
+/**
+ * Shared pieces of the benchmarks: a generator of synthetic WebVTT documents,
+ * a timer, and a report in a form scripts can read.
+ */
+
+typedef struct
+vttgen_options_t {
+  /* Number of cues */
+  unsigned cues;
+  /* Rough length of each cue's text, in bytes */
+  unsigned payload;
+  /* Percentage of words wrapped in cue text tags */
+  unsigned tags;
+  /* Percentage of cues with cue settings */
+  unsigned settings;
+  /* Percentage of words which aren't ASCII */
+  unsigned utf8;
+  /* Whether lines end with CRLF rather than LF */
+  int crlf;
+  unsigned seed;
+} vttgen_options;
+
+void vttgen_defaults( vttgen_options *options );
+
+/**
+ * Read generator switches (-n cues, -p payload, -t tags, -s settings,
+ * -u utf8, -c for CRLF, -r seed) from the command line. Returns the index of
+ * the first argument which isn't one, or -1 after printing usage.
+ */
+int vttgen_parse_args( vttgen_options *options, int argc, char **argv );
+
+/**
+ * Generate a document, which the caller frees.
+ */
+char *vttgen_generate( const vttgen_options *options, size_t *length );
+
+/**
+ * Pseudo-random numbers below 'limit', the same on every platform
+ */
+unsigned vttgen_random( unsigned *seed, unsigned limit );
+
+typedef void ( *bench_fn )( void *data );
+
+/**
+ * Call 'fn' until at least 'seconds' have gone by, and return the time each
+ * call took on average.
+ */
+double bench_time( bench_fn fn, void *data, double seconds );
+
+/**
+ * Run bench_time() 'runs' times and return the shortest time, which other
+ * work on the machine can only have made longer.
+ */
+double bench_best( bench_fn fn, void *data, double seconds, int runs );
+
+/**
+ * Print a result as a line of JSON:
+ *
+ *   {"bench":"parse_chunk","case":"lf","seconds":..., "mb_per_s":...,
+ *    "per_s":..., "unit":"cues"}
+ *
+ * 'bytes' and 'items' are what one call of 'seconds' went through; either
+ * can be 0 if it doesn't apply.
+ */
+void bench_report( const char *bench, const char *name, double seconds,
+                   double bytes, double items, const char *unit );
+
+#endif
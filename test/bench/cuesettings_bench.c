@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Time webvtt_cue_set_settings() over a few typical cue setting lines, and
+ * report what each costs per cue.
+ *
+ * usage: cuesettings_bench
+ */
+
+#include "bench.h"
+#include <webvtt/cue.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *settings[] = {
+  "",
+  "align:start",
+  "line:0 position:50% size:100%",
+  "vertical:rl line:-1 align:end",
+  "line:10% position:20% size:80% align:left vertical:lr",
+  "position:abc foo:bar line:5%%",
+};
+
+typedef struct
+settings_run_t {
+  webvtt_cue *cue;
+  webvtt_string text;
+} settings_run;
+
+static void
+set_settings( void *data )
+{
+  settings_run *run = ( settings_run * )data;
+  webvtt_cue_set_settings( run->cue, &run->text );
+}
+
+int
+main( void )
+{
+  unsigned n;
+
+  for( n = 0; n < sizeof( settings ) / sizeof( *settings ); ++n ) {
+    settings_run run;
+    double seconds;
+
+    if( webvtt_create_cue( &run.cue ) != WEBVTT_SUCCESS ||
+        webvtt_create_string_with_text( &run.text, settings[ n ], -1 )
+          != WEBVTT_SUCCESS ) {
+      fprintf( stderr, "out of memory\n" );
+      return 1;
+    }
+
+    seconds = bench_time( &set_settings, &run, 0.1 );
+    bench_report( "cue_settings", settings[ n ], seconds,
+                  ( double )webvtt_string_length( &run.text ), 1, "cues" );
+    webvtt_release_string( &run.text );
+    webvtt_release_cue( &run.cue );
+  }
+
+  return 0;
+}
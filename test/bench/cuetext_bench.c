@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Time webvtt_parse_cuetext() over the text of generated cues, with more or
+ * fewer tags in it, and report MB/s and cues/s.
+ *
+ * usage: cuetext_bench [generator switches]
+ */
+
+#include "bench.h"
+#include <webvtt/parser.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "cuetext_internal.h"
+
+typedef struct
+cuetext_run_t {
+  webvtt_cue **cues;
+  size_t count;
+  size_t alloc;
+  double bytes;
+} cuetext_run;
+
+static void WEBVTT_CALLBACK
+keep_cue( void *userdata, webvtt_cue *cue )
+{
+  cuetext_run *run = ( cuetext_run * )userdata;
+  if( run->count == run->alloc ) {
+    run->alloc = run->alloc ? run->alloc * 2 : 256;
+    if( !( run->cues = ( webvtt_cue ** )realloc( run->cues, run->alloc
+                                                 * sizeof *run->cues ) ) ) {
+      fprintf( stderr, "out of memory\n" );
+      exit( 1 );
+    }
+  }
+  run->cues[ run->count++ ] = cue;
+  run->bytes += webvtt_string_length( &cue->body );
+}
+
+static int WEBVTT_CALLBACK
+ignore_error( void *userdata, webvtt_uint line, webvtt_uint col,
+              webvtt_error error )
+{
+  ( void )userdata;
+  ( void )line;
+  ( void )col;
+  ( void )error;
+  return 0;
+}
+
+static void
+parse_cuetext( void *data )
+{
+  cuetext_run *run = ( cuetext_run * )data;
+  size_t i;
+  for( i = 0; i < run->count; ++i ) {
+    webvtt_cue *cue = run->cues[ i ];
+    webvtt_parse_cuetext( 0, cue, &cue->body, 1 );
+    webvtt_release_node( &cue->node_head );
+  }
+}
+
+static void
+measure( const char *name, const vttgen_options *options )
+{
+  cuetext_run run = { 0, 0, 0, 0 };
+  webvtt_parser parser;
+  size_t length, i;
+  double seconds;
+  char *text = vttgen_generate( options, &length );
+
+  /* Only the cue text is wanted, so the parser doesn't parse it itself */
+  if( webvtt_create_parser( &keep_cue, &ignore_error, &run, &parser )
+      != WEBVTT_SUCCESS ) {
+    fprintf( stderr, "failed to create parser\n" );
+    exit( 1 );
+  }
+  webvtt_set_parser_options( parser, WEBVTT_PARSE_LAZY_CUETEXT );
+  webvtt_parse_chunk( parser, text, ( webvtt_uint )length );
+  webvtt_finish_parsing( parser );
+  webvtt_delete_parser( parser );
+  free( text );
+
+  seconds = bench_time( &parse_cuetext, &run, 0.25 );
+  bench_report( "parse_cuetext", name, seconds, run.bytes,
+                ( double )run.count, "cues" );
+  for( i = 0; i < run.count; ++i ) {
+    webvtt_release_cue( &run.cues[ i ] );
+  }
+  free( run.cues );
+}
+
+int
+main( int argc, char **argv )
+{
+  vttgen_options options;
+  int i;
+
+  vttgen_defaults( &options );
+  if( ( i = vttgen_parse_args( &options, argc, argv ) ) < 0 ) {
+    return 1;
+  }
+
+  if( i > 1 ) {
+    measure( "custom", &options );
+    return 0;
+  }
+
+  options.tags = 0;
+  measure( "plain", &options );
+  options.tags = 10;
+  measure( "default", &options );
+  options.tags = 60;
+  measure( "tags", &options );
+  options.utf8 = 50;
+  measure( "tags+utf8", &options );
+  return 0;
+}
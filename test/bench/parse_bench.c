@@ -0,0 +1,185 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Time webvtt_parse_chunk() over generated documents, fed in chunks of a
+ * given size or all at once, and report MB/s and cues/s.
+ *
+ * usage: parse_bench [generator switches] [chunk size]
+ *
+ * With no generator switches, a few kinds of document of PARITY_CUES cues are
+ * measured in turn, each of them whole and in PARITY_CHUNK byte chunks, as a
+ * network or a stream would deliver it. Each rate is the best of RUNS runs.
+ * A "parse_parity" line gives the ratio of the two rates, which should stay
+ * close to 1; if it is below PARITY_MIN for any document, the line says so
+ * and parse_bench exits with 1 after measuring the rest.
+ */
+
+#include "bench.h"
+#include <webvtt/parser.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PARITY_CHUNK 64
+#define PARITY_CUES 20000
+#define PARITY_MIN 0.75
+#define RUNS 5
+
+typedef struct
+parse_run_t {
+  const char *text;
+  size_t length;
+  size_t chunk;
+  unsigned long cues;
+} parse_run;
+
+static void WEBVTT_CALLBACK
+count_cue( void *userdata, webvtt_cue *cue )
+{
+  ++( ( parse_run * )userdata )->cues;
+  webvtt_release_cue( &cue );
+}
+
+static int WEBVTT_CALLBACK
+ignore_error( void *userdata, webvtt_uint line, webvtt_uint col,
+              webvtt_error error )
+{
+  ( void )userdata;
+  ( void )line;
+  ( void )col;
+  ( void )error;
+  return 0;
+}
+
+static void
+parse( void *data )
+{
+  parse_run *run = ( parse_run * )data;
+  webvtt_parser parser;
+  size_t pos;
+  run->cues = 0;
+  if( webvtt_create_parser( &count_cue, &ignore_error, run, &parser )
+      != WEBVTT_SUCCESS ) {
+    fprintf( stderr, "failed to create parser\n" );
+    exit( 1 );
+  }
+  for( pos = 0; pos < run->length; pos += run->chunk ) {
+    size_t n = run->length - pos < run->chunk ? run->length - pos
+                                              : run->chunk;
+    webvtt_parse_chunk( parser, run->text + pos, ( webvtt_uint )n );
+  }
+  webvtt_finish_parsing( parser );
+  webvtt_delete_parser( parser );
+}
+
+/**
+ * Returns the rate in MB/s
+ */
+static double
+measure( const char *name, const vttgen_options *options, size_t chunk )
+{
+  parse_run run;
+  char label[ 64 ];
+  double seconds;
+  char *text = vttgen_generate( options, &run.length );
+  run.text = text;
+  run.chunk = chunk ? chunk : run.length;
+  seconds = bench_best( &parse, &run, 0.1, RUNS );
+  if( chunk ) {
+    sprintf( label, "%s/%lu", name, ( unsigned long )chunk );
+  } else {
+    sprintf( label, "%s", name );
+  }
+  bench_report( "parse_chunk", label, seconds, ( double )run.length,
+                ( double )run.cues, "cues" );
+  free( text );
+  return ( double )run.length / seconds / ( 1024.0 * 1024.0 );
+}
+
+/**
+ * Measure one kind of document in 'chunk' byte chunks, or when no chunk size
+ * was asked for, both whole and in PARITY_CHUNK byte chunks. Returns 0 if
+ * parsing it in chunks is more than PARITY_MIN times slower.
+ */
+static int
+compare( const char *name, const vttgen_options *options, size_t chunk )
+{
+  double whole, chunked;
+  int ok;
+  if( chunk ) {
+    measure( name, options, chunk );
+    return 1;
+  }
+  whole = measure( name, options, 0 );
+  chunked = measure( name, options, PARITY_CHUNK );
+  ok = chunked / whole >= PARITY_MIN;
+  printf( "{\"bench\":\"parse_parity\",\"case\":\"%s\",\"chunk\":%d,"
+          "\"whole_mb_per_s\":%.2f,\"chunked_mb_per_s\":%.2f,"
+          "\"ratio\":%.3f,\"min_ratio\":%.2f,\"ok\":%s}\n", name,
+          PARITY_CHUNK, whole, chunked, chunked / whole, PARITY_MIN,
+          ok ? "true" : "false" );
+  fflush( stdout );
+  return ok;
+}
+
+int
+main( int argc, char **argv )
+{
+  vttgen_options options;
+  size_t chunk = 0;
+  int i, ok = 1;
+
+  vttgen_defaults( &options );
+  if( ( i = vttgen_parse_args( &options, argc, argv ) ) < 0 ) {
+    return 1;
+  }
+  if( i < argc ) {
+    chunk = ( size_t )atol( argv[ i ] );
+  }
+
+  if( i > 1 ) {
+    measure( "custom", &options, chunk );
+    return 0;
+  }
+
+  options.cues = PARITY_CUES;
+  ok &= compare( "default", &options, chunk );
+  options.crlf = 1;
+  ok &= compare( "crlf", &options, chunk );
+  options.crlf = 0;
+  options.tags = options.settings = options.utf8 = 0;
+  ok &= compare( "plain", &options, chunk );
+  options.tags = 60;
+  ok &= compare( "tags", &options, chunk );
+  options.tags = 0;
+  options.settings = 100;
+  ok &= compare( "settings", &options, chunk );
+  options.settings = 0;
+  options.utf8 = 50;
+  ok &= compare( "utf8", &options, chunk );
+  return ok ? 0 : 1;
+}
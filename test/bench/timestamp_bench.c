@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) 2013 Mozilla Foundation and Contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Time reading timestamps, one at a time with webvtt_parse_timestamp() and
+ * in batches with webvtt_parse_timestamps(), and report timestamps/s.
+ *
+ * usage: timestamp_bench [count]
+ */
+
+#include "bench.h"
+#include <webvtt/parser.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parser_internal.h"
+
+typedef struct
+timestamp_run_t {
+  const char **texts;
+  webvtt_uint *lengths;
+  webvtt_uint count;
+  webvtt_timestamp *out;
+  double bytes;
+} timestamp_run;
+
+static void
+parse_each( void *data )
+{
+  timestamp_run *run = ( timestamp_run * )data;
+  webvtt_uint i;
+  int length;
+  for( i = 0; i < run->count; ++i ) {
+    webvtt_parse_timestamp( run->texts[ i ], run->lengths[ i ], &length,
+                            run->out + i );
+  }
+}
+
+static void
+parse_batch( void *data )
+{
+  timestamp_run *run = ( timestamp_run * )data;
+  webvtt_parse_timestamps( run->texts, run->count, run->out );
+}
+
+/**
+ * Make 'count' timestamps of the given kind: 0 for "HH:MM:SS.mmm", 1 for
+ * "MM:SS.mmm", 2 for a mix of those and malformed ones.
+ */
+static void
+measure( const char *name, int kind, webvtt_uint count )
+{
+  timestamp_run run;
+  char *storage = ( char * )malloc( count * 16 );
+  unsigned seed = 2013;
+  webvtt_uint i;
+  double seconds;
+
+  run.texts = ( const char ** )malloc( count * sizeof *run.texts );
+  run.lengths = ( webvtt_uint * )malloc( count * sizeof *run.lengths );
+  run.out = ( webvtt_timestamp * )malloc( count * sizeof *run.out );
+  run.count = count;
+  run.bytes = 0;
+  if( !storage || !run.texts || !run.lengths || !run.out ) {
+    fprintf( stderr, "out of memory\n" );
+    exit( 1 );
+  }
+
+  for( i = 0; i < count; ++i ) {
+    char *text = storage + i * 16;
+    unsigned long ms = vttgen_random( &seed, 360000000 );
+    int form = kind < 2 ? kind : ( int )vttgen_random( &seed, 4 );
+    switch( form ) {
+      case 0:
+        sprintf( text, "%02lu:%02lu:%02lu.%03lu", ms / 3600000,
+                 ms / 60000 % 60, ms / 1000 % 60, ms % 1000 );
+        break;
+      case 1:
+        sprintf( text, "%02lu:%02lu.%03lu", ms / 60000 % 60, ms / 1000 % 60,
+                 ms % 1000 );
+        break;
+      case 2:
+        sprintf( text, "%lu:%lu:%lu.%lu", ms / 3600000, ms / 60000 % 60,
+                 ms / 1000 % 60, ms % 10 );
+        break;
+      default:
+        sprintf( text, "%02lu:%02lu-%03lu", ms / 60000 % 60, ms / 1000 % 60,
+                 ms % 1000 );
+        break;
+    }
+    run.texts[ i ] = text;
+    run.lengths[ i ] = ( webvtt_uint )strlen( text );
+    run.bytes += run.lengths[ i ];
+  }
+
+  seconds = bench_time( &parse_each, &run, 0.25 );
+  bench_report( "parse_timestamp", name, seconds, run.bytes, count,
+                "timestamps" );
+  seconds = bench_time( &parse_batch, &run, 0.25 );
+  bench_report( "parse_timestamps", name, seconds, run.bytes, count,
+                "timestamps" );
+
+  free( run.out );
+  free( run.lengths );
+  free( ( void * )run.texts );
+  free( storage );
+}
+
+int
+main( int argc, char **argv )
+{
+  long count = 10000;
+  if( argc > 1 && ( count = atol( argv[ 1 ] ) ) <= 0 ) {
+    fprintf( stderr, "usage: %s [count]\n", argv[ 0 ] );
+    return 1;
+  }
+
+  measure( "canonical", 0, ( webvtt_uint )count );
+  measure( "short", 1, ( webvtt_uint )count );
+  measure( "mixed", 2, ( webvtt_uint )count );
+  return 0;
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <webvtt/parser.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "counting_allocator"
+
+/**
+ * Counts the blocks handed out by the global allocator, to check what an arena
+ * parser still allocates globally.
+ */
+static AllocationCounter global_blocks;
+
+struct ParsedCue
+{
+  std::string id;
+  std::string body;
+  webvtt_timestamp from;
+  webvtt_timestamp until;
+};
+
+class Arena : public ::testing::Test
+{
+public:
+  static void SetUpTestCase()
+  {
+    webvtt_set_allocator( &counting_alloc, &counting_free, &global_blocks );
+  }
+
+  static void TearDownTestCase()
+  {
+    webvtt_set_allocator( 0, 0, 0 );
+  }
+
+  static void WEBVTT_CALLBACK read( void *userdata, webvtt_cue *cue )
+  {
+    Arena *self = reinterpret_cast<Arena *>( userdata );
+    ParsedCue parsed;
+    parsed.id = webvtt_string_text( &cue->id );
+    parsed.body = webvtt_string_text( &cue->body );
+    parsed.from = cue->from;
+    parsed.until = cue->until;
+    self->cues.push_back( parsed );
+    if( self->releaseCues ) {
+      webvtt_release_cue( &cue );
+    }
+  }
+
+  static int WEBVTT_CALLBACK error( void *, webvtt_uint, webvtt_uint,
+                                    webvtt_error )
+  {
+    return 0;
+  }
+
+  std::string document( int count )
+  {
+    std::ostringstream out;
+    out << "WEBVTT\n\n";
+    for( int i = 0; i < count; ++i ) {
+      out << "cue" << i << "\n00:00:" << ( 10 + i % 50 ) << ".000 --> 00:01:"
+          << ( 10 + i % 50 ) << ".500 align:start\n<v Speaker>Line <b>" << i
+          << "</b></v>\nsecond &amp; line\n\n";
+    }
+    return out.str();
+  }
+
+  void parse( webvtt_parser parser, const std::string &text, size_t chunk )
+  {
+    for( size_t pos = 0; pos < text.size(); pos += chunk ) {
+      size_t n = text.size() - pos < chunk ? text.size() - pos : chunk;
+      ASSERT_EQ( WEBVTT_SUCCESS, webvtt_parse_chunk( parser,
+                                                     text.data() + pos, n ) );
+    }
+    webvtt_finish_parsing( parser );
+  }
+
+  Arena() : releaseCues( true ) {}
+
+  std::vector<ParsedCue> cues;
+  bool releaseCues;
+};
+
+/**
+ * An arena parser produces the same cues as one using the global allocator
+ */
+TEST_F(Arena, SameCues)
+{
+  std::string text = document( 50 );
+  webvtt_parser parser;
+  std::vector<ParsedCue> expected;
+
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( &read, &error, this,
+                                                   &parser ) );
+  parse( parser, text, 100 );
+  webvtt_delete_parser( parser );
+  expected.swap( cues );
+
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser_with_arena( &read, &error,
+                                                              this, 0x400,
+                                                              &parser ) );
+  parse( parser, text, 100 );
+  webvtt_delete_parser( parser );
+
+  ASSERT_EQ( expected.size(), cues.size() );
+  for( size_t i = 0; i < cues.size(); ++i ) {
+    EXPECT_EQ( expected[ i ].id, cues[ i ].id );
+    EXPECT_EQ( expected[ i ].body, cues[ i ].body );
+    EXPECT_EQ( expected[ i ].from, cues[ i ].from );
+    EXPECT_EQ( expected[ i ].until, cues[ i ].until );
+  }
+}
+
+/**
+ * Cues which are never released individually are freed along with the parser,
+ * and only whole slabs come from the global allocator.
+ */
+TEST_F(Arena, ReleasedWithParser)
+{
+  std::string text = document( 200 );
+  webvtt_parser parser;
+  int live = global_blocks.live;
+  int total = global_blocks.total;
+  releaseCues = false;
+
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser_with_arena( &read, &error,
+                                                              this, 0,
+                                                              &parser ) );
+  parse( parser, text, 0x1000 );
+  EXPECT_EQ( 200, cues.size() );
+  EXPECT_GT( 100, global_blocks.total - total );
+  webvtt_delete_parser( parser );
+  EXPECT_EQ( live, global_blocks.live );
+}
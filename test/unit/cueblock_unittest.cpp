@@ -0,0 +1,184 @@
+#include "cuedocument_testfixture"
+#include <webvttxx/abstract_parser>
+
+/**
+ * Cues delivered in blocks have to be the same cues, in the same order, as
+ * those delivered one at a time.
+ */
+class CueBlocks : public CueDocumentTest
+{
+public:
+  virtual void SetUp() {
+    makeDocument( 10 );
+  }
+
+  virtual void TearDown() {
+    for( size_t i = 0; i < cues.size(); ++i ) {
+      webvtt_release_cue( &cues[ i ] );
+    }
+  }
+
+  static void WEBVTT_CALLBACK read( void *userdata, webvtt_cue *cue ) {
+    CueBlocks *self = static_cast<CueBlocks *>( userdata );
+    self->cues.push_back( cue );
+    self->blocks.push_back( 0 );
+  }
+
+  static void WEBVTT_CALLBACK readBlock( void *userdata, webvtt_cue **cues,
+                                         webvtt_uint count ) {
+    CueBlocks *self = static_cast<CueBlocks *>( userdata );
+    self->cues.insert( self->cues.end(), cues, cues + count );
+    self->blocks.push_back( count );
+  }
+
+  std::string cueId( size_t i ) {
+    return webvtt_string_text( &cues[ i ]->id );
+  }
+
+protected:
+  std::vector<webvtt_cue *> cues;
+  std::vector<webvtt_uint> blocks;
+};
+
+TEST_F(CueBlocks, FullBlocks)
+{
+  webvtt_parser parser;
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( &read, &countError, this,
+                                                   &parser ) );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_set_parser_cues_fn( parser, &readBlock,
+                                                        4 ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parse_chunk( parser, document.data(),
+                                                 document.size() ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_finish_parsing( parser ) );
+  webvtt_delete_parser( parser );
+
+  ASSERT_EQ( 10u, cues.size() );
+  for( size_t i = 0; i < cues.size(); ++i ) {
+    char id[ 16 ];
+    snprintf( id, sizeof id, "%u", ( unsigned )i );
+    EXPECT_EQ( id, cueId( i ) );
+  }
+  /* Whatever is left over is delivered before the chunk is done with */
+  ASSERT_EQ( 3u, blocks.size() );
+  EXPECT_EQ( 4u, blocks[ 0 ] );
+  EXPECT_EQ( 4u, blocks[ 1 ] );
+  EXPECT_EQ( 2u, blocks[ 2 ] );
+}
+
+TEST_F(CueBlocks, NotHeldBackPastChunk)
+{
+  webvtt_parser parser;
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( &read, &countError, this,
+                                                   &parser ) );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_set_parser_cues_fn( parser, &readBlock,
+                                                        100 ) );
+  for( size_t i = 0; i < document.size(); ++i ) {
+    size_t before = cues.size();
+    EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parse_chunk( parser, &document[ i ],
+                                                   1 ) );
+    EXPECT_GE( 1u, cues.size() - before );
+  }
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_finish_parsing( parser ) );
+  webvtt_delete_parser( parser );
+  EXPECT_EQ( 10u, cues.size() );
+  EXPECT_EQ( cues.size(), blocks.size() );
+}
+
+TEST_F(CueBlocks, SwitchBack)
+{
+  webvtt_parser parser;
+  size_t half = document.size() / 2;
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( &read, &countError, this,
+                                                   &parser ) );
+  EXPECT_EQ( WEBVTT_INVALID_PARAM, webvtt_set_parser_cues_fn( parser,
+                                                              &readBlock,
+                                                              0 ) );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_set_parser_cues_fn( parser, &readBlock,
+                                                        100 ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parse_chunk( parser, document.data(),
+                                                 half ) );
+  ASSERT_EQ( 1u, blocks.size() );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_set_parser_cues_fn( parser, 0, 0 ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parse_chunk( parser,
+                                                 document.data() + half,
+                                                 document.size() - half ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_finish_parsing( parser ) );
+  webvtt_delete_parser( parser );
+  EXPECT_EQ( 10u, cues.size() );
+  EXPECT_EQ( 11u - blocks[ 0 ], blocks.size() );
+}
+
+TEST_F(CueBlocks, ArenaParser)
+{
+  webvtt_parser parser;
+  ASSERT_EQ( WEBVTT_SUCCESS,
+             webvtt_create_parser_with_arena( &read, &countError, this, 0,
+                                              &parser ) );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_set_parser_cues_fn( parser, &readBlock,
+                                                        3 ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parse_chunk( parser, document.data(),
+                                                 document.size() ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_finish_parsing( parser ) );
+  EXPECT_EQ( 10u, cues.size() );
+  EXPECT_EQ( 4u, blocks.size() );
+  /* The cues belong to the arena */
+  cues.clear();
+  webvtt_delete_parser( parser );
+}
+
+/**
+ * A parser which can be asked for blocks, and which counts what it is given
+ */
+class BlockParser : public WebVTT::AbstractParser
+{
+public:
+  BlockParser( webvtt_uint size, bool overrideBlocks )
+    : overrideBlocks( overrideBlocks ), cueCount( 0 ) {
+    setCueBlockSize( size );
+  }
+
+  WebVTT::uint parse( const std::string &text ) {
+    parseChunk( text.data(), text.size() );
+    finishParsing();
+    return cueCount;
+  }
+
+  virtual bool reportError( const WebVTT::Error & ) {
+    return true;
+  }
+
+  virtual void parsedCue( WebVTT::Cue &cue ) {
+    ids.push_back( cue.id().utf8() );
+    ++cueCount;
+  }
+
+  virtual void parsedCues( const WebVTT::Cue *cues, size_t count ) {
+    if( !overrideBlocks ) {
+      AbstractParser::parsedCues( cues, count );
+      return;
+    }
+    sizes.push_back( count );
+    for( size_t i = 0; i < count; ++i ) {
+      ids.push_back( cues[ i ].id().utf8() );
+    }
+    cueCount += count;
+  }
+
+  bool overrideBlocks;
+  WebVTT::uint cueCount;
+  std::vector<std::string> ids;
+  std::vector<size_t> sizes;
+};
+
+TEST_F(CueBlocks, AbstractParserBlocks)
+{
+  BlockParser single( 0, true ), blocked( 4, true ), forwarded( 4, false );
+  EXPECT_EQ( 10u, single.parse( document ) );
+  EXPECT_EQ( 10u, blocked.parse( document ) );
+  EXPECT_EQ( 10u, forwarded.parse( document ) );
+  EXPECT_TRUE( single.sizes.empty() );
+  ASSERT_EQ( 3u, blocked.sizes.size() );
+  EXPECT_EQ( 2u, blocked.sizes[ 2 ] );
+  EXPECT_EQ( single.ids, blocked.ids );
+  EXPECT_EQ( single.ids, forwarded.ids );
+}
@@ -0,0 +1,174 @@
+#include "cuetexttokenizer_fixture"
+
+/**
+ * webvtt_cuetext_tokenizer() reads tokens into the buffers of a context, which
+ * it reuses from one token to the next unless a token (or node) still shares
+ * them.
+ */
+class CueTextTokenizer : public CueTextTokenizerTest
+{
+  public:
+    virtual void SetUp() {
+      CueTextTokenizerTest::SetUp();
+      webvtt_init_cuetext_context( &context );
+      memset( &token, 0, sizeof( token ) );
+    }
+
+    virtual void TearDown() {
+      webvtt_clear_token( &token );
+      webvtt_release_cuetext_context( &context );
+      CueTextTokenizerTest::TearDown();
+    }
+
+    void next() {
+      webvtt_clear_token( &token );
+      current_status = webvtt_cuetext_tokenizer( &pos, &context, &token );
+    }
+
+    void tokenize( const char *text ) {
+      pos = start = text;
+    }
+
+  protected:
+    webvtt_cuetext_context context;
+    webvtt_cuetext_token token;
+};
+
+/*
+ * Tests that tag names are read into the same buffer for every tag.
+ */
+TEST_F(CueTextTokenizer, ReusesTagBuffers)
+{
+  webvtt_string_data *buffer;
+
+  tokenize( "<b><i></i></b>" );
+  next();
+  ASSERT_EQ( WEBVTT_SUCCESS, status() );
+  ASSERT_EQ( START_TOKEN, token.token_type );
+  EXPECT_TRUE( webvtt_string_is_equal( &token.tag_name, "b", 1 ) );
+  buffer = context.result.d;
+
+  next();
+  ASSERT_EQ( START_TOKEN, token.token_type );
+  EXPECT_TRUE( webvtt_string_is_equal( &token.tag_name, "i", 1 ) );
+  EXPECT_EQ( buffer, context.result.d );
+
+  next();
+  ASSERT_EQ( END_TOKEN, token.token_type );
+  EXPECT_TRUE( webvtt_string_is_equal( &token.tag_name, "i", 1 ) );
+  EXPECT_EQ( buffer, context.result.d );
+  EXPECT_EQ( 10u, currentCharPos() );
+}
+
+/*
+ * Tests that text which is still shared when the next token is read is left
+ * alone, and that class lists are only handed out when they have classes.
+ */
+TEST_F(CueTextTokenizer, KeepsSharedText)
+{
+  webvtt_string text;
+
+  tokenize( "Hello<c.loud>there<b>" );
+  next();
+  ASSERT_EQ( TEXT_TOKEN, token.token_type );
+  webvtt_copy_string( &text, &token.text );
+
+  next();
+  ASSERT_EQ( START_TOKEN, token.token_type );
+  ASSERT_TRUE( token.start_token_data.css_classes != 0 );
+  EXPECT_EQ( 1u, token.start_token_data.css_classes->length );
+  EXPECT_STREQ( "Hello", webvtt_string_text( &text ) );
+
+  next();
+  ASSERT_EQ( TEXT_TOKEN, token.token_type );
+  EXPECT_STREQ( "there", webvtt_string_text( &token.text ) );
+
+  next();
+  ASSERT_EQ( START_TOKEN, token.token_type );
+  EXPECT_TRUE( token.start_token_data.css_classes == 0 );
+  EXPECT_STREQ( "Hello", webvtt_string_text( &text ) );
+  webvtt_release_string( &text );
+}
+
+/*
+ * Tests that a class name which turns up again shares the string it was given
+ * the first time, including across tags.
+ */
+TEST_F(CueTextTokenizer, InternsClassNames)
+{
+  webvtt_string first;
+
+  tokenize( "<c.loud.x><c.x.loud>" );
+  next();
+  ASSERT_EQ( START_TOKEN, token.token_type );
+  ASSERT_TRUE( token.start_token_data.css_classes != 0 );
+  ASSERT_EQ( 2u, token.start_token_data.css_classes->length );
+  webvtt_copy_string( &first, token.start_token_data.css_classes->items );
+
+  next();
+  ASSERT_EQ( START_TOKEN, token.token_type );
+  ASSERT_TRUE( token.start_token_data.css_classes != 0 );
+  ASSERT_EQ( 2u, token.start_token_data.css_classes->length );
+  EXPECT_STREQ( "loud", webvtt_string_text( &first ) );
+  EXPECT_EQ( first.d, token.start_token_data.css_classes->items[ 1 ].d );
+  EXPECT_EQ( 2u, context.interned.count );
+  webvtt_release_string( &first );
+}
+
+/*
+ * Tests that voice annotations are shared, while tags which take no
+ * annotation still get an empty one.
+ */
+TEST_F(CueTextTokenizer, InternsAnnotations)
+{
+  webvtt_string first;
+
+  tokenize( "<v Esme><b x><v Esme>" );
+  next();
+  ASSERT_EQ( START_TOKEN, token.token_type );
+  webvtt_copy_string( &first, &token.start_token_data.annotations );
+  EXPECT_STREQ( "Esme", webvtt_string_text( &first ) );
+
+  next();
+  ASSERT_EQ( START_TOKEN, token.token_type );
+  EXPECT_TRUE( webvtt_string_is_empty( &token.start_token_data.annotations ) );
+
+  next();
+  ASSERT_EQ( START_TOKEN, token.token_type );
+  EXPECT_EQ( first.d, token.start_token_data.annotations.d );
+  webvtt_release_string( &first );
+}
+
+/*
+ * Tests that every tag name resolves to its kind, and that names which are
+ * only close to one don't.
+ */
+TEST_F(CueTextTokenizer, TagNameLookup)
+{
+  static const struct {
+    const char *name;
+    webvtt_node_kind kind;
+  } known[] = {
+    { "b", WEBVTT_BOLD }, { "i", WEBVTT_ITALIC }, { "u", WEBVTT_UNDERLINE },
+    { "c", WEBVTT_CLASS }, { "v", WEBVTT_VOICE }, { "ruby", WEBVTT_RUBY },
+    { "rt", WEBVTT_RUBY_TEXT }, { "lang", WEBVTT_LANG }
+  };
+  static const char *unknown[] = {
+    "", "a", "r", "rb", "tr", "rubi", "lanb", "bb", "vv", "langs", "B"
+  };
+  webvtt_node_kind kind;
+
+  for( size_t i = 0; i < sizeof( known ) / sizeof( *known ); ++i ) {
+    ASSERT_EQ( WEBVTT_SUCCESS,
+               webvtt_node_kind_from_tag_text( known[ i ].name,
+                                               strlen( known[ i ].name ),
+                                               &kind ) ) << known[ i ].name;
+    EXPECT_EQ( known[ i ].kind, kind ) << known[ i ].name;
+  }
+  for( size_t i = 0; i < sizeof( unknown ) / sizeof( *unknown ); ++i ) {
+    EXPECT_EQ( WEBVTT_INVALID_TAG_NAME,
+               webvtt_node_kind_from_tag_text( unknown[ i ],
+                                               strlen( unknown[ i ] ),
+                                               &kind ) ) << unknown[ i ];
+  }
+}
@@ -2908,3 +2908,15 @@ TEST_F(CueTimes, EndTimeStampSecondsMiddle)
   ASSERT_EQ( 0, errorCount() ) << "This file should contain no errors.";
   ASSERT_EQ( 30, getCue(0).endTime().seconds() );
 }
+
+/**
+ * Hours can have any number of digits, so zero padding which runs well past
+ * the length of any other token is still read as part of the timestamp.
+ */
+TEST_F(CueTimes, HourZeroPadded)
+{
+  loadVtt( "cue-times/from/hour-zero-padded.vtt", 1 );
+  ASSERT_EQ( 0, errorCount() ) << "This file should contain no errors.";
+  EXPECT_EQ( 3600000u, getCue( 0 ).startTime().value() );
+  EXPECT_EQ( 3601500u, getCue( 0 ).endTime().value() );
+}
@@ -1,4 +1,5 @@
 #include "cuetexttokenizer_fixture"
+#include <string>
 
 class DataStateTokenizerTest : public CueTextTokenizerTest
 {
@@ -73,3 +74,17 @@ TEST_F(DataStateTokenizerTest, NullByteFinishedToken)
   EXPECT_EQ( DATA, state() );
   EXPECT_STREQ( "Text ", parsedText() );
 }
+
+/*
+ * Tests that a run of text longer than any initial string allocation is
+ * parsed whole, and stops at the following tag.
+ */
+TEST_F(DataStateTokenizerTest, LongRunFinishedToken)
+{
+  std::string text( 5000, 'x' );
+  dataTokenize( ( text + "<b>" ).c_str() );
+  EXPECT_EQ( WEBVTT_SUCCESS, status() );
+  EXPECT_EQ( 5000, currentCharPos() );
+  EXPECT_EQ( DATA, state() );
+  EXPECT_STREQ( text.c_str(), parsedText() );
+}
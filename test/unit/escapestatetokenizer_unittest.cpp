@@ -158,3 +158,16 @@ TEST_F(EscapeStateTokenizerTest, ExtraAmpersand)
   EXPECT_EQ( DATA, state() );
   EXPECT_STREQ( "&am&", parsedText() );
 }
+
+/*
+ * Tests that a run of alphanumeric characters is added to the escape buffer
+ * whole and that the tokenizer stops on the character after it.
+ */
+TEST_F(EscapeStateTokenizerTest, AlphanumericRun)
+{
+  escapeTokenize( "abc123 Text" );
+  EXPECT_EQ( WEBVTT_UNFINISHED, status() );
+  EXPECT_EQ( 7, currentCharPos() );
+  EXPECT_EQ( DATA, state() );
+  EXPECT_STREQ( "&abc123 ", parsedText() );
+}
@@ -0,0 +1,264 @@
+#include "test_parser"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+/**
+ * Flat trees must contain exactly the nodes of the webvtt_node tree built for
+ * the same cue-text, so both are rendered to the same notation and compared.
+ */
+static std::string
+range( const webvtt_flat_tree *tree, const webvtt_text_range &r )
+{
+  return std::string( webvtt_flat_text( tree, &r ), r.length );
+}
+
+static std::string
+describeFlat( const webvtt_flat_tree *tree, webvtt_uint index )
+{
+  const webvtt_flat_node &node = tree->nodes[ index ];
+  char buffer[ 64 ];
+  std::string out;
+
+  snprintf( buffer, sizeof( buffer ), "%x", ( unsigned )node.kind );
+  out = buffer;
+  if( node.kind == WEBVTT_TEXT ) {
+    EXPECT_EQ( 0, webvtt_flat_text( tree, &node.data.text )
+                  [ node.data.text.length ] );
+    return out + "'" + range( tree, node.data.text ) + "'";
+  } else if( node.kind == WEBVTT_TIME_STAMP ) {
+    snprintf( buffer, sizeof( buffer ), "@%llu",
+              ( unsigned long long )node.data.timestamp );
+    return out + buffer;
+  }
+
+  snprintf( buffer, sizeof( buffer ), "%u:",
+            ( unsigned )node.data.tag.class_count );
+  out += std::string( "[" ) + buffer +
+         range( tree, node.data.tag.classes ) + "|" +
+         range( tree, node.data.tag.annotation ) + "|" +
+         range( tree, node.data.tag.lang ) + "](";
+
+  webvtt_flat_iterator it;
+  const webvtt_flat_node *child;
+  webvtt_uint previous = WEBVTT_NO_NODE;
+  webvtt_flat_children( tree, index, &it );
+  while( ( child = webvtt_flat_next( &it ) ) != 0 ) {
+    webvtt_uint childIndex = ( webvtt_uint )( child - tree->nodes );
+    EXPECT_EQ( index, child->parent );
+    out += describeFlat( tree, childIndex ) + " ";
+    previous = childIndex;
+  }
+  EXPECT_EQ( previous, node.last_child );
+  return out + ")";
+}
+
+static std::string
+text( const webvtt_string *s )
+{
+  return std::string( webvtt_string_text( s ), webvtt_string_length( s ) );
+}
+
+static std::string
+describeTree( const webvtt_node *node )
+{
+  char buffer[ 64 ];
+  std::string out;
+
+  snprintf( buffer, sizeof( buffer ), "%x", ( unsigned )node->kind );
+  out = buffer;
+  if( node->kind == WEBVTT_TEXT ) {
+    return out + "'" + text( &node->data.text ) + "'";
+  } else if( node->kind == WEBVTT_TIME_STAMP ) {
+    snprintf( buffer, sizeof( buffer ), "@%llu",
+              ( unsigned long long )node->data.timestamp );
+    return out + buffer;
+  }
+
+  const webvtt_internal_node_data *data = node->data.internal_data;
+  std::string classes;
+  for( webvtt_uint i = 0; data->css_classes &&
+                          i < data->css_classes->length; ++i ) {
+    classes += ( i ? "." : "" ) + text( data->css_classes->items + i );
+  }
+  snprintf( buffer, sizeof( buffer ), "%u:", data->css_classes ?
+            ( unsigned )data->css_classes->length : 0u );
+  out += std::string( "[" ) + buffer + classes + "|" +
+         text( &data->annotation ) + "|" +
+         text( &data->lang ) + "](";
+  for( webvtt_uint i = 0; i < data->length; ++i ) {
+    out += describeTree( data->children[ i ] ) + " ";
+  }
+  return out + ")";
+}
+
+class FlatTree : public ::testing::Test
+{
+public:
+  void expectSameNodes( webvtt_cue *cue, const std::string &what )
+  {
+    webvtt_node *head = 0;
+    const webvtt_flat_tree *tree = 0;
+    ASSERT_EQ( WEBVTT_SUCCESS, webvtt_cue_get_nodes( cue, &head ) ) << what;
+    ASSERT_EQ( WEBVTT_SUCCESS, webvtt_cue_get_flat_tree( cue, &tree ) )
+      << what;
+    EXPECT_EQ( describeTree( head ), describeFlat( tree, 0 ) ) << what;
+  }
+
+  void expectSameNodes( const char *body )
+  {
+    webvtt_cue *cue;
+    ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_cue( &cue ) );
+    ASSERT_EQ( WEBVTT_SUCCESS,
+               webvtt_create_string_with_text( &cue->body, body, -1 ) );
+    expectSameNodes( cue, body );
+    webvtt_release_cue( &cue );
+  }
+
+  static void WEBVTT_CALLBACK read( void *userdata, webvtt_cue *cue )
+  {
+    reinterpret_cast<std::vector<webvtt_cue *> *>( userdata )->push_back( cue );
+  }
+
+  static int WEBVTT_CALLBACK error( void *, webvtt_uint, webvtt_uint,
+                                    webvtt_error )
+  {
+    return 0;
+  }
+
+  std::string path( const std::string &relativePath )
+  {
+    return std::string( getenv( "TEST_FILE_DIR" ) ? getenv( "TEST_FILE_DIR" )
+                                                  : "." ) +
+           "/" + relativePath;
+  }
+};
+
+TEST_F(FlatTree, TrickyCueText)
+{
+  const char *bodies[] = {
+    "",
+    "plain text",
+    "&amp;&lt;&gt;&lrm;&rlm;&nbsp;",
+    "&amp",
+    "&&amp;&",
+    "&foo; &a b &; &amp&lt;",
+    "a&<b>x</b>",
+    "<c.a.b.>x</c>",
+    "<c. y>x",
+    "<c..>x",
+    "<v  Bob  Smith>hi</v>",
+    "<v.loud Bob>hi &amp; bye</v>",
+    "<lang en><i>x</i></lang><b>y</b>",
+    "<lang fr>a<lang de>b<u>c</u></lang>c</lang>d",
+    "<ruby>a<rt>b</rt></ruby><rt>c</rt>",
+    "<ruby>a<rt>b</ruby>c</ruby>d",
+    "<00:01.000>x<1:00>y<01:02:03.004 >z",
+    "<b",
+    "</b>x",
+    "<x>y</x>z<xy>",
+    "<b.>x",
+    "< b>x",
+    "<.a>x",
+    "<>x</>",
+    "<b>unclosed <i>deep",
+    "<b>x</b >y",
+    "tab\t<v\tX>y\n<i\n>z</i>",
+    "a > b < c",
+    "<b>&lt;b&gt;</b>&",
+  };
+
+  for( size_t i = 0; i < sizeof( bodies ) / sizeof( *bodies ); ++i ) {
+    expectSameNodes( bodies[ i ] );
+  }
+}
+
+/**
+ * Empty class names are still class names, so "<c.>" has one of them, while
+ * an empty annotation is no annotation at all.
+ */
+TEST_F(FlatTree, EmptyClassesAndAnnotations)
+{
+  const char *bodies[] = {
+    "<c.>x</c>",
+    "<c.>",
+    "<i.>x<b..a>y",
+    "<v.>x</v>",
+    "<v. Bob>x",
+    "<v >x</v>",
+    "<v>x",
+    "<v.a Bob >x",
+    "<v Bob & Alice &amp; co>x",
+    "<lang>x</lang>",
+    "<lang.a>x<i>y</i></lang>",
+    "<lang.>x",
+    "<lang  >x<v Bob>y",
+  };
+
+  for( size_t i = 0; i < sizeof( bodies ) / sizeof( *bodies ); ++i ) {
+    expectSameNodes( bodies[ i ] );
+  }
+}
+
+TEST_F(FlatTree, PayloadFiles)
+{
+  DIR *payload = opendir( path( "payload" ).c_str() );
+  struct dirent *category;
+  int files = 0;
+
+  ASSERT_TRUE( payload != 0 );
+  while( ( category = readdir( payload ) ) != 0 ) {
+    std::string dir = std::string( "payload/" ) + category->d_name;
+    DIR *d;
+    struct dirent *entry;
+    if( category->d_name[0] == '.' ||
+        !( d = opendir( path( dir ).c_str() ) ) ) {
+      continue;
+    }
+    while( ( entry = readdir( d ) ) != 0 ) {
+      std::string name = dir + "/" + entry->d_name;
+      std::vector<webvtt_cue *> cues;
+      webvtt_parser parser;
+      if( name.size() < 4 || name.substr( name.size() - 4 ) != ".vtt" ) {
+        continue;
+      }
+      ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( &read, &error, &cues,
+                                                       &parser ) );
+      webvtt_parse_mapped_file( parser, path( name ).c_str() );
+      webvtt_delete_parser( parser );
+      for( size_t i = 0; i < cues.size(); ++i ) {
+        expectSameNodes( cues[ i ], name );
+        webvtt_release_cue( &cues[ i ] );
+      }
+      ++files;
+    }
+    closedir( d );
+  }
+  closedir( payload );
+  EXPECT_LT( 100, files );
+}
+
+TEST_F(FlatTree, CueFlatHead)
+{
+  ItemStorageParser parser( path( "payload/lang-tag/internal-within-lang.vtt" )
+                            .c_str() );
+  parser.parse();
+  ASSERT_LT( 0u, parser.cueCount() );
+
+  const Cue &cue = parser.getCue( 0 );
+  const Node head = cue.nodeHead();
+  const FlatNode flat = cue.flatHead();
+  ASSERT_FALSE( flat.isNull() );
+  EXPECT_EQ( Node::Head, flat.kind() );
+
+  int i = 0;
+  for( FlatNode n = flat.firstChild(); !n.isNull(); n = n.nextSibling(), ++i ) {
+    ASSERT_LT( i, head.childCount() );
+    EXPECT_EQ( head[ i ].kind(), n.kind() );
+    EXPECT_EQ( flat.index(), n.parent().index() );
+    EXPECT_STREQ( head[ i ].lang().utf8(), n.lang().utf8() );
+  }
+  EXPECT_EQ( head.childCount(), i );
+}
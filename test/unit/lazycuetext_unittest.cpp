@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <webvtt/parser.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "counting_allocator"
+
+/**
+ * Counts the blocks handed out by the global allocator, to check where lazily
+ * parsed nodes are allocated from.
+ */
+static AllocationCounter global_blocks;
+
+/**
+ * Renders a node tree as a string, so that trees can be compared.
+ */
+static std::string
+describe( const webvtt_node *node )
+{
+  std::string out;
+  char kind[16];
+  if( !node ) {
+    return "null";
+  }
+  snprintf( kind, sizeof( kind ), "%x", ( unsigned )node->kind );
+  out = kind;
+  if( node->kind == WEBVTT_TEXT ) {
+    out += "'" + std::string( webvtt_string_text( &node->data.text ) ) + "'";
+  } else if( WEBVTT_IS_VALID_INTERNAL_NODE( node->kind ) ) {
+    out += "(";
+    for( webvtt_uint i = 0; i < node->data.internal_data->length; ++i ) {
+      out += describe( node->data.internal_data->children[ i ] ) + " ";
+    }
+    out += ")";
+  }
+  return out;
+}
+
+class LazyCueText : public ::testing::Test
+{
+public:
+  LazyCueText() : sawNodes( false ) {}
+
+  virtual void TearDown()
+  {
+    for( size_t i = 0; i < cues.size(); ++i ) {
+      webvtt_release_cue( &cues[ i ] );
+    }
+  }
+
+  static void WEBVTT_CALLBACK read( void *userdata, webvtt_cue *cue )
+  {
+    LazyCueText *self = reinterpret_cast<LazyCueText *>( userdata );
+    self->sawNodes = self->sawNodes || cue->node_head;
+    self->cues.push_back( cue );
+  }
+
+  static int WEBVTT_CALLBACK error( void *, webvtt_uint, webvtt_uint,
+                                    webvtt_error )
+  {
+    return 0;
+  }
+
+  void parse( webvtt_parser parser )
+  {
+    ASSERT_EQ( WEBVTT_SUCCESS, webvtt_parse_chunk( parser, document.data(),
+                                                   document.size() ) );
+    ASSERT_EQ( WEBVTT_SUCCESS, webvtt_finish_parsing( parser ) );
+  }
+
+  static const std::string document;
+  std::vector<webvtt_cue *> cues;
+  bool sawNodes;
+};
+
+const std::string LazyCueText::document =
+  "WEBVTT\n\n"
+  "00:01.000 --> 00:02.000\n"
+  "<v Roger>Hello <b>there</b> &amp; <i.loud>welcome</i></v>\n\n"
+  "00:02.000 --> 00:03.000\n"
+  "<ruby>A<rt>a</rt></ruby> <00:02.500><lang en>text</lang>\n";
+
+TEST_F(LazyCueText, MatchesEagerParsing)
+{
+  webvtt_parser parser;
+  std::vector<std::string> eager;
+
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( &read, &error, this,
+                                                   &parser ) );
+  parse( parser );
+  webvtt_delete_parser( parser );
+  ASSERT_EQ( 2u, cues.size() );
+  EXPECT_TRUE( sawNodes );
+  for( size_t i = 0; i < cues.size(); ++i ) {
+    eager.push_back( describe( cues[ i ]->node_head ) );
+    webvtt_release_cue( &cues[ i ] );
+  }
+  cues.clear();
+  sawNodes = false;
+
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( &read, &error, this,
+                                                   &parser ) );
+  ASSERT_EQ( WEBVTT_SUCCESS,
+             webvtt_set_parser_options( parser, WEBVTT_PARSE_LAZY_CUETEXT ) );
+  EXPECT_EQ( ( webvtt_uint )WEBVTT_PARSE_LAZY_CUETEXT,
+             webvtt_get_parser_options( parser ) );
+  parse( parser );
+  webvtt_delete_parser( parser );
+  ASSERT_EQ( 2u, cues.size() );
+  EXPECT_FALSE( sawNodes );
+
+  for( size_t i = 0; i < cues.size(); ++i ) {
+    webvtt_node *head = 0, *again = 0;
+    ASSERT_EQ( WEBVTT_SUCCESS, webvtt_cue_get_nodes( cues[ i ], &head ) );
+    EXPECT_EQ( eager[ i ], describe( head ) );
+    /* Only parsed once */
+    ASSERT_EQ( WEBVTT_SUCCESS, webvtt_cue_get_nodes( cues[ i ], &again ) );
+    EXPECT_EQ( head, again );
+  }
+}
+
+TEST_F(LazyCueText, UnknownOption)
+{
+  webvtt_parser parser;
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( &read, &error, this,
+                                                   &parser ) );
+  EXPECT_EQ( WEBVTT_INVALID_PARAM, webvtt_set_parser_options( parser, 0x80 ) );
+  EXPECT_EQ( 0u, webvtt_get_parser_options( parser ) );
+  webvtt_delete_parser( parser );
+}
+
+/**
+ * Nodes parsed lazily for a cue from an arena parser come from the same
+ * arena, so they go away with it.
+ */
+TEST_F(LazyCueText, NodesComeFromCueArena)
+{
+  webvtt_parser parser;
+  int baseline, blocks;
+
+  webvtt_set_allocator( &counting_alloc, &counting_free, &global_blocks );
+  baseline = global_blocks.live;
+  ASSERT_EQ( WEBVTT_SUCCESS,
+             webvtt_create_parser_with_arena( &read, &error, this, 0,
+                                              &parser ) );
+  ASSERT_EQ( WEBVTT_SUCCESS,
+             webvtt_set_parser_options( parser, WEBVTT_PARSE_LAZY_CUETEXT ) );
+  parse( parser );
+  ASSERT_EQ( 2u, cues.size() );
+
+  blocks = global_blocks.live;
+  for( size_t i = 0; i < cues.size(); ++i ) {
+    webvtt_node *head = 0;
+    ASSERT_EQ( WEBVTT_SUCCESS, webvtt_cue_get_nodes( cues[ i ], &head ) );
+    EXPECT_TRUE( head != 0 );
+  }
+  EXPECT_EQ( blocks, global_blocks.live );
+
+  cues.clear();
+  webvtt_delete_parser( parser );
+  EXPECT_EQ( baseline, global_blocks.live );
+  webvtt_set_allocator( 0, 0, 0 );
+}
@@ -0,0 +1,119 @@
+#include <webvttxx/mapped_file_parser>
+#include "test_parser"
+#include <string>
+
+/**
+ * MappedFileParser reads documents through webvtt_parse_mapped_file(), which
+ * lets cues borrow their text from the mapped document. It must produce exactly
+ * the same cues and errors as reading the document in chunks.
+ */
+class MappedStorageParser : public MappedFileParser
+{
+public:
+  MappedStorageParser( const char *fileName ) : MappedFileParser( fileName ) {}
+  virtual ~MappedStorageParser() {}
+
+  virtual bool reportError( const Error &error )
+  {
+    errors.push_back( error );
+    return true;
+  }
+
+  virtual void parsedCue( Cue &cue )
+  {
+    cues.push_back( cue );
+  }
+
+  std::vector<Cue> cues;
+  std::vector<Error> errors;
+};
+
+class MappedFile : public ::testing::Test
+{
+protected:
+  std::string path( const char *relativeFilePath )
+  {
+    return std::string( getenv("TEST_FILE_DIR") ? getenv("TEST_FILE_DIR")
+                                                : "." ) +
+           std::string( "/" ) + relativeFilePath;
+  }
+
+  void expectSameAsFileParser( const char *relativeFilePath )
+  {
+    std::string filePath = path( relativeFilePath );
+    ItemStorageParser chunked( filePath.c_str() );
+    MappedStorageParser mapped( filePath.c_str() );
+
+    EXPECT_EQ( chunked.parse(), mapped.parse() ) << relativeFilePath;
+    ASSERT_EQ( chunked.cueCount(), mapped.cues.size() ) << relativeFilePath;
+    ASSERT_EQ( chunked.errorCount(), mapped.errors.size() )
+      << relativeFilePath;
+
+    for( WebVTT::uint i = 0; i < mapped.cues.size(); ++i ) {
+      const Cue &expected = chunked.getCue( i );
+      const Cue &cue = mapped.cues[ i ];
+      EXPECT_STREQ( expected.id().utf8(), cue.id().utf8() )
+        << relativeFilePath << " cue " << i;
+      EXPECT_STREQ( expected.body().utf8(), cue.body().utf8() )
+        << relativeFilePath << " cue " << i;
+      EXPECT_EQ( expected.startTime().value(), cue.startTime().value() );
+      EXPECT_EQ( expected.endTime().value(), cue.endTime().value() );
+    }
+
+    for( WebVTT::uint i = 0; i < mapped.errors.size(); ++i ) {
+      const Error &expected = chunked.getError( i );
+      const Error &error = mapped.errors[ i ];
+      EXPECT_EQ( expected.error(), error.error() )
+        << relativeFilePath << " error " << i;
+      EXPECT_EQ( expected.line(), error.line() );
+      EXPECT_EQ( expected.column(), error.column() );
+    }
+  }
+};
+
+TEST_F(MappedFile, SameCuesAsFileParser)
+{
+  expectSameAsFileParser( "cue-ids/basic_pass.vtt" );
+  expectSameAsFileParser( "cue-ids/id_only.vtt" );
+  expectSameAsFileParser( "cue-ids/long_string.vtt" );
+  expectSameAsFileParser( "cue-ids/arrows/arrow.vtt" );
+  expectSameAsFileParser( "cue-ids/lineendings/long_string_crlf.vtt" );
+  expectSameAsFileParser( "cue-ids/lineendings/two_between_id_and_timestamp.vtt" );
+  expectSameAsFileParser( "filestructure/blank-file.vtt" );
+  expectSameAsFileParser( "filestructure/extra-newlines-after-cue.vtt" );
+  expectSameAsFileParser( "filestructure/missing_new_line_between_cues.vtt" );
+  expectSameAsFileParser( "filestructure/multi-cue-no-newline-between-cues.vtt" );
+  expectSameAsFileParser( "filestructure/newline-between-payload-text.vtt" );
+  expectSameAsFileParser( "filestructure/new_lines_at_end.vtt" );
+  expectSameAsFileParser( "payload/format/multiline-basic-cue-text-cr.vtt" );
+  expectSameAsFileParser( "payload/format/multiline-cue-text-crlf.vtt" );
+  expectSameAsFileParser( "payload/format/multiline-cue-text-extra-newline.vtt" );
+  expectSameAsFileParser( "payload/format/multiline-multiple-cue-text-tag.vtt" );
+  expectSameAsFileParser( "regressions/853589-1.vtt" );
+  expectSameAsFileParser( "regressions/863931-1.vtt" );
+}
+
+/**
+ * Cues keep the mapped document alive after the parser is gone
+ */
+TEST_F(MappedFile, CuesOutliveParser)
+{
+  std::string filePath = path( "filestructure/extra-newlines-after-cue.vtt" );
+  std::vector<Cue> cues;
+  {
+    MappedStorageParser mapped( filePath.c_str() );
+    ASSERT_TRUE( mapped.parse() );
+    cues = mapped.cues;
+  }
+  ASSERT_EQ( 1, cues.size() );
+  EXPECT_LT( 0, cues[ 0 ].body().length() );
+  EXPECT_EQ( cues[ 0 ].body().length(), strlen( cues[ 0 ].body().utf8() ) );
+}
+
+TEST_F(MappedFile, MissingFile)
+{
+  std::string filePath = path( "does-not-exist.vtt" );
+  MappedStorageParser mapped( filePath.c_str() );
+  EXPECT_FALSE( mapped.parse() );
+  EXPECT_EQ( 0, mapped.cues.size() );
+}
@@ -0,0 +1,153 @@
+#include "cuedocument_testfixture"
+#include <algorithm>
+
+/**
+ * webvtt_parser_get_stats() has to agree with what the parser handed to its
+ * callbacks, however the document is fed to it.
+ */
+class ParserStats : public CueDocumentTest
+{
+public:
+  virtual void SetUp() {
+    makeDocument( 6 );
+    document += "backwards\n00:09.000 --> 00:08.000\nnever read\n\n";
+    document += "00:09.000 -> 00:10.000\nbad arrow\n\n";
+    document += "long\n00:10.000 --> 00:11.000\n" + std::string( 4000, 'x' )
+                + "\n";
+  }
+
+  /**
+   * Parse the document 'chunk' bytes at a time
+   */
+  webvtt_parser_stats parse( webvtt_uint chunk ) {
+    webvtt_parser parser;
+    webvtt_parser_stats stats;
+    clearResults();
+    EXPECT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( &readId, &countError, this,
+                                                     &parser ) );
+    for( size_t pos = 0; pos < document.size(); pos += chunk ) {
+      webvtt_parse_chunk( parser, document.data() + pos,
+                          std::min<size_t>( chunk, document.size() - pos ) );
+    }
+    webvtt_finish_parsing( parser );
+    EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parser_get_stats( parser, &stats ) );
+    webvtt_delete_parser( parser );
+    return stats;
+  }
+};
+
+TEST_F(ParserStats, AgreeWithCallbacks)
+{
+  webvtt_parser_stats stats = parse( document.size() );
+  EXPECT_EQ( document.size(), stats.bytes );
+  EXPECT_EQ( std::count( document.begin(), document.end(), '\n' ),
+             stats.lines );
+  EXPECT_EQ( 7u, ids.size() );
+  EXPECT_EQ( ids.size(), stats.cues );
+  /* The backwards cue and the one with a bad arrow */
+  EXPECT_EQ( 2u, stats.dropped_cues );
+  webvtt_uint total = 0;
+  for( int i = 0; i < WEBVTT_ERROR_COUNT; ++i ) {
+    EXPECT_EQ( errorCounts[ i ], stats.errors[ i ] ) << i;
+    total += stats.errors[ i ];
+  }
+  EXPECT_LT( 0u, total );
+  EXPECT_LT( 1u, stats.stack_depth );
+}
+
+/**
+ * Lines are counted by their line breaks, and a CR LF pair is one of them even
+ * when a chunk ends between the two
+ */
+TEST_F(ParserStats, CountLineBreaks)
+{
+  const struct {
+    const char *text;
+    webvtt_uint lines;
+  } documents[] = {
+    { "WEBVTT", 0 },
+    { "WEBVTT\n", 1 },
+    { "WEBVTT\n\n00:01.000 --> 00:02.000\nx\n", 4 },
+    { "WEBVTT\r\n\r\n00:01.000 --> 00:02.000\r\nx", 3 },
+    { "WEBVTT\r\r\n\n00:01.000 --> 00:02.000\rx\r\n", 5 }
+  };
+  for( size_t i = 0; i < sizeof documents / sizeof *documents; ++i ) {
+    document = documents[ i ].text;
+    for( webvtt_uint chunk = 1; chunk < 4; ++chunk ) {
+      EXPECT_EQ( documents[ i ].lines, parse( chunk ).lines )
+        << i << " " << chunk;
+    }
+    EXPECT_EQ( documents[ i ].lines, parse( document.size() ).lines ) << i;
+  }
+}
+
+TEST_F(ParserStats, CountAllocations)
+{
+  webvtt_parser_stats stats = parse( document.size() );
+  EXPECT_LT( 0u, stats.allocs );
+  EXPECT_LE( stats.frees, stats.allocs );
+  EXPECT_LE( stats.live_bytes, stats.peak_bytes );
+  /* The long cue has to be collected into a growing buffer */
+  EXPECT_LT( 4000u, stats.peak_bytes );
+  EXPECT_LT( 0u, stats.string_grows );
+}
+
+TEST_F(ParserStats, SameForAnyChunkSize)
+{
+  webvtt_parser_stats whole = parse( document.size() );
+  for( webvtt_uint chunk = 1; chunk < 80; chunk += 13 ) {
+    webvtt_parser_stats stats = parse( chunk );
+    EXPECT_EQ( whole.bytes, stats.bytes ) << chunk;
+    EXPECT_EQ( whole.lines, stats.lines ) << chunk;
+    EXPECT_EQ( whole.cues, stats.cues ) << chunk;
+    EXPECT_EQ( whole.dropped_cues, stats.dropped_cues ) << chunk;
+    EXPECT_EQ( 0, memcmp( whole.errors, stats.errors,
+                          sizeof whole.errors ) ) << chunk;
+  }
+}
+
+TEST_F(ParserStats, CountOnlyWhatWasRead)
+{
+  webvtt_parser parser;
+  webvtt_parser_stats stats;
+  webvtt_cue *cue;
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( 0, &countError, this,
+                                                   &parser ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parse_chunk( parser, document.data(),
+                                                 document.size() ) );
+  /* Pulling stops reading at the first cue */
+  webvtt_parser_get_stats( parser, &stats );
+  EXPECT_EQ( 1u, stats.cues );
+  EXPECT_GT( document.size(), stats.bytes );
+
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_finish_parsing( parser ) );
+  webvtt_parser_get_stats( parser, &stats );
+  EXPECT_EQ( document.size(), stats.bytes );
+  EXPECT_EQ( 7u, stats.cues );
+  while( webvtt_parser_next_cue( parser, &cue ) == WEBVTT_SUCCESS && cue ) {
+    webvtt_release_cue( &cue );
+  }
+  webvtt_delete_parser( parser );
+}
+
+TEST_F(ParserStats, KeptApart)
+{
+  webvtt_parser first, second;
+  webvtt_parser_stats before, after;
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( &readId, &countError, this,
+                                                   &first ) );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( &readId, &countError, this,
+                                                   &second ) );
+  webvtt_parse_chunk( first, document.data(), document.size() / 2 );
+  webvtt_parser_get_stats( first, &before );
+
+  webvtt_parse_chunk( second, document.data(), document.size() );
+  webvtt_finish_parsing( second );
+  webvtt_parser_get_stats( first, &after );
+  EXPECT_EQ( 0, memcmp( &before, &after, sizeof before ) );
+
+  webvtt_finish_parsing( first );
+  webvtt_delete_parser( first );
+  webvtt_delete_parser( second );
+  EXPECT_EQ( WEBVTT_INVALID_PARAM, webvtt_parser_get_stats( 0, &before ) );
+}
@@ -0,0 +1,221 @@
+#include "cuedocument_testfixture"
+#include <sstream>
+#include <webvttxx/cue_reader>
+
+/**
+ * Cues taken from a parser with webvtt_parser_next_cue() have to be the same
+ * cues, in the same order, as those it would have handed to a callback.
+ */
+class PullCues : public CueDocumentTest
+{
+public:
+  virtual void SetUp() {
+    makeDocument( 8 );
+    document += "00:09.000 -> 00:10.000\nbad arrow\n";
+  }
+
+  /**
+   * Take every cue there is, feeding the parser 'chunk' bytes at a time
+   * whenever it asks for more
+   */
+  std::vector<std::string> pull( webvtt_uint chunk ) {
+    std::vector<std::string> pulled;
+    webvtt_parser parser;
+    webvtt_cue *cue;
+    size_t pos = 0;
+    EXPECT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( 0, &countError, this,
+                                                     &parser ) );
+    for( ;; ) {
+      webvtt_status status = webvtt_parser_next_cue( parser, &cue );
+      if( status == WEBVTT_UNFINISHED ) {
+        if( pos < document.size() ) {
+          size_t n = std::min<size_t>( chunk, document.size() - pos );
+          EXPECT_EQ( WEBVTT_SUCCESS,
+                     webvtt_parse_chunk( parser, document.data() + pos, n ) );
+          pos += n;
+        } else {
+          EXPECT_EQ( WEBVTT_SUCCESS, webvtt_finish_parsing( parser ) );
+        }
+        continue;
+      }
+      EXPECT_EQ( WEBVTT_SUCCESS, status );
+      if( !cue ) {
+        break;
+      }
+      pulled.push_back( webvtt_string_text( &cue->id ) );
+      webvtt_release_cue( &cue );
+    }
+    webvtt_delete_parser( parser );
+    return pulled;
+  }
+};
+
+TEST_F(PullCues, SameAsPushed)
+{
+  webvtt_parser parser;
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( &readId, &countError, this,
+                                                   &parser ) );
+  webvtt_parse_chunk( parser, document.data(), document.size() );
+  webvtt_finish_parsing( parser );
+  webvtt_delete_parser( parser );
+  ASSERT_EQ( 8u, ids.size() );
+
+  for( webvtt_uint chunk = 1; chunk < 20; ++chunk ) {
+    EXPECT_EQ( ids, pull( chunk ) ) << chunk;
+  }
+  EXPECT_EQ( ids, pull( document.size() ) );
+}
+
+TEST_F(PullCues, ReadsOnlyAsCuesAreTaken)
+{
+  webvtt_parser parser;
+  webvtt_cue *cue;
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( 0, &countError, this,
+                                                   &parser ) );
+  EXPECT_EQ( WEBVTT_UNFINISHED, webvtt_parser_next_cue( parser, &cue ) );
+  EXPECT_EQ( 0, cue );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parse_chunk( parser, document.data(),
+                                                 document.size() ) );
+  /* The rest of the chunk has to be read before another is given */
+  EXPECT_EQ( WEBVTT_INVALID_PARAM, webvtt_parse_chunk( parser, "\n", 1 ) );
+
+  for( int i = 0; i < 8; ++i ) {
+    /* The bad cue at the end hasn't been read yet */
+    EXPECT_EQ( 0, errors );
+    ASSERT_EQ( WEBVTT_SUCCESS, webvtt_parser_next_cue( parser, &cue ) );
+    ASSERT_TRUE( cue != 0 );
+    webvtt_release_cue( &cue );
+  }
+  EXPECT_EQ( WEBVTT_UNFINISHED, webvtt_parser_next_cue( parser, &cue ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_finish_parsing( parser ) );
+  EXPECT_LT( 0, errors );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parser_next_cue( parser, &cue ) );
+  EXPECT_EQ( 0, cue );
+  webvtt_delete_parser( parser );
+}
+
+TEST_F(PullCues, FinishReadsTheRest)
+{
+  webvtt_parser parser;
+  webvtt_cue *cue;
+  int count = 0;
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( 0, &countError, this,
+                                                   &parser ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parse_chunk( parser, document.data(),
+                                                 document.size() ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_finish_parsing( parser ) );
+  EXPECT_LT( 0, errors );
+  while( webvtt_parser_next_cue( parser, &cue ) == WEBVTT_SUCCESS && cue ) {
+    webvtt_release_cue( &cue );
+    ++count;
+  }
+  EXPECT_EQ( 8, count );
+  webvtt_delete_parser( parser );
+
+  /* Cues which are never taken are released with the parser */
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( 0, &countError, this,
+                                                   &parser ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parse_chunk( parser, document.data(),
+                                                 document.size() ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_finish_parsing( parser ) );
+  webvtt_delete_parser( parser );
+}
+
+TEST_F(PullCues, PushParserHasNoCuesToTake)
+{
+  webvtt_parser parser;
+  webvtt_cue *cue;
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( &readId, &countError, this,
+                                                   &parser ) );
+  EXPECT_EQ( WEBVTT_INVALID_PARAM, webvtt_parser_next_cue( parser, &cue ) );
+  webvtt_delete_parser( parser );
+}
+
+/**
+ * Stops at the first error
+ */
+class StrictReader : public WebVTT::CueReader
+{
+public:
+  StrictReader( std::istream &source ) : CueReader( source, 7 ) {}
+  virtual bool reportError( const WebVTT::Error & ) {
+    return false;
+  }
+};
+
+TEST_F(PullCues, CueReader)
+{
+  std::istringstream stream( document );
+  WebVTT::CueReader reader( stream, 5 );
+  std::vector<std::string> ids;
+  for( WebVTT::CueReader::iterator it = reader.begin(); it != reader.end();
+       ++it ) {
+    ids.push_back( it->id().utf8() );
+  }
+  EXPECT_EQ( WEBVTT_SUCCESS, reader.status() );
+  ASSERT_EQ( 8u, ids.size() );
+  EXPECT_EQ( "0", ids[ 0 ] );
+  EXPECT_EQ( "7", ids[ 7 ] );
+
+  std::istringstream strictStream( document );
+  StrictReader strict( strictStream );
+  size_t count = 0;
+  for( WebVTT::CueReader::iterator it = strict.begin(); it != strict.end();
+       ++it ) {
+    ++count;
+  }
+  EXPECT_EQ( 8u, count );
+  EXPECT_TRUE( WEBVTT_FAILED( strict.status() ) );
+}
+
+/**
+ * A cue which is skipped leaves the parser asking for more input at the end
+ * of a chunk, which must not stop the reader.
+ */
+TEST_F(PullCues, CueReaderSkipsInvalidCueAcrossChunks)
+{
+  const std::string skipping( "WEBVTT\n\n"
+                              "00:01.000 --> 00:02.000\na\n\n"
+                              "00:0x.000 --> 00:03.000\n"
+                              "skipped text which is long enough to span "
+                              "chunks\n\n"
+                              "00:04.000 --> 00:05.000\nb\n\n"
+                              "00:06.000 --> 00:07.000\nc\n" );
+  const webvtt_uint chunks[] = { 1, 7, 16, 64, 4096 };
+  for( size_t i = 0; i < sizeof chunks / sizeof *chunks; ++i ) {
+    std::istringstream stream( skipping );
+    WebVTT::CueReader reader( stream, chunks[ i ] );
+    size_t count = 0;
+    for( WebVTT::CueReader::iterator it = reader.begin(); it != reader.end();
+         ++it ) {
+      ++count;
+    }
+    EXPECT_EQ( 3u, count ) << chunks[ i ];
+    EXPECT_EQ( WEBVTT_SUCCESS, reader.status() ) << chunks[ i ];
+  }
+}
+
+/**
+ * Finishing has to end the document even when the rest of the last chunk
+ * ends inside a cue which is being skipped.
+ */
+TEST_F(PullCues, FinishEndsInSkippedCue)
+{
+  const std::string skipping( "WEBVTT\n\n"
+                              "00:01.000 --> 00:02.000\na\n\n"
+                              "00:0x.000 --> 00:03.000\n"
+                              "skipped text which is long" );
+  webvtt_parser parser;
+  webvtt_cue *cue;
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( 0, &countError, this,
+                                                   &parser ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parse_chunk( parser, skipping.data(),
+                                                 skipping.size() ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_finish_parsing( parser ) );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_parser_next_cue( parser, &cue ) );
+  ASSERT_TRUE( cue != 0 );
+  webvtt_release_cue( &cue );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parser_next_cue( parser, &cue ) );
+  EXPECT_EQ( 0, cue );
+  webvtt_delete_parser( parser );
+}
@@ -232,6 +232,39 @@ TEST_F(ReadCuetext,MultiBuffersMultiLine)
   EXPECT_EQ( "CueText\nis grrrrrrrrrrrrreat!", cuetext() );
 }
 
+/**
+ * Read cuetext in multiple buffers (a line in more than two pieces)
+ */
+TEST_F(ReadCuetext,MultiBuffersLinePieces)
+{
+  webvtt_uint pos = 0;
+  ASSERT_EQ( WEBVTT_UNFINISHED, read_cuetext( "Cue", pos, false ) );
+  pos = 0;
+  ASSERT_EQ( WEBVTT_UNFINISHED, read_cuetext( "Text", pos, false ) );
+  pos = 0;
+  ASSERT_EQ( WEBVTT_UNFINISHED, read_cuetext( " is\nsplit", pos, false ) );
+  EXPECT_EQ( 9, pos );
+  pos = 0;
+  ASSERT_EQ( WEBVTT_SUCCESS, read_cuetext( "\n\n", pos ) );
+  EXPECT_EQ( "CueText is\nsplit", cuetext() );
+}
+
+/**
+ * A line with the cuetimes separator ends the cue text even when it is split
+ * across buffers
+ */
+TEST_F(ReadCuetext,MultiBuffersCueTimesSeparator)
+{
+  webvtt_uint pos = 0;
+  ASSERT_EQ( WEBVTT_UNFINISHED, read_cuetext( "CueText\n--", pos, false ) );
+  pos = 0;
+  ASSERT_EQ( WEBVTT_SUCCESS, read_cuetext( "> 00:01.000", pos ) );
+  EXPECT_EQ( 11, pos );
+  EXPECT_EQ( "CueText", cuetext() );
+  ASSERT_EQ( V_TEXT, uptype() );
+  EXPECT_EQ( "--> 00:01.000", uptext() );
+}
+
 /**
  * Test that we stop reading cuetext if we encounter a line containing the
  * cuetimes separator '-->'.
@@ -249,3 +282,21 @@ TEST_F(ReadCuetext,FinishedOnCueTimesSeparator)
   EXPECT_EQ( "-->", uptext() );
 }
 
+
+/**
+ * Every '\0' in the cue text is replaced with U+FFFD REPLACEMENT CHARACTER,
+ * including in lines which span several buffers
+ */
+TEST_F(ReadCuetext,ReplaceNul)
+{
+  webvtt_uint pos = 0;
+  std::string first( "Cue\0Te", 6 );
+  std::string second( "xt\0\0\n\0\n\n", 8 );
+  ASSERT_EQ( WEBVTT_UNFINISHED, read_cuetext( first, pos, false ) );
+  EXPECT_EQ( 6, pos );
+  pos = 0;
+  ASSERT_EQ( WEBVTT_SUCCESS, read_cuetext( second, pos ) );
+  EXPECT_EQ( 8, pos );
+  EXPECT_EQ( "Cue\xEF\xBF\xBDText\xEF\xBF\xBD\xEF\xBF\xBD\n\xEF\xBF\xBD",
+             cuetext() );
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <webvtt/cue.h>
+#include <string.h>
+#if GTEST_HAS_PTHREAD
+# include <pthread.h>
+#endif
+
+TEST(RefCount, IncrementAndDecrement)
+{
+  struct webvtt_refcount_t ref = WEBVTT_REF_INIT(1);
+  EXPECT_EQ( 2, webvtt_ref( &ref ) );
+  EXPECT_EQ( 3, webvtt_ref( &ref ) );
+  EXPECT_EQ( 2, webvtt_deref( &ref ) );
+  EXPECT_EQ( 1, webvtt_deref( &ref ) );
+  EXPECT_EQ( 0, webvtt_deref( &ref ) );
+}
+
+#if GTEST_HAS_PTHREAD && !defined(WEBVTT_NO_ATOMIC_REFCOUNT)
+static void *
+share_cue( void *data )
+{
+  webvtt_cue *cue = reinterpret_cast<webvtt_cue *>( data );
+  for( int i = 0; i < 100000; ++i ) {
+    webvtt_cue *mine = cue;
+    webvtt_string id;
+    webvtt_ref_cue( mine );
+    webvtt_copy_string( &id, &mine->id );
+    webvtt_release_string( &id );
+    webvtt_release_cue( &mine );
+  }
+  return 0;
+}
+
+/**
+ * Cues (and the strings they share) can be referenced and released from
+ * several threads at once.
+ */
+TEST(RefCount, SharedBetweenThreads)
+{
+  webvtt_cue *cue;
+  pthread_t threads[ 4 ];
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_cue( &cue ) );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_string_append( &cue->id, "id", 2 ) );
+
+  for( int i = 0; i < 4; ++i ) {
+    ASSERT_EQ( 0, pthread_create( &threads[ i ], 0, &share_cue, cue ) );
+  }
+  for( int i = 0; i < 4; ++i ) {
+    pthread_join( threads[ i ], 0 );
+  }
+
+  EXPECT_EQ( 1, cue->refs.value );
+  EXPECT_STREQ( "id", webvtt_string_text( &cue->id ) );
+  webvtt_release_cue( &cue );
+}
+
+static void *
+write_copies( void *data )
+{
+  webvtt_string *shared = reinterpret_cast<webvtt_string *>( data );
+  for( int i = 0; i < 20000; ++i ) {
+    webvtt_string copy, empty;
+    webvtt_copy_string( &copy, shared );
+    if( webvtt_string_detach( &copy ) != WEBVTT_SUCCESS
+        || webvtt_string_putc( &copy, '!' ) != WEBVTT_SUCCESS
+        || strcmp( webvtt_string_text( &copy ), "shared!" ) ) {
+      webvtt_release_string( &copy );
+      return data;
+    }
+    webvtt_release_string( &copy );
+
+    webvtt_init_string( &empty );
+    if( webvtt_string_detach( &empty ) != WEBVTT_SUCCESS
+        || webvtt_string_putc( &empty, 'x' ) != WEBVTT_SUCCESS
+        || strcmp( webvtt_string_text( &empty ), "x" ) ) {
+      webvtt_release_string( &empty );
+      return data;
+    }
+    webvtt_release_string( &empty );
+  }
+  return 0;
+}
+
+/**
+ * Strings shared between threads, including the empty string which every
+ * thread starts from, are copied before they are written to.
+ */
+TEST(RefCount, StringsWrittenFromThreads)
+{
+  webvtt_string shared;
+  pthread_t threads[ 4 ];
+  void *failed[ 4 ];
+  ASSERT_EQ( WEBVTT_SUCCESS,
+             webvtt_create_string_with_text( &shared, "shared", -1 ) );
+
+  for( int i = 0; i < 4; ++i ) {
+    ASSERT_EQ( 0, pthread_create( &threads[ i ], 0, &write_copies,
+                                  &shared ) );
+  }
+  for( int i = 0; i < 4; ++i ) {
+    pthread_join( threads[ i ], &failed[ i ] );
+    EXPECT_TRUE( failed[ i ] == 0 );
+  }
+
+  EXPECT_STREQ( "shared", webvtt_string_text( &shared ) );
+  webvtt_release_string( &shared );
+}
+#endif
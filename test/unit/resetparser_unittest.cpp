@@ -0,0 +1,123 @@
+#include "cuedocument_testfixture"
+#include <algorithm>
+
+/**
+ * A parser which has been through webvtt_reset_parser() has to read the next
+ * document exactly as a new one would, whatever state the last one left it in.
+ */
+class ResetParser : public CueDocumentTest
+{
+public:
+  virtual void SetUp() {
+    makeDocument( 6 );
+    document += "00:09.000 -> 00:10.000\nbad arrow\n\n";
+    document += "long\n00:10.000 --> 00:11.000\n" + std::string( 300, 'x' )
+                + "\n";
+  }
+
+  virtual void TearDown() {
+    webvtt_delete_parser( parser );
+  }
+
+  /**
+   * Parse 'length' bytes of the document 'chunk' bytes at a time, and finish
+   * if asked to
+   */
+  void parse( webvtt_uint chunk, size_t length, bool finish = true ) {
+    clearResults();
+    for( size_t pos = 0; pos < length; pos += chunk ) {
+      webvtt_parse_chunk( parser, document.data() + pos,
+                          std::min<size_t>( chunk, length - pos ) );
+    }
+    if( finish ) {
+      webvtt_finish_parsing( parser );
+    }
+  }
+
+  webvtt_parser_stats stats() {
+    webvtt_parser_stats out;
+    EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parser_get_stats( parser, &out ) );
+    return out;
+  }
+
+protected:
+  webvtt_parser parser;
+};
+
+TEST_F(ResetParser, SameAsNewParser)
+{
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( &readId, &countError, this,
+                                                   &parser ) );
+  parse( 7, document.size() );
+  std::vector<std::string> first = ids;
+  int firstErrors = errors;
+  webvtt_parser_stats fresh = stats();
+  ASSERT_EQ( 7u, first.size() );
+  EXPECT_LT( 0, firstErrors );
+
+  for( int i = 0; i < 3; ++i ) {
+    EXPECT_EQ( WEBVTT_SUCCESS, webvtt_reset_parser( parser ) );
+    parse( 7, document.size() );
+    EXPECT_EQ( first, ids );
+    EXPECT_EQ( firstErrors, errors );
+    webvtt_parser_stats again = stats();
+    EXPECT_EQ( fresh.bytes, again.bytes );
+    EXPECT_EQ( fresh.lines, again.lines );
+    EXPECT_EQ( fresh.cues, again.cues );
+    EXPECT_EQ( fresh.dropped_cues, again.dropped_cues );
+    EXPECT_EQ( 0, memcmp( fresh.errors, again.errors,
+                          sizeof fresh.errors ) );
+    /* What the last document left behind is reused */
+    EXPECT_GE( fresh.allocs, again.allocs );
+  }
+}
+
+TEST_F(ResetParser, InTheMiddleOfADocument)
+{
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( &readId, &countError, this,
+                                                   &parser ) );
+  parse( document.size(), document.size() );
+  std::vector<std::string> whole = ids;
+
+  /* Inside the header, a cue id, its timings and its text */
+  size_t stops[] = { 3, 9, 20, 40, document.size() - 20 };
+  for( size_t i = 0; i < sizeof stops / sizeof *stops; ++i ) {
+    parse( 5, stops[ i ], false );
+    EXPECT_EQ( WEBVTT_SUCCESS, webvtt_reset_parser( parser ) );
+    EXPECT_EQ( 0u, stats().bytes );
+    parse( 11, document.size() );
+    EXPECT_EQ( whole, ids ) << stops[ i ];
+    EXPECT_EQ( WEBVTT_SUCCESS, webvtt_reset_parser( parser ) );
+  }
+}
+
+TEST_F(ResetParser, DropsCuesNotTaken)
+{
+  webvtt_cue *cue;
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser( 0, &countError, this,
+                                                   &parser ) );
+  parse( document.size(), document.size() );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_reset_parser( parser ) );
+  EXPECT_EQ( WEBVTT_UNFINISHED, webvtt_parser_next_cue( parser, &cue ) );
+
+  /* Nor is anything left over of a chunk which hadn't been read to the end */
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parse_chunk( parser, document.data(),
+                                                 document.size() ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_reset_parser( parser ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parse_chunk( parser, document.data(),
+                                                 document.size() ) );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_parser_next_cue( parser, &cue ) );
+  ASSERT_TRUE( cue != 0 );
+  EXPECT_STREQ( "0", webvtt_string_text( &cue->id ) );
+  webvtt_release_cue( &cue );
+}
+
+TEST_F(ResetParser, NotWithAnArena)
+{
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_parser_with_arena( &readId,
+                                                              &countError,
+                                                              this, 0,
+                                                              &parser ) );
+  EXPECT_EQ( WEBVTT_NOT_SUPPORTED, webvtt_reset_parser( parser ) );
+  EXPECT_EQ( WEBVTT_INVALID_PARAM, webvtt_reset_parser( 0 ) );
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <string>
+extern "C" {
+#include "libwebvtt/scan_internal.h"
+}
+
+/**
+ * Each implementation of the scanners has to agree with a plain byte loop, for
+ * every position of the byte it is looking for and every length of input (so
+ * that both the vector loops and the tails are covered).
+ */
+class Scan : public ::testing::TestWithParam<webvtt_scan_isa>
+{
+public:
+  virtual void SetUp()
+  {
+    if( webvtt_scan_select( GetParam() ) != 0 ) {
+      supported = false;
+    } else {
+      supported = true;
+    }
+  }
+
+  virtual void TearDown()
+  {
+    webvtt_scan_select( WEBVTT_SCAN_BEST );
+  }
+
+  static const char *eol( const char *p, const char *end, bool *nul )
+  {
+    *nul = false;
+    for( ; p < end && *p != '\r' && *p != '\n'; ++p ) {
+      *nul = *nul || !*p;
+    }
+    return p;
+  }
+
+  static const char *separator( const char *p, const char *end )
+  {
+    for( ; end - p >= 3; ++p ) {
+      if( p[0] == '-' && p[1] == '-' && p[2] == '>' ) {
+        return p;
+      }
+    }
+    return 0;
+  }
+
+  void check( const std::string &text )
+  {
+    for( size_t start = 0; start < 4 && start <= text.size(); ++start ) {
+      const char *p = text.data() + start;
+      const char *end = text.data() + text.size();
+      bool expectNul;
+      webvtt_bool nul;
+      const char *expected = eol( p, end, &expectNul );
+      EXPECT_EQ( expected, webvtt_scan_eol( p, end ) );
+      EXPECT_EQ( expected, webvtt_scan_eol_nul( p, end, &nul ) );
+      EXPECT_EQ( expectNul, !!nul );
+      EXPECT_EQ( separator( p, end ), webvtt_scan_separator( p, end ) );
+    }
+  }
+
+  bool supported;
+};
+
+TEST_P(Scan, NothingFound)
+{
+  if( !supported ) {
+    return;
+  }
+  for( size_t len = 0; len < 100; ++len ) {
+    check( std::string( len, 'a' ) + "-" );
+  }
+}
+
+TEST_P(Scan, Everywhere)
+{
+  const std::string needles[] = { "\r", "\n", "\r\n", std::string( 1, '\0' ),
+                                  "-->", "--", "->" };
+  if( !supported ) {
+    return;
+  }
+  for( size_t n = 0; n < sizeof( needles ) / sizeof( *needles ); ++n ) {
+    const std::string &needle = needles[ n ];
+    for( size_t len = 0; len < 80; ++len ) {
+      for( size_t at = 0; at <= len; ++at ) {
+        std::string text( len, 'x' );
+        text.insert( at, needle );
+        check( text );
+      }
+    }
+  }
+}
+
+TEST_P(Scan, NulAndEol)
+{
+  if( !supported ) {
+    return;
+  }
+  for( size_t nul = 0; nul < 70; ++nul ) {
+    for( size_t eol = 0; eol < 70; ++eol ) {
+      std::string text( 70, 'x' );
+      text[ nul ] = '\0';
+      text[ eol ] = '\n';
+      check( text );
+    }
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Implementations, Scan,
+                        ::testing::Values( WEBVTT_SCAN_PORTABLE,
+                                           WEBVTT_SCAN_SSE2,
+                                           WEBVTT_SCAN_AVX2 ));
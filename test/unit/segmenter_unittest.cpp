@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+extern "C" {
+#include <webvtt/parser.h>
+#include <webvtt/segmenter.h>
+}
+
+/**
+ * Cues are read with the parser and fed to a segmenter straight from the
+ * parser's callback, the way a packager would do it.
+ */
+class Segmenter : public ::testing::Test
+{
+public:
+  struct Segment {
+    webvtt_uint64 index;
+    webvtt_timestamp start;
+    webvtt_timestamp end;
+    std::string text;
+  };
+
+  virtual void SetUp() {
+    failed = 0;
+    ASSERT_EQ( WEBVTT_SUCCESS,
+               webvtt_create_segmenter( 10000, 0, &emit, this, &segmenter ) );
+  }
+
+  virtual void TearDown() {
+    webvtt_delete_segmenter( segmenter );
+  }
+
+  void parse( const std::string &text ) {
+    webvtt_parser parser;
+    ASSERT_EQ( WEBVTT_SUCCESS,
+               webvtt_create_parser( &read, &error, this, &parser ) );
+    webvtt_parse_chunk( parser, text.data(), text.size() );
+    webvtt_finish_parsing( parser );
+    webvtt_delete_parser( parser );
+  }
+
+  static void WEBVTT_CALLBACK read( void *userdata, webvtt_cue *cue ) {
+    Segmenter *self = static_cast<Segmenter *>( userdata );
+    if( webvtt_segment_cue( self->segmenter, cue ) != WEBVTT_SUCCESS ) {
+      ++self->failed;
+    }
+    webvtt_release_cue( &cue );
+  }
+
+  static int WEBVTT_CALLBACK error( void *, webvtt_uint, webvtt_uint,
+                                    webvtt_error ) {
+    return 0;
+  }
+
+  static webvtt_status WEBVTT_CALLBACK emit( void *userdata,
+                                             webvtt_uint64 index,
+                                             webvtt_timestamp start,
+                                             webvtt_timestamp end,
+                                             const char *text,
+                                             webvtt_uint length ) {
+    Segment segment = { index, start, end, std::string( text, length ) };
+    static_cast<Segmenter *>( userdata )->segments.push_back( segment );
+    return WEBVTT_SUCCESS;
+  }
+
+protected:
+  webvtt_segmenter segmenter;
+  std::vector<Segment> segments;
+  int failed;
+};
+
+/**
+ * Cues that span a boundary are written to the segments on both sides of it,
+ * and a segment with no cues in it is still emitted.
+ */
+TEST_F(Segmenter, SpansAndGaps)
+{
+  parse( "WEBVTT\n\n"
+         "00:00.000 --> 00:02.000\na\n\n"
+         "00:08.000 --> 00:12.000\nb\n\n"
+         "00:35.000 --> 00:36.000\nc\n\n" );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_finish_segmenter( segmenter ) );
+  EXPECT_EQ( 0, failed );
+  ASSERT_EQ( 4u, segments.size() );
+
+  for( size_t i = 0; i < segments.size(); ++i ) {
+    EXPECT_EQ( i, segments[ i ].index );
+    EXPECT_EQ( i * 10000, segments[ i ].start );
+    EXPECT_EQ( ( i + 1 ) * 10000, segments[ i ].end );
+  }
+  EXPECT_EQ( "WEBVTT\n\n"
+             "00:00:00.000 --> 00:00:02.000\na\n\n"
+             "00:00:08.000 --> 00:00:12.000\nb\n\n", segments[ 0 ].text );
+  EXPECT_EQ( "WEBVTT\n\n"
+             "00:00:08.000 --> 00:00:12.000\nb\n\n", segments[ 1 ].text );
+  EXPECT_EQ( "WEBVTT\n\n", segments[ 2 ].text );
+  EXPECT_EQ( "WEBVTT\n\n"
+             "00:00:35.000 --> 00:00:36.000\nc\n\n", segments[ 3 ].text );
+}
+
+/**
+ * A cue which ends on a boundary belongs to the segment before it only.
+ */
+TEST_F(Segmenter, HalfOpen)
+{
+  parse( "WEBVTT\n\n00:05.000 --> 00:10.000\na\n\n"
+         "00:10.000 --> 00:11.000\nb\n\n" );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_finish_segmenter( segmenter ) );
+  ASSERT_EQ( 2u, segments.size() );
+  EXPECT_EQ( "WEBVTT\n\n00:00:05.000 --> 00:00:10.000\na\n\n",
+             segments[ 0 ].text );
+  EXPECT_EQ( "WEBVTT\n\n00:00:10.000 --> 00:00:11.000\nb\n\n",
+             segments[ 1 ].text );
+}
+
+/**
+ * Finishing emits as many segments as the last cues need.
+ */
+TEST_F(Segmenter, FinishCoversLongCues)
+{
+  parse( "WEBVTT\n\n00:05.000 --> 00:25.000\nlong\n\n" );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_finish_segmenter( segmenter ) );
+  ASSERT_EQ( 3u, segments.size() );
+  for( size_t i = 0; i < segments.size(); ++i ) {
+    EXPECT_EQ( "WEBVTT\n\n00:00:05.000 --> 00:00:25.000\nlong\n\n",
+               segments[ i ].text );
+  }
+}
+
+TEST_F(Segmenter, Empty)
+{
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_finish_segmenter( segmenter ) );
+  ASSERT_EQ( 1u, segments.size() );
+  EXPECT_EQ( "WEBVTT\n\n", segments[ 0 ].text );
+}
+
+TEST_F(Segmenter, TimestampMap)
+{
+  ASSERT_EQ( WEBVTT_SUCCESS,
+             webvtt_set_segmenter_timestamp_map( segmenter, 900000, 0 ) );
+  parse( "WEBVTT\n\n00:01.000 --> 00:02.000\na\n\n" );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_finish_segmenter( segmenter ) );
+  ASSERT_EQ( 1u, segments.size() );
+  EXPECT_EQ( "WEBVTT\n"
+             "X-TIMESTAMP-MAP=MPEGTS:900000,LOCAL:00:00:00.000\n\n"
+             "00:00:01.000 --> 00:00:02.000\na\n\n", segments[ 0 ].text );
+}
+
+/**
+ * Cues out of order are still written to the segment being built if they
+ * overlap it, but ones which ended before it are dropped.
+ */
+TEST_F(Segmenter, LateCues)
+{
+  parse( "WEBVTT\n\n00:15.000 --> 00:16.000\na\n\n"
+         "00:09.000 --> 00:11.000\nb\n\n"
+         "00:01.000 --> 00:02.000\nc\n\n" );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_finish_segmenter( segmenter ) );
+  EXPECT_EQ( 1, failed );
+  ASSERT_EQ( 2u, segments.size() );
+  EXPECT_EQ( "WEBVTT\n\n", segments[ 0 ].text );
+  EXPECT_EQ( "WEBVTT\n\n"
+             "00:00:15.000 --> 00:00:16.000\na\n\n"
+             "00:00:09.000 --> 00:00:11.000\nb\n\n", segments[ 1 ].text );
+}
+
+/**
+ * A stream joined part way through is segmented from the segment it was
+ * joined at, rather than from empty segments all the way from 0.
+ */
+TEST_F(Segmenter, FirstSegment)
+{
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_set_segmenter_first( segmenter, 360 ) );
+  parse( "WEBVTT\n\n"
+         "59:58.000 --> 59:59.500\na\n\n"
+         "01:00:05.000 --> 01:00:12.000\nb\n\n" );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_finish_segmenter( segmenter ) );
+  EXPECT_EQ( 1, failed );
+  ASSERT_EQ( 2u, segments.size() );
+  EXPECT_EQ( 360u, segments[ 0 ].index );
+  EXPECT_EQ( 3600000u, segments[ 0 ].start );
+  EXPECT_EQ( "WEBVTT\n\n"
+             "01:00:05.000 --> 01:00:12.000\nb\n\n", segments[ 0 ].text );
+  EXPECT_EQ( 361u, segments[ 1 ].index );
+  EXPECT_EQ( "WEBVTT\n\n"
+             "01:00:05.000 --> 01:00:12.000\nb\n\n", segments[ 1 ].text );
+
+  EXPECT_EQ( WEBVTT_INVALID_PARAM,
+             webvtt_set_segmenter_first( segmenter, 0 ) );
+}
@@ -24,6 +24,10 @@ public:
     return s;
   }
 
+  ::webvtt_status setText( const char *text, webvtt_uint length ) {
+    return ::webvtt_cue_set_settings_from_text( 0, cue, text, length );
+  }
+
   ::webvtt_status set( const char *str ) {
     return ::webvtt_cue_set_setting_from_string( cue, str );
   }
@@ -244,3 +248,34 @@ TEST_F(SetCueSetting, NoWhitespace)
 }
 
 
+
+TEST_F(SetCueSetting, KeywordNearMisses)
+{
+  EXPECT_EQ(WEBVTT_BAD_CUESETTING, set("lane:5"));
+  EXPECT_EQ(WEBVTT_BAD_CUESETTING, set("lines:5"));
+  EXPECT_EQ(WEBVTT_BAD_CUESETTING, set("sise:10%"));
+  EXPECT_EQ(WEBVTT_BAD_CUESETTING, set("Align:start"));
+  EXPECT_EQ(WEBVTT_BAD_CUESETTING, set("alig:start"));
+  EXPECT_EQ(WEBVTT_BAD_CUESETTING, set("positron:10%"));
+  EXPECT_EQ(WEBVTT_BAD_CUESETTING, set("verticle:rl"));
+  EXPECT_EQ(WEBVTT_BAD_CUESETTING, set("xertical:rl"));
+}
+
+/**
+ * Settings are read in place, so nothing past the given length may be looked
+ * at, even though it could be read as more of the last value.
+ */
+TEST_F(SetCueSetting, FromText)
+{
+  const char text[] = "align:end line:5 size:50%";
+  EXPECT_EQ(WEBVTT_SUCCESS, setText(text, 16));
+  EXPECT_EQ(WEBVTT_ALIGN_END, align());
+  EXPECT_EQ(5, line());
+  EXPECT_EQ(100, size());
+
+  /* "size:50" without its '%' is not a size */
+  EXPECT_EQ(WEBVTT_SUCCESS, setText(text + 17, 7));
+  EXPECT_EQ(100, size());
+  EXPECT_EQ(WEBVTT_SUCCESS, setText(text + 17, 8));
+  EXPECT_EQ(50, size());
+}
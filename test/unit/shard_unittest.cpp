@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+extern "C" {
+#include <webvtt/parser.h>
+}
+
+/**
+ * Parsing a document in shards has to give the same cues and errors as
+ * parsing it in one go, wherever it is split. Documents are put together at
+ * random out of blocks which exercise the parser's error handling, and split
+ * at every boundary there is.
+ */
+class Shards : public ::testing::Test
+{
+public:
+  struct Output {
+    std::ostringstream text;
+    bool stop;
+  };
+
+  virtual void SetUp() {
+    seed = 2013;
+  }
+
+  webvtt_uint random( webvtt_uint limit ) {
+    seed = seed * 1103515245 + 12345;
+    return ( seed >> 8 ) % limit;
+  }
+
+  std::string document() {
+    static const char *const blocks[] = {
+      "00:00.000 --> 00:01.000\nhello\n",
+      "id\n00:01.000 --> 00:02.000 align:start line:10%\n<b>bold</b>\n",
+      "00:02.000 --> 00:01.000\nbackwards\n",
+      "just an id\n",
+      "id\nnot a timing\ntext\n",
+      "00:03.000 --> 00:04.000 foo:bar size:200%\na\nb\nc\n",
+      "00:04.000 --> 00:05.000\nx\n00:05.000 --> 00:06.000\ny\n",
+      "00:05.000 --> 00:06.000\n<c.a.b>unclosed <i>tags\n",
+      "00:06.000 --> 00:07.000\r\nwindows\r\nlines\r\n",
+      "00:07.000 --> 00:08.000\rold mac\r",
+      "00:08.000 --> 00:09.000\nnul\0byte\n",
+      "00:09.000 -> 00:10.000\nbad arrow\n",
+      "00:10.000 --> 00:11.000\n<00:10.500>karaoke\n",
+    };
+    static const char *const breaks[] = { "\n", "\n\n", "\r\n\r\n", "\r\r",
+                                          "\n\n\n" };
+    std::string doc = random( 8 ) ? "WEBVTT\n\n" : "WEBVTT header\n";
+    webvtt_uint n = random( 12 );
+    for( webvtt_uint i = 0; i < n; ++i ) {
+      webvtt_uint b = random( sizeof blocks / sizeof *blocks );
+      /* the one block with a NUL in it needs its length given */
+      doc.append( blocks[ b ], b == 10 ? 27 : strlen( blocks[ b ] ) );
+      doc += breaks[ random( 10 ) < 6 ? 1 : random( 5 ) ];
+    }
+    return doc;
+  }
+
+  static void WEBVTT_CALLBACK read( void *userdata, webvtt_cue *cue ) {
+    std::ostringstream &out = static_cast<Output *>( userdata )->text;
+    out << "cue " << webvtt_string_text( &cue->id ) << " " << cue->from
+        << " " << cue->until << " " << cue->settings.align << " "
+        << cue->settings.line << " " << cue->settings.size << " "
+        << webvtt_string_text( &cue->body ) << "\n";
+    webvtt_release_cue( &cue );
+  }
+
+  static int WEBVTT_CALLBACK error( void *userdata, webvtt_uint line,
+                                    webvtt_uint col, webvtt_error code ) {
+    Output *out = static_cast<Output *>( userdata );
+    out->text << "error " << line << ":" << col << " " << code << "\n";
+    return out->stop ? -1 : 0;
+  }
+
+  std::string sequential( const std::string &doc, bool stop ) {
+    Output out;
+    webvtt_parser parser;
+    out.stop = stop;
+    EXPECT_EQ( WEBVTT_SUCCESS,
+               webvtt_create_parser( &read, &error, &out, &parser ) );
+    if( !WEBVTT_FAILED( webvtt_parse_chunk( parser, doc.data(),
+                                            doc.size() ) ) ) {
+      webvtt_finish_parsing( parser );
+    }
+    webvtt_delete_parser( parser );
+    return out.text.str();
+  }
+
+  std::string sharded( const std::string &doc, webvtt_uint count, bool stop,
+                       webvtt_uint *found ) {
+    Output out;
+    webvtt_sharded_parser parser;
+    out.stop = stop;
+    EXPECT_EQ( WEBVTT_SUCCESS,
+               webvtt_create_sharded_parser( doc.data(), doc.size(), count,
+                                             0, &read, &error, &out,
+                                             &parser ) );
+    *found = webvtt_sharded_parser_count( parser );
+    EXPECT_LE( 1u, *found );
+    EXPECT_GE( count, *found );
+    /* Out of order, as they could finish on threads */
+    for( webvtt_uint i = *found; i > 0; --i ) {
+      webvtt_parse_shard( parser, i - 1 );
+    }
+    webvtt_finish_sharded_parser( parser );
+    webvtt_delete_sharded_parser( parser );
+    return out.text.str();
+  }
+
+protected:
+  webvtt_uint seed;
+};
+
+TEST_F(Shards, MatchesSequentialParse)
+{
+  webvtt_uint total = 0;
+  for( int d = 0; d < 400; ++d ) {
+    std::string doc = document();
+    bool stop = d % 4 == 0;
+    std::string expected = sequential( doc, stop );
+    for( webvtt_uint count = 1; count <= 5; ++count ) {
+      webvtt_uint found;
+      ASSERT_EQ( expected, sharded( doc, count, stop, &found ) )
+        << count << " shards of:\n" << doc;
+    }
+    /* Enough shards to split at every boundary */
+    webvtt_uint found;
+    ASSERT_EQ( expected, sharded( doc, doc.size() + 1, stop, &found ) )
+      << "every boundary of:\n" << doc;
+    total += found;
+  }
+  EXPECT_LT( 1000u, total );
+}
+
+TEST_F(Shards, Boundaries)
+{
+  const char doc[] = "WEBVTT\n\n"
+                     "00:00.000 --> 00:01.000\na\n\n"
+                     "00:01.000 --> 00:02.000\r\nb\r\n\r\n\r\n"
+                     "00:02.000 --> 00:03.000\nc\n";
+  webvtt_sharded_parser parser;
+  Output out;
+  out.stop = false;
+  ASSERT_EQ( WEBVTT_SUCCESS,
+             webvtt_create_sharded_parser( doc, sizeof doc - 1, sizeof doc,
+                                           0, &read, &error, &out,
+                                           &parser ) );
+  /* The header goes with the first cue, then one shard per cue */
+  EXPECT_EQ( 3u, webvtt_sharded_parser_count( parser ) );
+  EXPECT_EQ( WEBVTT_INVALID_PARAM, webvtt_parse_shard( parser, 3 ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parse_shard( parser, 2 ) );
+  EXPECT_EQ( WEBVTT_INVALID_PARAM, webvtt_parse_shard( parser, 2 ) );
+  /* Not until every shard is parsed */
+  EXPECT_EQ( WEBVTT_INVALID_PARAM, webvtt_finish_sharded_parser( parser ) );
+  webvtt_delete_sharded_parser( parser );
+
+  /* Nothing to split without a blank line after the header */
+  ASSERT_EQ( WEBVTT_SUCCESS,
+             webvtt_create_sharded_parser( "WEBVTT\nabc\n", 11, 4, 0, &read,
+                                           &error, &out, &parser ) );
+  EXPECT_EQ( 1u, webvtt_sharded_parser_count( parser ) );
+  webvtt_delete_sharded_parser( parser );
+}
+
+TEST_F(Shards, ErrorStopsReplay)
+{
+  const char doc[] = "WEBVTT\n\n"
+                     "00:00.000 --> 00:01.000\na\n\n"
+                     "00:01.000 -> 00:02.000\nb\n\n"
+                     "00:02.000 --> 00:03.000\nc\n\n"
+                     "00:03.000 -> 00:04.000\nd\n";
+  webvtt_sharded_parser parser;
+  Output out;
+  out.stop = true;
+  ASSERT_EQ( WEBVTT_SUCCESS,
+             webvtt_create_sharded_parser( doc, sizeof doc - 1, sizeof doc,
+                                           0, &read, &error, &out,
+                                           &parser ) );
+  for( webvtt_uint i = 0; i < webvtt_sharded_parser_count( parser ); ++i ) {
+    EXPECT_EQ( WEBVTT_SUCCESS, webvtt_parse_shard( parser, i ) );
+  }
+  EXPECT_TRUE( WEBVTT_FAILED( webvtt_finish_sharded_parser( parser ) ) );
+  webvtt_delete_sharded_parser( parser );
+  EXPECT_EQ( sequential( doc, true ), out.text.str() );
+  /* Only the first error is reported, and nothing after it */
+  std::string text = out.text.str();
+  EXPECT_NE( std::string::npos, text.find( "error" ) );
+  EXPECT_EQ( text.find( "error" ), text.rfind( "error" ) );
+  EXPECT_EQ( std::string::npos, text.find( " c\n" ) );
+}
@@ -401,3 +401,34 @@ TEST(String,ReplaceAllStrlen)
   EXPECT_STREQ( expectedOutput, webvtt_string_text( &str ) );
   webvtt_release_string( &str );
 }
+
+/**
+ * Test that replace_all doesn't rescan the replacement text
+ */
+TEST(String,ReplaceAllContainingSearch)
+{
+  webvtt_string str;
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_string_with_text( &str, "potato",
+                                                             -1 ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_string_replace_all( &str, "t", -1,
+                                                        "tt", -1 ) );
+  EXPECT_STREQ( "pottatto", webvtt_string_text( &str ) );
+  webvtt_release_string( &str );
+}
+
+/**
+ * Test that replace_all leaves other references to the string alone
+ */
+TEST(String,ReplaceAllShared)
+{
+  webvtt_string str, copy;
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_string_with_text( &str, "potato",
+                                                             -1 ) );
+  webvtt_copy_string( &copy, &str );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_string_replace_all( &str, "o", -1,
+                                                        "", 0 ) );
+  EXPECT_STREQ( "ptat", webvtt_string_text( &str ) );
+  EXPECT_STREQ( "potato", webvtt_string_text( &copy ) );
+  webvtt_release_string( &str );
+  webvtt_release_string( &copy );
+}
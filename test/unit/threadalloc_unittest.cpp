@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include <webvtt/parser.h>
+#include <string>
+#include "counting_allocator"
+#if GTEST_HAS_PTHREAD
+# include <pthread.h>
+#endif
+
+static const char document[] =
+  "WEBVTT\n\n"
+  "1\n00:01.000 --> 00:02.000 align:start\n<v Bob>Hello <b>world</b></v>\n\n"
+  "2\n00:02.000 --> 00:03.000\nSecond &amp; last\ncue\n";
+
+static void WEBVTT_CALLBACK
+count_cue( void *userdata, webvtt_cue *cue )
+{
+  ++*reinterpret_cast<int *>( userdata );
+  webvtt_release_cue( &cue );
+}
+
+static int WEBVTT_CALLBACK
+ignore_error( void *, webvtt_uint, webvtt_uint, webvtt_error )
+{
+  return 0;
+}
+
+static int
+parse_document()
+{
+  int cues = 0;
+  webvtt_parser parser;
+  if( webvtt_create_parser( &count_cue, &ignore_error, &cues, &parser )
+      != WEBVTT_SUCCESS ) {
+    return -1;
+  }
+  webvtt_parse_chunk( parser, document, sizeof( document ) - 1 );
+  webvtt_finish_parsing( parser );
+  webvtt_delete_parser( parser );
+  return cues;
+}
+
+/**
+ * A block is always given back to the allocator it came from, so switching
+ * allocators with blocks still alive is fine.
+ */
+TEST(ThreadAllocator, SwitchWithLiveBlocks)
+{
+  AllocationCounter first, second;
+  webvtt_string a, b;
+
+  webvtt_set_allocator( &counting_alloc, &counting_free, &first );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_string_with_text( &a, "a", 1 ) );
+  EXPECT_LT( 0, first.live );
+
+  webvtt_set_allocator( &counting_alloc, &counting_free, &second );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_string_with_text( &b, "b", 1 ) );
+  EXPECT_LT( 0, second.live );
+
+  webvtt_release_string( &a );
+  EXPECT_EQ( 0, first.live );
+
+  webvtt_set_allocator( 0, 0, 0 );
+  webvtt_release_string( &b );
+  EXPECT_EQ( 0, second.live );
+}
+
+TEST(ThreadAllocator, OnlyAffectsCallingThread)
+{
+  AllocationCounter mine;
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_set_thread_allocator( &counting_alloc,
+                                                          &counting_free,
+                                                          &mine ) );
+  EXPECT_EQ( 2, parse_document() );
+  EXPECT_LT( 1, mine.total );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_set_thread_allocator( 0, 0, 0 ) );
+  EXPECT_EQ( 0, mine.live );
+
+  EXPECT_EQ( WEBVTT_INVALID_PARAM,
+             webvtt_set_thread_allocator( &counting_alloc, 0, &mine ) );
+}
+
+#if GTEST_HAS_PTHREAD
+struct Worker
+{
+  pthread_t thread;
+  AllocationCounter counter;
+  int cues;
+};
+
+static void *
+work( void *data )
+{
+  Worker *w = reinterpret_cast<Worker *>( data );
+  webvtt_set_thread_allocator( &counting_alloc, &counting_free, &w->counter );
+  w->cues = 0;
+  for( int i = 0; i < 200; ++i ) {
+    w->cues += parse_document();
+  }
+  webvtt_set_thread_allocator( 0, 0, 0 );
+  return 0;
+}
+
+/**
+ * Parsers on different threads, each with their own allocator
+ */
+TEST(ThreadAllocator, ParsersOnSeveralThreads)
+{
+  Worker workers[ 4 ];
+  for( int i = 0; i < 4; ++i ) {
+    ASSERT_EQ( 0, pthread_create( &workers[ i ].thread, 0, &work,
+                                  &workers[ i ] ) );
+  }
+  for( int i = 0; i < 4; ++i ) {
+    pthread_join( workers[ i ].thread, 0 );
+    EXPECT_EQ( 400, workers[ i ].cues );
+    EXPECT_EQ( 0, workers[ i ].counter.live );
+    EXPECT_LT( 400, workers[ i ].counter.total );
+  }
+}
+#endif
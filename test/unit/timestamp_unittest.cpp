@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <cstring>
+extern "C" {
+#include "libwebvtt/parser_internal.h"
+}
+
+/**
+ * Canonical timestamps take a fast path. Whatever path a timestamp takes, it
+ * has to be read the same way as by the general routine, which is what a
+ * 'length' too short for the fast path gets.
+ */
+class Timestamp : public ::testing::Test
+{
+public:
+  static void expectSame( const std::string &text )
+  {
+    webvtt_timestamp fast = 0, general = 0;
+    int fast_length = -1, general_length = -1;
+    int fast_ok = webvtt_parse_timestamp( text.c_str(), text.size(),
+                                          &fast_length, &fast );
+    int general_ok = webvtt_parse_timestamp( text.c_str(), 0,
+                                             &general_length, &general );
+    EXPECT_EQ( general_ok, fast_ok ) << '"' << text << '"';
+    EXPECT_EQ( general, fast ) << '"' << text << '"';
+    EXPECT_EQ( general_length, fast_length ) << '"' << text << '"';
+  }
+};
+
+TEST_F(Timestamp, Canonical)
+{
+  webvtt_timestamp ts;
+  int length;
+  EXPECT_EQ( 1, webvtt_parse_timestamp( "01:02:03.456", 12, &length, &ts ) );
+  EXPECT_EQ( 12, length );
+  EXPECT_EQ( 3723456u, ts );
+  EXPECT_EQ( 1, webvtt_parse_timestamp( "59:59.999 -->", 13, &length, &ts ) );
+  EXPECT_EQ( 9, length );
+  EXPECT_EQ( 3599999u, ts );
+  EXPECT_EQ( 1, webvtt_parse_timestamp( "99:00:00.000", 12, &length, &ts ) );
+  EXPECT_EQ( 356400000u, ts );
+}
+
+/**
+ * Every byte of the canonical forms is replaced with each of a few bytes
+ * around the edges of the digit range, and with the separators.
+ */
+TEST_F(Timestamp, MatchesGeneralRoutine)
+{
+  static const char *forms[] = { "12:34:56.789", "12:34.567", "00:00:00.000",
+                                 "00:00.000" };
+  static const char replacements[] = "/09:;.-a \x80";
+  static const char *suffixes[] = { "", " ", "0", ".", ":", "-->", "5" };
+
+  for( size_t f = 0; f < sizeof( forms ) / sizeof( *forms ); ++f ) {
+    std::string form( forms[ f ] );
+    for( size_t s = 0; s < sizeof( suffixes ) / sizeof( *suffixes ); ++s ) {
+      expectSame( form + suffixes[ s ] );
+      for( size_t i = 0; i < form.size(); ++i ) {
+        for( size_t r = 0; r < sizeof( replacements ) - 1; ++r ) {
+          std::string text( form );
+          text[ i ] = replacements[ r ];
+          expectSame( text + suffixes[ s ] );
+        }
+      }
+    }
+  }
+
+  expectSame( "60:00.000" );
+  expectSame( "00:60.000" );
+  expectSame( "00:60:00.000" );
+  expectSame( "00:00:60.000" );
+  expectSame( "100:00:00.000" );
+  expectSame( "1:00:00.000" );
+  expectSame( "00:00.0000" );
+  expectSame( "00:00:00.0000" );
+}
+
+TEST_F(Timestamp, Batch)
+{
+  const char *texts[] = { "00:01.000", "01:00:00.500", "1:2:3.4", "bad", 0 };
+  webvtt_timestamp out[ 5 ];
+
+  EXPECT_EQ( 2u, webvtt_parse_timestamps( texts, 5, out ) );
+  EXPECT_EQ( 1000u, out[ 0 ] );
+  EXPECT_EQ( 3600500u, out[ 1 ] );
+  EXPECT_EQ( 3723004u, out[ 2 ] );
+  EXPECT_TRUE( BAD_TIMESTAMP( out[ 3 ] ) );
+  EXPECT_TRUE( BAD_TIMESTAMP( out[ 4 ] ) );
+}
@@ -0,0 +1,394 @@
+#include "test_parser"
+#include <webvttxx/cue_track>
+#include <algorithm>
+#include <sstream>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+extern "C" {
+#include <webvtt/parser.h>
+#include <webvtt/track.h>
+}
+
+/**
+ * Lookups are checked against a scan over every cue, in text track cue order,
+ * for tracks of every size around the powers of two where the shape of the
+ * implicit tree changes.
+ */
+class CueTracks : public ::testing::Test
+{
+public:
+  virtual void SetUp() {
+    seed = 12345;
+    ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_cue_track( &track ) );
+  }
+
+  virtual void TearDown() {
+    webvtt_delete_cue_track( track );
+    for( size_t i = 0; i < cues.size(); ++i ) {
+      webvtt_release_cue( &cues[ i ] );
+    }
+  }
+
+  webvtt_uint random( webvtt_uint limit ) {
+    seed = seed * 1103515245 + 12345;
+    return ( seed >> 8 ) % limit;
+  }
+
+  void add( webvtt_timestamp from, webvtt_timestamp until ) {
+    webvtt_cue *cue;
+    ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_cue( &cue ) );
+    cue->from = from;
+    cue->until = until;
+    cues.push_back( cue );
+    ASSERT_EQ( WEBVTT_SUCCESS, webvtt_cue_track_add( track, cue ) );
+  }
+
+  static bool before( const webvtt_cue *a, const webvtt_cue *b ) {
+    if( a->from != b->from ) {
+      return a->from < b->from;
+    }
+    return a->until > b->until;
+  }
+
+  std::vector<webvtt_cue *> scan( webvtt_timestamp from,
+                                  webvtt_timestamp until ) {
+    std::vector<webvtt_cue *> sorted( cues ), found;
+    std::stable_sort( sorted.begin(), sorted.end(), &before );
+    for( size_t i = 0; i < sorted.size(); ++i ) {
+      if( sorted[ i ]->from < until && sorted[ i ]->until > from ) {
+        found.push_back( sorted[ i ] );
+      }
+    }
+    return found;
+  }
+
+  std::vector<webvtt_cue *> lookup( webvtt_timestamp from,
+                                    webvtt_timestamp until ) {
+    std::vector<webvtt_cue *> found( cues.size() + 1 );
+    webvtt_uint n = webvtt_cue_track_overlapping( track, from, until,
+                                                  &found[ 0 ],
+                                                  found.size() );
+    found.resize( n );
+    return found;
+  }
+
+  std::string path( const std::string &relativePath ) {
+    return std::string( getenv( "TEST_FILE_DIR" ) ? getenv( "TEST_FILE_DIR" )
+                                                  : "." ) +
+           "/" + relativePath;
+  }
+
+protected:
+  webvtt_cue_track track;
+  std::vector<webvtt_cue *> cues;
+  webvtt_uint seed;
+};
+
+TEST_F(CueTracks, Empty)
+{
+  webvtt_cue *out;
+  EXPECT_EQ( 0u, webvtt_cue_track_count( track ) );
+  EXPECT_EQ( 0u, webvtt_cue_track_active( track, 0, &out, 1 ) );
+  EXPECT_TRUE( webvtt_cue_track_get( track, 0 ) == 0 );
+}
+
+/**
+ * A cue which ends before it starts is refused, rather than holding up the
+ * cues which end after it.
+ */
+TEST_F(CueTracks, EndBeforeStart)
+{
+  webvtt_cue *cue;
+  add( 0, 6000 );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_cue( &cue ) );
+  cue->from = 10000;
+  cue->until = 5000;
+  EXPECT_EQ( WEBVTT_INVALID_PARAM, webvtt_cue_track_add( track, cue ) );
+  webvtt_release_cue( &cue );
+  EXPECT_EQ( 1u, webvtt_cue_track_count( track ) );
+}
+
+TEST_F(CueTracks, MatchesScan)
+{
+  for( webvtt_uint size = 1; size < 140; ++size ) {
+    TearDown();
+    cues.clear();
+    SetUp();
+    for( webvtt_uint i = 0; i < size; ++i ) {
+      webvtt_timestamp from = random( 1000 );
+      add( from, from + random( i % 7 ? 50 : 600 ) );
+    }
+    for( webvtt_uint q = 0; q < 60; ++q ) {
+      webvtt_timestamp from = random( 1100 );
+      webvtt_timestamp until = from + 1 + random( q % 2 ? 1 : 80 );
+      ASSERT_EQ( scan( from, until ), lookup( from, until ) )
+        << size << " " << from << " " << until;
+    }
+  }
+}
+
+TEST_F(CueTracks, Order)
+{
+  add( 500, 600 );
+  add( 100, 200 );
+  add( 100, 300 );
+  add( 100, 300 );
+  ASSERT_EQ( 4u, webvtt_cue_track_count( track ) );
+  EXPECT_EQ( cues[ 2 ], webvtt_cue_track_get( track, 0 ) );
+  EXPECT_EQ( cues[ 3 ], webvtt_cue_track_get( track, 1 ) );
+  EXPECT_EQ( cues[ 1 ], webvtt_cue_track_get( track, 2 ) );
+  EXPECT_EQ( cues[ 0 ], webvtt_cue_track_get( track, 3 ) );
+}
+
+/**
+ * Active cues are those which have started and not yet ended, and cues added
+ * after a lookup are found by the next one.
+ */
+TEST_F(CueTracks, Active)
+{
+  webvtt_cue *out[ 4 ];
+  add( 1000, 2000 );
+  add( 1500, 1500 );
+  EXPECT_EQ( 0u, webvtt_cue_track_active( track, 999, out, 4 ) );
+  EXPECT_EQ( 1u, webvtt_cue_track_active( track, 1000, out, 4 ) );
+  EXPECT_EQ( 1u, webvtt_cue_track_active( track, 1500, out, 4 ) );
+  EXPECT_EQ( 0u, webvtt_cue_track_active( track, 2000, out, 4 ) );
+
+  add( 1200, 1800 );
+  EXPECT_EQ( 2u, webvtt_cue_track_active( track, 1500, out, 4 ) );
+  EXPECT_EQ( cues[ 0 ], out[ 0 ] );
+  EXPECT_EQ( cues[ 2 ], out[ 1 ] );
+  EXPECT_EQ( 2u, webvtt_cue_track_active( track, 1500, out, 1 ) );
+  EXPECT_EQ( 0u, webvtt_cue_track_active( track, 0xFFFFFFFFFFFFFFFFULL,
+                                          out, 4 ) );
+}
+
+TEST_F(CueTracks, Cxx)
+{
+  ItemStorageParser parser( path( "regressions/853879-1.vtt" ).c_str() );
+  parser.parse();
+  ASSERT_LT( 0u, parser.cueCount() );
+
+  CueTrack cueTrack;
+  for( webvtt_uint i = 0; i < parser.cueCount(); ++i ) {
+    EXPECT_TRUE( cueTrack.add( parser.getCue( i ) ) );
+  }
+  ASSERT_EQ( parser.cueCount(), cueTrack.size() );
+
+  std::vector<Cue> active;
+  Cue first = cueTrack[ 0 ];
+  EXPECT_LE( 1u, cueTrack.activeAt( first.startTime(), active ) );
+  EXPECT_EQ( first.startTime().value(), active[ 0 ].startTime().value() );
+  EXPECT_EQ( cueTrack.size(),
+             cueTrack.overlapping( Timestamp( 0 ),
+                                   Timestamp( 0xFFFFFFFFFFFFFFFFULL ),
+                                   active ) );
+}
+
+/**
+ * Events from a cursor, as "enter", "exit" or "timestamp" and a time
+ */
+class CueCursors : public CueTracks
+{
+public:
+  static webvtt_status WEBVTT_CALLBACK record( void *userdata,
+                                               webvtt_cue_event_type type,
+                                               webvtt_timestamp time,
+                                               webvtt_cue * ) {
+    const char *names[] = { "enter", "exit", "timestamp" };
+    std::ostringstream &out = *static_cast<std::ostringstream *>( userdata );
+    out << names[ type ] << " " << time << "\n";
+    return WEBVTT_SUCCESS;
+  }
+
+  std::string advance( webvtt_timestamp time ) {
+    std::ostringstream out;
+    EXPECT_EQ( WEBVTT_SUCCESS,
+               webvtt_advance_cue_cursor( cursor, time, &record, &out ) );
+    return out.str();
+  }
+
+  virtual void SetUp() {
+    cursor = 0;
+    CueTracks::SetUp();
+  }
+
+  virtual void TearDown() {
+    webvtt_delete_cue_cursor( cursor );
+    CueTracks::TearDown();
+  }
+
+  static webvtt_status WEBVTT_CALLBACK keep( void *userdata,
+                                             webvtt_cue_event_type type,
+                                             webvtt_timestamp,
+                                             webvtt_cue *cue ) {
+    std::vector<webvtt_cue *> &active =
+      *static_cast<std::vector<webvtt_cue *> *>( userdata );
+    std::vector<webvtt_cue *>::iterator it =
+      std::find( active.begin(), active.end(), cue );
+    if( type == WEBVTT_CUE_ENTER ) {
+      EXPECT_TRUE( it == active.end() );
+      active.push_back( cue );
+    } else if( type == WEBVTT_CUE_EXIT ) {
+      EXPECT_TRUE( it != active.end() );
+      if( it == active.end() ) {
+        return WEBVTT_UNSUCCESSFUL;
+      }
+      active.erase( it );
+    }
+    return WEBVTT_SUCCESS;
+  }
+
+  static void WEBVTT_CALLBACK read( void *userdata, webvtt_cue *cue ) {
+    CueCursors *self = static_cast<CueCursors *>( userdata );
+    self->cues.push_back( cue );
+    webvtt_cue_track_add( self->track, cue );
+  }
+
+  static int WEBVTT_CALLBACK error( void *, webvtt_uint, webvtt_uint,
+                                    webvtt_error ) {
+    return 0;
+  }
+
+protected:
+  webvtt_cue_cursor cursor;
+};
+
+TEST_F(CueCursors, Events)
+{
+  add( 0, 10 );
+  add( 5, 15 );
+  add( 20, 20 );
+  add( 30, 40 );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_cue_cursor( track, 0, &cursor ) );
+
+  EXPECT_EQ( "enter 0\n", advance( 0 ) );
+  EXPECT_EQ( "enter 5\n", advance( 7 ) );
+  EXPECT_EQ( "", advance( 7 ) );
+  EXPECT_EQ( "exit 10\n", advance( 12 ) );
+  EXPECT_EQ( "exit 15\nenter 20\nexit 20\nenter 30\nexit 40\n",
+             advance( 50 ) );
+
+  EXPECT_EQ( WEBVTT_INVALID_PARAM,
+             webvtt_advance_cue_cursor( cursor, 49, &record, 0 ) );
+  EXPECT_EQ( WEBVTT_SUCCESS, webvtt_seek_cue_cursor( cursor, 35 ) );
+  EXPECT_EQ( "exit 40\n", advance( 45 ) );
+
+  /**
+   * A cue added while the cursor is at 45, and which is in progress there,
+   * is entered late rather than only exited.
+   */
+  add( 44, 46 );
+  add( 47, 48 );
+  add( 40, 45 );
+  EXPECT_EQ( "enter 44\nexit 46\nenter 47\nexit 48\n", advance( 48 ) );
+}
+
+/**
+ * Cues added while the cursor moves are entered before they exit, however
+ * far it has gone past their start.
+ */
+TEST_F(CueCursors, CuesAddedDuringPlayback)
+{
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_cue_cursor( track, 0, &cursor ) );
+
+  std::vector<webvtt_cue *> active;
+  for( webvtt_timestamp time = 0; time < 3500; time += random( 25 ) ) {
+    for( webvtt_uint i = random( 4 ); i; --i ) {
+      webvtt_timestamp from = time > 200 ? time - 200 + random( 400 )
+                                         : random( 400 );
+      add( from, from + random( 300 ) );
+    }
+    ASSERT_EQ( WEBVTT_SUCCESS,
+               webvtt_advance_cue_cursor( cursor, time, &keep, &active ) );
+    std::vector<webvtt_cue *> expected = lookup( time, time + 1 );
+    std::sort( expected.begin(), expected.end() );
+    std::sort( active.begin(), active.end() );
+    ASSERT_EQ( expected, active ) << time;
+  }
+}
+
+/**
+ * Keeping a set of active cues from the events of a cursor gives the same
+ * cues as looking them up, whatever the steps it is moved in.
+ */
+TEST_F(CueCursors, MatchesLookup)
+{
+  for( webvtt_uint i = 0; i < 300; ++i ) {
+    webvtt_timestamp from = random( 3000 );
+    add( from, from + random( i % 5 ? 40 : 400 ) );
+  }
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_create_cue_cursor( track, 0, &cursor ) );
+
+  std::vector<webvtt_cue *> active;
+  for( webvtt_timestamp time = 0; time < 3500; time += random( 25 ) ) {
+    ASSERT_EQ( WEBVTT_SUCCESS,
+               webvtt_advance_cue_cursor( cursor, time, &keep, &active ) );
+    std::vector<webvtt_cue *> expected = lookup( time, time + 1 );
+    std::sort( expected.begin(), expected.end() );
+    std::sort( active.begin(), active.end() );
+    ASSERT_EQ( expected, active ) << time;
+  }
+}
+
+TEST_F(CueCursors, Timestamps)
+{
+  webvtt_parser parser;
+  ASSERT_EQ( WEBVTT_SUCCESS,
+             webvtt_create_parser( &read, &error, this, &parser ) );
+  const char text[] = "WEBVTT\n\n00:01.000 --> 00:05.000\n"
+                      "a<00:02.000>b<00:03.000>c\n\n"
+                      "00:02.500 --> 00:04.000\n<00:03.000>x\n\n";
+  webvtt_parse_chunk( parser, text, sizeof text - 1 );
+  webvtt_finish_parsing( parser );
+  webvtt_delete_parser( parser );
+  ASSERT_EQ( 2u, cues.size() );
+
+  ASSERT_EQ( WEBVTT_SUCCESS,
+             webvtt_create_cue_cursor( track, WEBVTT_CURSOR_TIMESTAMPS,
+                                       &cursor ) );
+  EXPECT_EQ( "enter 1000\ntimestamp 2000\n", advance( 2000 ) );
+  EXPECT_EQ( "enter 2500\ntimestamp 3000\ntimestamp 3000\nexit 4000\n"
+             "exit 5000\n", advance( 6000 ) );
+}
+
+namespace {
+class RecordingCursor : public CueCursor
+{
+public:
+  RecordingCursor( CueTrack &track ) : CueCursor( track, true ) {}
+
+  std::ostringstream out;
+
+protected:
+  virtual void entered( const Cue &cue ) {
+    out << "enter " << cue.startTime().value() << "\n";
+  }
+  virtual void exited( const Cue &cue ) {
+    out << "exit " << cue.endTime().value() << "\n";
+  }
+  virtual void reached( const Cue &, const Timestamp &time ) {
+    out << "timestamp " << time.value() << "\n";
+  }
+};
+}
+
+TEST_F(CueCursors, Cxx)
+{
+  ItemStorageParser parser( path( "regressions/853879-1.vtt" ).c_str() );
+  parser.parse();
+  ASSERT_LT( 0u, parser.cueCount() );
+
+  CueTrack cueTrack;
+  for( webvtt_uint i = 0; i < parser.cueCount(); ++i ) {
+    cueTrack.add( parser.getCue( i ) );
+  }
+
+  RecordingCursor cueCursor( cueTrack );
+  Cue first = cueTrack[ 0 ];
+  EXPECT_TRUE( cueCursor.advance( first.startTime() ) );
+  EXPECT_EQ( 0u, cueCursor.out.str().find( "enter " ) );
+  EXPECT_TRUE( cueCursor.seek( Timestamp( 0 ) ) );
+  EXPECT_TRUE( cueCursor.advance( Timestamp( 0 ) ) );
+}
@@ -0,0 +1,185 @@
+#include "test_parser"
+#include <webvttxx/writer>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+extern "C" {
+#include <webvtt/parser.h>
+#include <webvtt/writer.h>
+}
+
+/**
+ * Documents are read with the parser and written back out, which should give
+ * back the same text for documents written the way the writer writes them.
+ */
+class WriteCues : public ::testing::Test
+{
+public:
+  virtual void TearDown() {
+    for( size_t i = 0; i < cues.size(); ++i ) {
+      webvtt_release_cue( &cues[ i ] );
+    }
+  }
+
+  void parse( const std::string &text ) {
+    webvtt_parser parser;
+    ASSERT_EQ( WEBVTT_SUCCESS,
+               webvtt_create_parser( &read, &error, &cues, &parser ) );
+    webvtt_parse_chunk( parser, text.data(), text.size() );
+    webvtt_finish_parsing( parser );
+    webvtt_delete_parser( parser );
+  }
+
+  std::string write( webvtt_uint options, webvtt_uint staging = 0 ) {
+    std::string out;
+    std::vector<char> buffer( staging + 1 );
+    webvtt_writer writer;
+    webvtt_init_writer( &writer, staging ? &buffer[ 0 ] : 0, staging, &append,
+                        &out );
+    EXPECT_EQ( WEBVTT_SUCCESS,
+               webvtt_write_document( &writer, cues.empty() ? 0 : &cues[ 0 ],
+                                      cues.size(), options ) );
+    EXPECT_EQ( out.size(), writer.total );
+    return out;
+  }
+
+  std::string path( const std::string &relativePath ) {
+    return std::string( getenv( "TEST_FILE_DIR" ) ? getenv( "TEST_FILE_DIR" )
+                                                  : "." ) +
+           "/" + relativePath;
+  }
+
+  static void WEBVTT_CALLBACK read( void *userdata, webvtt_cue *cue ) {
+    static_cast<std::vector<webvtt_cue *> *>( userdata )->push_back( cue );
+  }
+
+  static int WEBVTT_CALLBACK error( void *, webvtt_uint, webvtt_uint,
+                                    webvtt_error ) {
+    return 0;
+  }
+
+  static webvtt_status WEBVTT_CALLBACK append( void *userdata,
+                                               const char *text,
+                                               webvtt_uint length ) {
+    static_cast<std::string *>( userdata )->append( text, length );
+    return WEBVTT_SUCCESS;
+  }
+
+protected:
+  std::vector<webvtt_cue *> cues;
+};
+
+TEST_F(WriteCues, FormatTimestamp)
+{
+  char buffer[ WEBVTT_MAX_TIMESTAMP_LENGTH ];
+  EXPECT_EQ( 12u, webvtt_format_timestamp( 0, buffer ) );
+  EXPECT_STREQ( "00:00:00.000", buffer );
+  EXPECT_EQ( 12u, webvtt_format_timestamp( 3723456, buffer ) );
+  EXPECT_STREQ( "01:02:03.456", buffer );
+  EXPECT_EQ( 12u, webvtt_format_timestamp( 359999999, buffer ) );
+  EXPECT_STREQ( "99:59:59.999", buffer );
+  EXPECT_EQ( 13u, webvtt_format_timestamp( 360000007, buffer ) );
+  EXPECT_STREQ( "100:00:00.007", buffer );
+  EXPECT_GT( ( webvtt_uint )WEBVTT_MAX_TIMESTAMP_LENGTH,
+             webvtt_format_timestamp( 0xFFFFFFFFFFFFFFFEULL, buffer ) );
+  EXPECT_EQ( "00:01:00.050", WebVTT::Writer::format( Timestamp( 60050 ) ) );
+}
+
+TEST_F(WriteCues, RoundTripBody)
+{
+  const std::string document =
+    "WEBVTT\n\n"
+    "00:00:00.000 --> 00:00:01.500\n"
+    "Hello\n\n"
+    "an id\n"
+    "00:00:02.000 --> 01:00:00.000 vertical:rl line:-2 position:10% size:50% "
+    "align:start\n"
+    "<b>two</b>\n"
+    "lines &amp; more\n\n"
+    "00:00:03.000 --> 00:00:04.000 line:25% align:middle\n"
+    "x\n\n";
+
+  parse( document );
+  ASSERT_EQ( 3u, cues.size() );
+  EXPECT_EQ( document, write( 0 ) );
+}
+
+/**
+ * line:-1 reads into the same value as auto, and line:0 is the first line,
+ * but both were given and are written back.
+ */
+TEST_F(WriteCues, RoundTripLine)
+{
+  const std::string document =
+    "WEBVTT\n\n"
+    "00:00:00.000 --> 00:00:01.000 line:-1\n"
+    "last\n\n"
+    "00:00:01.000 --> 00:00:02.000 line:0\n"
+    "first\n\n"
+    "00:00:02.000 --> 00:00:03.000\n"
+    "auto\n\n";
+
+  parse( document );
+  ASSERT_EQ( 3u, cues.size() );
+  EXPECT_EQ( document, write( 0 ) );
+}
+
+TEST_F(WriteCues, RoundTripNodes)
+{
+  const std::string document =
+    "WEBVTT\n\n"
+    "00:00:00.000 --> 00:00:01.500\n"
+    "<v Esme>a &amp; b &lt;c&gt;</v> <c.x.y>t<00:00:01.000>u</c>\n"
+    "<lang en><ruby>k<rt>r</rt></ruby></lang> <i>i</i><u>u</u>\n\n";
+
+  parse( document );
+  ASSERT_EQ( 1u, cues.size() );
+  EXPECT_EQ( document, write( WEBVTT_WRITE_NODES ) );
+}
+
+/**
+ * Whatever the size of the staging buffer, the sink gets the same text.
+ */
+TEST_F(WriteCues, Staging)
+{
+  parse( "WEBVTT\n\n00:01.000 --> 00:02.000\nSome text\n\n"
+         "00:02.000 --> 00:03.000 align:end\nMore text\n\n" );
+  ASSERT_EQ( 2u, cues.size() );
+  std::string expected = write( 0 );
+  for( webvtt_uint size = 1; size < 80; size += 7 ) {
+    EXPECT_EQ( expected, write( 0, size ) ) << size;
+  }
+}
+
+TEST_F(WriteCues, SmallBuffer)
+{
+  char buffer[ 64 ];
+  webvtt_writer writer;
+
+  parse( "WEBVTT\n\n00:01.000 --> 00:02.000\nSome text\n\n" );
+  ASSERT_EQ( 1u, cues.size() );
+
+  webvtt_init_writer( &writer, buffer, sizeof( buffer ), 0, 0 );
+  ASSERT_EQ( WEBVTT_SUCCESS, webvtt_write_cue( &writer, cues[ 0 ], 0 ) );
+  EXPECT_EQ( std::string( "00:00:01.000 --> 00:00:02.000\nSome text\n\n" ),
+             std::string( buffer, writer.length ) );
+
+  webvtt_init_writer( &writer, buffer, 16, 0, 0 );
+  EXPECT_EQ( WEBVTT_OUT_OF_MEMORY, webvtt_write_cue( &writer, cues[ 0 ], 0 ) );
+  EXPECT_EQ( 41u, writer.total );
+  EXPECT_GE( 16u, writer.length );
+}
+
+TEST_F(WriteCues, Cxx)
+{
+  ItemStorageParser parser( path( "payload/lang-tag/internal-within-lang.vtt" )
+                            .c_str() );
+  parser.parse();
+  ASSERT_EQ( 1u, parser.cueCount() );
+
+  WebVTT::Writer writer;
+  EXPECT_TRUE( writer.writeHeader() );
+  EXPECT_TRUE( writer.write( parser.getCue( 0 ), WebVTT::Writer::Nodes ) );
+  EXPECT_EQ( std::string( "WEBVTT\n\n00:00:11.000 --> 00:00:13.000\n"
+                          "<lang en><b>Text</b></lang>\n\n" ), writer.str() );
+}